@@ -12,7 +12,7 @@ pMCRG + nECRG = pnMCRG
 */
 
 // balanced ePSU use pnMCRG and one-time pad
-std::vector<block> balanced_ePSU(u32 idx, std::vector<block> &set, u32 numThreads){
+std::vector<block> balanced_ePSU(u32 idx, std::vector<block> &set, u32 numThreads, const RotConfig &rotConfig){
     
     u32 numElements = set.size();
     oc::CuckooParam params = oc::CuckooIndex<>::selectParams(numElements, ssp, 0, 3);
@@ -31,7 +31,7 @@ std::vector<block> balanced_ePSU(u32 idx, std::vector<block> &set, u32 numThread
 
     if (idx == 0){
         // run cuckoo hash, and save permuted cuckoo hash table(as x||1) in permutedX0
-        pnMCRG(idx, numElements, set, pnMCRG_out, permutedX, chl, numThreads);
+        pnMCRG(idx, numElements, set, pnMCRG_out, permutedX, chl, numThreads, rotConfig);
         // one-time pad
         for(u32 i = 0; i < numBins; ++i){
             vecOTP_out[i] = pnMCRG_out[i] ^ permutedX[i];
@@ -41,7 +41,7 @@ std::vector<block> balanced_ePSU(u32 idx, std::vector<block> &set, u32 numThread
         timer.setTimePoint("end"); 
 
     } else {
-        pnMCRG(idx, numElements, set, pnMCRG_out, permutedX, chl, numThreads);
+        pnMCRG(idx, numElements, set, pnMCRG_out, permutedX, chl, numThreads, rotConfig);
         coproto::sync_wait(chl.recv(vecOTP_out));
         std::vector<block> setUnion(set);
 
@@ -25,4 +25,4 @@ pMCRG + nECRG = pnMCRG
 
 
 // balanced ePSU use pnMCRG and one-time pad
-std::vector<block> balanced_ePSU(u32 idx, std::vector<block> &set, u32 numThreads);
+std::vector<block> balanced_ePSU(u32 idx, std::vector<block> &set, u32 numThreads, const RotConfig &rotConfig = RotConfig());
@@ -44,7 +44,7 @@ void ReceiveEC25519Points(Socket &chl, std::vector<EC25519Point> &vecA, u32 numT
     }  
 }
 
-void nECRG(u32 idx, std::vector<block> &input, std::vector<block> &out, Socket &chl, u32 numThreads)
+void nECRG(u32 idx, std::vector<block> &input, std::vector<block> &out, Socket &chl, u32 numThreads, const RotConfig &rotConfig)
 {
     u32 numBins = input.size();
     out.resize(numBins);
@@ -58,7 +58,7 @@ void nECRG(u32 idx, std::vector<block> &input, std::vector<block> &out, Socket &
     AlignedVector<std::array<block, 2>> sMsgs(numBins);
     AlignedVector<block> rMsgs(numBins);
 
-    ssROT(isSender, numBins, chl, bitV, out, prng, numThreads);
+    ssROT(isSender, numBins, chl, bitV, out, prng, numThreads, rotConfig);
 
     return;
 }
@@ -286,7 +286,7 @@ void pMCRG(u32 idx, u32 numElements, std::vector<block> &set, std::vector<block>
 }    
 
 // pnMCRG = pMCRG + nECRG
-void pnMCRG(u32 idx, u32 numElements, std::vector<block> &set, std::vector<block> &out, std::vector<block> &permutedX0, Socket &chl, u32 numThreads)
+void pnMCRG(u32 idx, u32 numElements, std::vector<block> &set, std::vector<block> &out, std::vector<block> &permutedX0, Socket &chl, u32 numThreads, const RotConfig &rotConfig)
 {
     // Timer timer;
     // timer.setTimePoint("start");
@@ -295,7 +295,7 @@ void pnMCRG(u32 idx, u32 numElements, std::vector<block> &set, std::vector<block
     pMCRG(idx, numElements, set, mcrg_out, permutedX0, chl, numThreads);
     // timer.setTimePoint("pMCRG");
 
-    nECRG(idx, mcrg_out, out, chl, numThreads);
+    nECRG(idx, mcrg_out, out, chl, numThreads, rotConfig);
     // timer.setTimePoint("nECRG");
     // if(idx == 1){
     //     std::cout << timer << std::endl;
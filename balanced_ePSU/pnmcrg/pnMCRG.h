@@ -41,7 +41,7 @@ void SendEC25519Points(Socket &chl, std::vector<EC25519Point> &vecA, u32 numThre
 
 void ReceiveEC25519Points(Socket &chl, std::vector<EC25519Point> &vecA, u32 numThreads); 
 
-void nECRG(u32 idx, std::vector<block> &input, std::vector<block> &out, Socket &chl, u32 numThreads);
+void nECRG(u32 idx, std::vector<block> &input, std::vector<block> &out, Socket &chl, u32 numThreads, const RotConfig &rotConfig = RotConfig());
 
 void pECRG(u32 isPi, std::vector<block> &set, std::vector<block> &out, std::vector<u32> &pi, Socket &chl, u32 numThreads);
 
@@ -49,7 +49,7 @@ void pECRG(u32 isPi, std::vector<block> &set, std::vector<block> &out, std::vect
 void pMCRG(u32 idx, u32 numElements, std::vector<block> &set, std::vector<block> &out, std::vector<block> &permutedX0, Socket &chl, u32 numThreads);   
 
 // pnMCRG = MCRG + nECRG
-void pnMCRG(u32 idx, u32 numElements, std::vector<block> &set, std::vector<block> &out, std::vector<block> &permutedX0, Socket &chl, u32 numThreads);
+void pnMCRG(u32 idx, u32 numElements, std::vector<block> &set, std::vector<block> &out, std::vector<block> &permutedX0, Socket &chl, u32 numThreads, const RotConfig &rotConfig = RotConfig());
 
 
 
@@ -1,43 +1,57 @@
 #include "ssROT.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <stdexcept>
 
 
-void softSend(u32 numElements, Socket &chl, PRNG& prng, AlignedVector<std::array<block, 2>> &sMsgs, u32 numThreads)
+RotType parseRotType(const std::string &name)
+{
+    if(name == "soft" || name == "softspoken") return RotType::SoftSpoken;
+    if(name == "silent") return RotType::Silent;
+    if(name == "iknp") return RotType::Iknp;
+    if(name == "auto") return RotType::Auto;
+    throw std::invalid_argument("unknown ROT type " + name);
+}
+
+std::string rotTypeName(RotType type)
+{
+    switch(type){
+        case RotType::SoftSpoken: return "softspoken";
+        case RotType::Silent: return "silent";
+        case RotType::Iknp: return "iknp";
+        case RotType::Auto: return "auto";
+    }
+    return "unknown";
+}
+
+
+// OT extension sender is base OT's receiver
+static void otExtSend(OtExtSender &sender, u32 numElements, Socket &chl, PRNG& prngOT, AlignedVector<std::array<block, 2>> &sMsgs)
 {
-    SoftSpokenShOtSender<> sender;
-    sender.init(fieldBits, true);
     const size_t numBaseOTs = sender.baseOtCount();
-    PRNG prngOT(prng.get<block>());
-    AlignedVector<block> baseMsg;
+    AlignedVector<block> baseMsg(numBaseOTs);
     // choice bits for baseOT
-    BitVector baseChoice;
-
-    // OTE's sender is base OT's receiver
-    DefaultBaseOT base;
-    baseMsg.resize(numBaseOTs);
+    BitVector baseChoice(numBaseOTs);
     // randomize the base OT's choice bits
-    baseChoice.resize(numBaseOTs);
     baseChoice.randomize(prngOT);
+
+    DefaultBaseOT base;
     // perform the base ot, call sync_wait to block until they have completed.
     coproto::sync_wait(base.receive(baseChoice, baseMsg, prngOT, chl));
 
     sender.setBaseOts(baseMsg, baseChoice);
     // perform random ots
-
     sMsgs.resize(numElements);
     coproto::sync_wait(sender.send(sMsgs, prngOT, chl));
-
 }
 
-void softRecv(u32 numElements, BitVector bitV, Socket &chl, PRNG& prng, AlignedVector<block> &rMsgs, u32 numThreads)
+// OT extension receiver is base OT's sender
+static void otExtRecv(OtExtReceiver &receiver, u32 numElements, const BitVector &bitV, Socket &chl, PRNG& prngOT, AlignedVector<block> &rMsgs)
 {
-
-    SoftSpokenShOtReceiver<> receiver;
-    receiver.init(fieldBits, true);
     const size_t numBaseOTs = receiver.baseOtCount();
     AlignedVector<std::array<block, 2>> baseMsg(numBaseOTs);
-    PRNG prngOT(prng.get<block>());
 
-    // OTE's receiver is base OT's sender
     DefaultBaseOT base;
     // perform the base ot, call sync_wait to block until they have completed.
     coproto::sync_wait(base.send(baseMsg, prngOT, chl));
@@ -46,25 +60,184 @@ void softRecv(u32 numElements, BitVector bitV, Socket &chl, PRNG& prng, AlignedV
 
     rMsgs.resize(numElements);
     coproto::sync_wait(receiver.receive(bitV, rMsgs, prngOT, chl));
+}
+
+
+void softSend(u32 numElements, Socket &chl, PRNG& prng, AlignedVector<std::array<block, 2>> &sMsgs, u32 numThreads, u64 k)
+{
+    SoftSpokenShOtSender<> sender;
+    sender.init(k, true);
+    PRNG prngOT(prng.get<block>());
+    otExtSend(sender, numElements, chl, prngOT, sMsgs);
+}
+
+void softRecv(u32 numElements, BitVector bitV, Socket &chl, PRNG& prng, AlignedVector<block> &rMsgs, u32 numThreads, u64 k)
+{
+    SoftSpokenShOtReceiver<> receiver;
+    receiver.init(k, true);
+    PRNG prngOT(prng.get<block>());
+    otExtRecv(receiver, numElements, bitV, chl, prngOT, rMsgs);
+}
+
+
+void iknpSend(u32 numElements, Socket &chl, PRNG& prng, AlignedVector<std::array<block, 2>> &sMsgs, u32 numThreads)
+{
+#ifdef ENABLE_IKNP
+    IknpOtExtSender sender;
+    PRNG prngOT(prng.get<block>());
+    otExtSend(sender, numElements, chl, prngOT, sMsgs);
+#else
+    throw std::runtime_error("libOTe was built without IKNP (ENABLE_IKNP)");
+#endif
+}
 
+void iknpRecv(u32 numElements, BitVector bitV, Socket &chl, PRNG& prng, AlignedVector<block> &rMsgs, u32 numThreads)
+{
+#ifdef ENABLE_IKNP
+    IknpOtExtReceiver receiver;
+    PRNG prngOT(prng.get<block>());
+    otExtRecv(receiver, numElements, bitV, chl, prngOT, rMsgs);
+#else
+    throw std::runtime_error("libOTe was built without IKNP (ENABLE_IKNP)");
+#endif
+}
+
+
+// silent OT gives the receiver random choice bits c; it sends d = c ^ bitV and the sender swaps
+// its messages wherever d is set, so that the receiver holds sMsgs[i][bitV[i]]
+void silentSend(u32 numElements, Socket &chl, PRNG& prng, AlignedVector<std::array<block, 2>> &sMsgs, u32 numThreads)
+{
+#ifdef ENABLE_SILENTOT
+    SilentOtExtSender sender;
+    sender.configure(numElements, 2, numThreads);
+    PRNG prngOT(prng.get<block>());
+
+    sMsgs.resize(numElements);
+    coproto::sync_wait(sender.silentSend(sMsgs, prngOT, chl));
+
+    std::vector<u8> diff(oc::divCeil(numElements, 8));
+    coproto::sync_wait(chl.recv(diff));
+    BitVector d(diff.data(), numElements);
+    for(u32 i = 0; i < numElements; ++i){
+        if(d[i]){
+            std::swap(sMsgs[i][0], sMsgs[i][1]);
+        }
+    }
+#else
+    throw std::runtime_error("libOTe was built without silent OT (ENABLE_SILENTOT)");
+#endif
+}
+
+void silentRecv(u32 numElements, BitVector bitV, Socket &chl, PRNG& prng, AlignedVector<block> &rMsgs, u32 numThreads)
+{
+#ifdef ENABLE_SILENTOT
+    SilentOtExtReceiver receiver;
+    receiver.configure(numElements, 2, numThreads);
+    PRNG prngOT(prng.get<block>());
+
+    BitVector choice(numElements);
+    rMsgs.resize(numElements);
+    coproto::sync_wait(receiver.silentReceive(choice, rMsgs, prngOT, chl));
+
+    choice ^= bitV;
+    std::vector<u8> diff(choice.data(), choice.data() + choice.sizeBytes());
+    coproto::sync_wait(chl.send(std::move(diff)));
+#else
+    throw std::runtime_error("libOTe was built without silent OT (ENABLE_SILENTOT)");
+#endif
+}
+
+
+// the OT sender times a probe and its acknowledgement, then announces the backend and k
+static RotConfig resolveAutoSend(Socket &chl, const RotConfig &config)
+{
+    RotConfig resolved = config;
+    std::vector<u8> probe(config.autoProbeBytes);
+    std::vector<u8> ack(1);
+
+    auto start = std::chrono::steady_clock::now();
+    coproto::sync_wait(chl.send(probe));
+    coproto::sync_wait(chl.recv(ack));
+    auto end = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    double mbps = probe.size() * 8 / 1e6 / std::max(seconds, 1e-9);
+    resolved.type = mbps < config.autoThresholdMbps ? RotType::Silent : RotType::SoftSpoken;
+
+    std::vector<u8> decision = { static_cast<u8>(resolved.type), static_cast<u8>(resolved.softSpokenFieldBits) };
+    coproto::sync_wait(chl.send(std::move(decision)));
+
+    std::cout << "measured bandwidth " << std::fixed << std::setprecision(1) << mbps << " Mbps, using " << rotTypeName(resolved.type) << " OT" << std::endl;
+    return resolved;
+}
+
+static RotConfig resolveAutoRecv(Socket &chl, const RotConfig &config)
+{
+    RotConfig resolved = config;
+    std::vector<u8> probe(config.autoProbeBytes);
+    coproto::sync_wait(chl.recv(probe));
+    coproto::sync_wait(chl.send(std::vector<u8>(1)));
+
+    std::vector<u8> decision(2);
+    coproto::sync_wait(chl.recv(decision));
+    resolved.type = static_cast<RotType>(decision[0]);
+    resolved.softSpokenFieldBits = decision[1];
+    return resolved;
+}
+
+
+void rotSend(u32 numElements, Socket &chl, PRNG& prng, AlignedVector<std::array<block, 2>> &sMsgs, const RotConfig &config, u32 numThreads)
+{
+    RotConfig resolved = config.type == RotType::Auto ? resolveAutoSend(chl, config) : config;
+    switch(resolved.type){
+        case RotType::SoftSpoken:
+            softSend(numElements, chl, prng, sMsgs, numThreads, resolved.softSpokenFieldBits);
+            break;
+        case RotType::Silent:
+            silentSend(numElements, chl, prng, sMsgs, numThreads);
+            break;
+        case RotType::Iknp:
+            iknpSend(numElements, chl, prng, sMsgs, numThreads);
+            break;
+        default:
+            throw std::invalid_argument("invalid ROT type");
+    }
+}
+
+void rotRecv(u32 numElements, const BitVector &bitV, Socket &chl, PRNG& prng, AlignedVector<block> &rMsgs, const RotConfig &config, u32 numThreads)
+{
+    RotConfig resolved = config.type == RotType::Auto ? resolveAutoRecv(chl, config) : config;
+    switch(resolved.type){
+        case RotType::SoftSpoken:
+            softRecv(numElements, bitV, chl, prng, rMsgs, numThreads, resolved.softSpokenFieldBits);
+            break;
+        case RotType::Silent:
+            silentRecv(numElements, bitV, chl, prng, rMsgs, numThreads);
+            break;
+        case RotType::Iknp:
+            iknpRecv(numElements, bitV, chl, prng, rMsgs, numThreads);
+            break;
+        default:
+            throw std::invalid_argument("invalid ROT type");
+    }
 }
 
 
-void ssROT(bool isSender, u32 numBins, Socket &chl, BitVector bitV, std::vector<block> &Out, PRNG& prng, u32 numThreads)
+void ssROT(bool isSender, u32 numBins, Socket &chl, BitVector bitV, std::vector<block> &Out, PRNG& prng, u32 numThreads, const RotConfig &rotConfig)
 {
     Out.resize(numBins);
     AlignedVector<std::array<block, 2>> sMsgs(numBins);
     AlignedVector<block> rMsgs(numBins);
 
     if(isSender){
-        softSend(numBins, chl, prng, sMsgs, numThreads);
+        rotSend(numBins, chl, prng, sMsgs, rotConfig, numThreads);
 
         for(u32 i = 0; i < numBins; ++i){
             Out[i] = sMsgs[i][bitV[i]];
         }        
     }
     else{
-        softRecv(numBins, bitV, chl, prng, rMsgs, numThreads);
+        rotRecv(numBins, bitV, chl, prng, rMsgs, rotConfig, numThreads);
         memcpy(Out.data(), rMsgs.data(), numBins * sizeof(block));
     }
 
@@ -6,7 +6,7 @@ using namespace oc;
 
 
 // balanced_ePSU test
-void balanced_ePSU_test(u32 idx, u32 numElements, u32 numThreads){
+void balanced_ePSU_test(u32 idx, u32 numElements, u32 numThreads, const RotConfig &rotConfig){
 
     std::vector<block> set(numElements);
 
@@ -25,7 +25,7 @@ void balanced_ePSU_test(u32 idx, u32 numElements, u32 numThreads){
 
     if (idx == 1){
         std::vector<block> out;
-        out = balanced_ePSU(idx, set, numThreads);
+        out = balanced_ePSU(idx, set, numThreads, rotConfig);
         u32 UNION_CARDINALITY = numElements + 1;
         if(UNION_CARDINALITY == out.size()){
             std::cout << "Balanced_ePSU functionality test pass! And union size is: " << out.size() << std::endl;
@@ -38,7 +38,7 @@ void balanced_ePSU_test(u32 idx, u32 numElements, u32 numThreads){
         timer.setTimePoint("end"); 
 
     } else {
-        balanced_ePSU(idx, set, numThreads);
+        balanced_ePSU(idx, set, numThreads, rotConfig);
     }
 
    
@@ -54,6 +54,9 @@ int main(int agrc, char** argv){
     u32 n = cmd.getOr("n", 1ull << nn);
     u32 nt = cmd.getOr("nt", 1);
     u32 idx = cmd.getOr("r", 0);
+    RotConfig rotConfig;
+    rotConfig.type = parseRotType(cmd.getOr<std::string>("ot", "soft"));
+    rotConfig.softSpokenFieldBits = cmd.getOr("k", fieldBits);
 
     bool help = cmd.isSet("h");
     if (help){
@@ -63,6 +66,8 @@ int main(int agrc, char** argv){
         std::cout << "    -nn:          logarithm of the number of elements in each set, default 10" << std::endl;
         std::cout << "    -nt:          number of threads, default 1" << std::endl;
         std::cout << "    -r:           index of party" << std::endl;
+        std::cout << "    -ot:          ROT backend: soft, silent, iknp or auto, default soft" << std::endl;
+        std::cout << "    -k:           softspoken field bits, default 5" << std::endl;
         return 0;
     }    
 
@@ -71,7 +76,7 @@ int main(int agrc, char** argv){
         return 0;
     }
 
-    balanced_ePSU_test(idx, n, nt);
+    balanced_ePSU_test(idx, n, nt, rotConfig);
     return 0;
 }
 
@@ -0,0 +1,286 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+// STD
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Base
+#include "base_clp.h"
+
+/**
+Command Line Processor for the end-to-end unbalanced ePSU driver; both parties use it.
+*/
+class CLP : public BaseCLP {
+public:
+    CLP(const std::string &desc, const std::string &version) : BaseCLP(desc, version)
+    {}
+
+    virtual void add_args()
+    {
+        add(role_arg_);
+        add(net_addr_arg_);
+        add(net_port_arg_);
+        add(ot_addr_arg_);
+        add(params_file_arg_);
+        add(set_file_arg_);
+        add(set_size_log_arg_);
+        add(query_size_arg_);
+        add(int_size_arg_);
+        add(seed_arg_);
+        add(out_file_arg_);
+        add(rot_type_arg_);
+        add(soft_spoken_k_arg_);
+        add(compress_arg_);
+        add(plaintext_cache_mb_arg_);
+        add(pool_retention_mb_arg_);
+    }
+
+    virtual void get_args()
+    {
+        role_ = role_arg_.getValue();
+        net_addr_ = net_addr_arg_.getValue();
+        net_port_ = net_port_arg_.getValue();
+        ot_addr_ = ot_addr_arg_.getValue();
+        params_file_ = params_file_arg_.getValue();
+        set_file_ = set_file_arg_.getValue();
+        set_size_log_ = set_size_log_arg_.getValue();
+        query_size_ = query_size_arg_.getValue();
+        int_size_ = int_size_arg_.getValue();
+        seed_ = seed_arg_.getValue();
+        output_file_ = out_file_arg_.getValue();
+        rot_type_ = rot_type_arg_.getValue();
+        soft_spoken_k_ = soft_spoken_k_arg_.getValue();
+        compress_ = compress_arg_.getValue();
+        plaintext_cache_mb_ = plaintext_cache_mb_arg_.getValue();
+        pool_retention_mb_ = pool_retention_mb_arg_.getValue();
+    }
+
+    int role() const
+    {
+        return role_;
+    }
+
+    const std::string &net_addr() const
+    {
+        return net_addr_;
+    }
+
+    int net_port() const
+    {
+        return net_port_;
+    }
+
+    const std::string &ot_addr() const
+    {
+        return ot_addr_;
+    }
+
+    const std::string &params_file() const
+    {
+        return params_file_;
+    }
+
+    const std::string &set_file() const
+    {
+        return set_file_;
+    }
+
+    std::size_t set_size_log() const
+    {
+        return set_size_log_;
+    }
+
+    std::size_t query_size() const
+    {
+        return query_size_;
+    }
+
+    std::size_t int_size() const
+    {
+        return int_size_;
+    }
+
+    std::uint64_t seed() const
+    {
+        return seed_;
+    }
+
+    const std::string &output_file() const
+    {
+        return output_file_;
+    }
+
+    const std::string &rot_type() const
+    {
+        return rot_type_;
+    }
+
+    std::size_t soft_spoken_k() const
+    {
+        return soft_spoken_k_;
+    }
+
+    bool compress() const
+    {
+        return compress_;
+    }
+
+    std::size_t plaintext_cache_mb() const
+    {
+        return plaintext_cache_mb_;
+    }
+
+    std::size_t pool_retention_mb() const
+    {
+        return pool_retention_mb_;
+    }
+
+private:
+    TCLAP::ValueArg<int> role_arg_ = TCLAP::ValueArg<int>(
+        "r",
+        "role",
+        "0 for the receiver (holds the large set and learns the union), 1 for the sender",
+        true,
+        0,
+        "0 or 1");
+
+    TCLAP::ValueArg<std::string> net_addr_arg_ = TCLAP::ValueArg<std::string>(
+        "a", "ipAddr", "IP address of the receiver (sender only)", false, "localhost", "string");
+
+    TCLAP::ValueArg<int> net_port_arg_ = TCLAP::ValueArg<int>(
+        "", "port", "TCP port of the MCRG channel (default is 60000)", false, 60000, "TCP port");
+
+    TCLAP::ValueArg<std::string> ot_addr_arg_ = TCLAP::ValueArg<std::string>(
+        "",
+        "otAddr",
+        "host:port of the socket shared by the OPRF and pnECRG+OTP; the receiver listens on it "
+        "(default is localhost:1212)",
+        false,
+        "localhost:1212",
+        "string");
+
+    TCLAP::ValueArg<std::string> params_file_arg_ = TCLAP::ValueArg<std::string>(
+        "p",
+        "paramsFile",
+        "Path to a JSON file that specifies APSU parameters; both parties must use the same file",
+        false,
+        "16M-1024.json",
+        "string");
+
+    TCLAP::ValueArg<std::string> set_file_arg_ = TCLAP::ValueArg<std::string>(
+        "i",
+        "setFile",
+        "Path to a CSV file with this party's set (one item per line); if not given, the sets "
+        "are generated from --seed",
+        false,
+        "",
+        "string");
+
+    TCLAP::ValueArg<std::size_t> set_size_log_arg_ = TCLAP::ValueArg<std::size_t>(
+        "n",
+        "setSizeLog",
+        "Logarithm of the generated receiver set size (default is 12)",
+        false,
+        12,
+        "unsigned integer");
+
+    TCLAP::ValueArg<std::size_t> query_size_arg_ = TCLAP::ValueArg<std::size_t>(
+        "",
+        "querySize",
+        "Size of the generated sender set (default is 1024)",
+        false,
+        1024,
+        "unsigned integer");
+
+    TCLAP::ValueArg<std::size_t> int_size_arg_ = TCLAP::ValueArg<std::size_t>(
+        "",
+        "intSize",
+        "Size of the intersection of the generated sets (default is 512)",
+        false,
+        512,
+        "unsigned integer");
+
+    TCLAP::ValueArg<std::uint64_t> seed_arg_ = TCLAP::ValueArg<std::uint64_t>(
+        "",
+        "seed",
+        "Seed of the generated sets; both parties must use the same seed (default is 0)",
+        false,
+        0,
+        "unsigned integer");
+
+    TCLAP::ValueArg<std::string> out_file_arg_ = TCLAP::ValueArg<std::string>(
+        "o",
+        "outFile",
+        "Path to a file where the receiver writes the sender's items outside its set",
+        false,
+        "",
+        "string");
+
+    TCLAP::ValueArg<std::string> rot_type_arg_ = TCLAP::ValueArg<std::string>(
+        "",
+        "ot",
+        "ROT backend of nECRG: soft, silent, iknp or auto (default is soft)",
+        false,
+        "soft",
+        "string");
+
+    TCLAP::ValueArg<std::size_t> soft_spoken_k_arg_ = TCLAP::ValueArg<std::size_t>(
+        "k", "softSpokenK", "SoftSpoken field bits (default is 5)", false, 5, "unsigned integer");
+
+    TCLAP::SwitchArg compress_arg_ =
+        TCLAP::SwitchArg("c", "compress", "Whether to compress the ReceiverDB in memory", false);
+
+    TCLAP::ValueArg<std::size_t> plaintext_cache_mb_arg_ = TCLAP::ValueArg<std::size_t>(
+        "",
+        "plaintextCacheMB",
+        "Memory budget in MB for keeping the ReceiverDB plaintexts loaded between queries; the "
+        "least recently used are dropped when over budget (default is 0, which disables it)",
+        false,
+        0,
+        "unsigned integer");
+
+    TCLAP::ValueArg<std::size_t> pool_retention_mb_arg_ = TCLAP::ValueArg<std::size_t>(
+        "",
+        "poolRetentionMB",
+        "Memory in MB that each thread may keep in its SEAL memory pool between queries (default is "
+        "0, which keeps everything)",
+        false,
+        0,
+        "unsigned integer");
+
+    int role_;
+
+    std::string net_addr_;
+
+    int net_port_;
+
+    std::string ot_addr_;
+
+    std::string params_file_;
+
+    std::string set_file_;
+
+    std::size_t set_size_log_;
+
+    std::size_t query_size_;
+
+    std::size_t int_size_;
+
+    std::uint64_t seed_;
+
+    std::string output_file_;
+
+    std::string rot_type_;
+
+    std::size_t soft_spoken_k_;
+
+    bool compress_;
+
+    std::size_t plaintext_cache_mb_;
+
+    std::size_t pool_retention_mb_;
+};
@@ -0,0 +1,332 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+/*
+End-to-end unbalanced ePSU: both parties run the same binary. MCRG runs over ZeroMQ; its OPRF and
+pnECRG+OTP share one coproto socket, and the MCRG masks stay in memory. One thread count (-t) is
+used by the APSU thread pool and by pnECRG.
+*/
+
+// STD
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+// APSU
+#include "apsu/log.h"
+#include "apsu/memory_pool_mgr.h"
+#include "apsu/network/zmq/zmq_channel.h"
+#include "apsu/plaintext_cache.h"
+#include "apsu/psu_params.h"
+#include "apsu/receiver_db.h"
+#include "apsu/receiver_ddh.h"
+#include "apsu/sender_ddh.h"
+#include "apsu/thread_pool_mgr.h"
+#include "apsu/version.h"
+#include "apsu/zmq/receiver_dispatcher_ddh.h"
+#include "common_utils.h"
+#include "csv_reader.h"
+#include "epsu/clp.h"
+
+#include "coproto/Socket/AsioSocket.h"
+
+// pnECRG+OTP; pulls `using namespace oc` into the global namespace, so the driver's command line
+// processor is spelled ::CLP below
+#include "pECRG_nECRG_OTP.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double ms_since(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    std::unique_ptr<apsu::PSUParams> load_psu_params(const std::string &params_file)
+    {
+        std::string params_json;
+        try {
+            throw_if_file_invalid(params_file);
+            std::ifstream input_file(params_file);
+            std::stringstream ss;
+            ss << input_file.rdbuf();
+            params_json = ss.str();
+        } catch (const std::exception &ex) {
+            APSU_LOG_ERROR("Error trying to read input file " << params_file << ": " << ex.what());
+            return nullptr;
+        }
+
+        try {
+            return std::make_unique<apsu::PSUParams>(apsu::PSUParams::Load(params_json));
+        } catch (const std::exception &ex) {
+            APSU_LOG_ERROR("APSU threw an exception creating PSUParams: " << ex.what());
+            return nullptr;
+        }
+    }
+
+    /**
+    Generates this party's set the way tools/auto_test.py does: the receiver holds 2^set_size_log
+    random 16-letter items, the sender holds int_size of them and query_size - int_size fresh ones.
+    Both parties draw from the same seed, so the sets match without exchanging files.
+    */
+    std::vector<std::string> generate_set(const ::CLP &cmd)
+    {
+        static const std::string letters =
+            "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+        std::mt19937_64 gen(cmd.seed());
+        std::uniform_int_distribution<std::size_t> dist(0, letters.size() - 1);
+        auto random_item = [&]() {
+            std::string item(16, ' ');
+            for (auto &c : item) {
+                c = letters[dist(gen)];
+            }
+            return item;
+        };
+
+        std::size_t receiver_size = std::size_t(1) << cmd.set_size_log();
+        std::size_t int_size = std::min(cmd.int_size(), std::min(cmd.query_size(), receiver_size));
+
+        std::vector<std::string> items;
+        if (cmd.role() == 0) {
+            items.reserve(receiver_size);
+            for (std::size_t i = 0; i < receiver_size; i++) {
+                items.push_back(random_item());
+            }
+            return items;
+        }
+
+        items.reserve(cmd.query_size());
+        for (std::size_t i = 0; i < receiver_size; i++) {
+            auto item = random_item();
+            if (i < int_size) {
+                items.push_back(std::move(item));
+            }
+        }
+        while (items.size() < cmd.query_size()) {
+            items.push_back(random_item());
+        }
+        return items;
+    }
+
+    bool load_set(const ::CLP &cmd, std::vector<apsu::Item> &items, std::vector<std::string> &orig_items)
+    {
+        if (cmd.set_file().empty()) {
+            orig_items = generate_set(cmd);
+            items.assign(orig_items.begin(), orig_items.end());
+            APSU_LOG_INFO("Generated a set of " << items.size() << " items from seed " << cmd.seed());
+            return true;
+        }
+
+        try {
+            CSVReader::DBData data;
+            std::tie(data, orig_items) = CSVReader(cmd.set_file()).read();
+            if (!std::holds_alternative<CSVReader::UnlabeledData>(data)) {
+                APSU_LOG_ERROR("Set file `" << cmd.set_file() << "` must not contain labels");
+                return false;
+            }
+            items = std::move(std::get<CSVReader::UnlabeledData>(data));
+        } catch (const std::exception &ex) {
+            APSU_LOG_WARNING("Could not open or read file `" << cmd.set_file() << "`: " << ex.what());
+            return false;
+        }
+        return true;
+    }
+
+    RotConfig build_rot_config(const ::CLP &cmd)
+    {
+        RotConfig rot_config;
+        rot_config.type = parseRotType(cmd.rot_type());
+        rot_config.softSpokenFieldBits = cmd.soft_spoken_k();
+        return rot_config;
+    }
+
+    void print_comm(const std::string &stage, double bytes)
+    {
+        std::cout << stage << " comm = " << std::fixed << std::setprecision(3) << bytes / 1024 / 1024
+                  << " MB" << std::endl;
+    }
+
+    int run_receiver(const ::CLP &cmd)
+    {
+        auto params = load_psu_params(cmd.params_file());
+        if (!params) {
+            return -1;
+        }
+
+        std::vector<apsu::Item> items;
+        std::vector<std::string> orig_items;
+        if (!load_set(cmd, items, orig_items)) {
+            return -1;
+        }
+        orig_items.clear();
+
+        auto socket = coproto::asioConnect(cmd.ot_addr(), true);
+        auto start = Clock::now();
+
+        // The ReceiverDB runs the OPRF with the sender over the shared socket while it is built
+        std::shared_ptr<apsu::receiver::ReceiverDB> receiver_db;
+        try {
+            receiver_db = std::make_shared<apsu::receiver::ReceiverDB>(*params, 0, 0, cmd.compress());
+            receiver_db->setSocket(socket);
+            receiver_db->set_data(items);
+            receiver_db->strip();
+        } catch (const std::exception &ex) {
+            APSU_LOG_ERROR("Failed to create ReceiverDB: " << ex.what());
+            return -1;
+        }
+        items.clear();
+        APSU_LOG_INFO(
+            "Created ReceiverDB with " << receiver_db->get_item_count() << " items; packing rate "
+                                       << receiver_db->get_packing_rate());
+        double setup_ms = ms_since(start);
+
+        apsu::receiver::Receiver receiver;
+        receiver.setSocket(socket);
+        receiver.set_random_matrix_file("");
+        receiver.start_mask_pool(receiver_db);
+        apsu::receiver::ZMQReceiverDispatcher dispatcher(receiver_db, receiver);
+
+        // The dispatcher returns once it has answered the query
+        std::atomic<bool> stop = false;
+        dispatcher.run(stop, cmd.net_port());
+        double mcrg_ms = ms_since(start) - setup_ms;
+        double mcrg_bytes = socket.bytesSent() + socket.bytesReceived();
+
+        auto context = dispatcher.get_last_query_context();
+        if (!context) {
+            APSU_LOG_ERROR("The dispatcher returned without serving a query");
+            return -1;
+        }
+        auto union_sub_receiver = pECRG_nECRG_OTP_Recv(
+            socket,
+            context->random_matrix,
+            context->item_cnt,
+            context->alpha_max_cache_count,
+            params->item_params().mask_bit_count,
+            static_cast<u32>(apsu::ThreadPoolMgr::GetThreadCount()),
+            build_rot_config(cmd));
+        double total_ms = ms_since(start);
+
+        std::cout << "union sub receiver size: " << union_sub_receiver.size();
+        if (cmd.set_file().empty()) {
+            std::cout << " (expected " << cmd.query_size() - std::min(cmd.int_size(), cmd.query_size())
+                      << ")";
+        }
+        std::cout << std::endl;
+
+        if (!cmd.output_file().empty()) {
+            std::ofstream fout(cmd.output_file());
+            for (auto item : union_sub_receiver) {
+                fout << item << std::endl;
+            }
+            APSU_LOG_INFO("Wrote output to " << cmd.output_file());
+        }
+
+        std::cout << std::fixed << std::setprecision(3) << "setup and OPRF time = " << setup_ms
+                  << " ms, MCRG time = " << mcrg_ms
+                  << " ms, pnECRG+OTP time = " << total_ms - setup_ms - mcrg_ms
+                  << " ms, total time = " << total_ms << " ms" << std::endl;
+        print_comm("OPRF", mcrg_bytes);
+        print_comm("pnECRG+OTP", socket.bytesSent() + socket.bytesReceived() - mcrg_bytes);
+        print_timing_report(apsu::util::recv_stopwatch);
+
+        coproto::sync_wait(socket.flush());
+        coproto::sync_wait(socket.close());
+        return 0;
+    }
+
+    int run_sender(const ::CLP &cmd)
+    {
+        auto params = load_psu_params(cmd.params_file());
+        if (!params) {
+            return -1;
+        }
+
+        std::vector<apsu::Item> items;
+        std::vector<std::string> orig_items;
+        if (!load_set(cmd, items, orig_items)) {
+            return -1;
+        }
+        std::vector<apsu::HashedItem> hashed_items;
+        hashed_items.reserve(items.size());
+        for (const auto &item : items) {
+            hashed_items.emplace_back(item.get_as<std::uint64_t>()[0], item.get_as<std::uint64_t>()[1]);
+        }
+
+        auto socket = coproto::asioConnect(cmd.ot_addr(), false);
+        auto start = Clock::now();
+
+        apsu::network::ZMQSenderChannel channel;
+        std::stringstream conn_addr;
+        conn_addr << "tcp://" << cmd.net_addr() << ":" << cmd.net_port();
+        channel.connect(conn_addr.str());
+        if (!channel.is_connected()) {
+            APSU_LOG_WARNING("Failed to connect to " << conn_addr.str());
+            return -1;
+        }
+
+        apsu::sender::Sender sender(*params);
+        sender.set_random_matrix_file("");
+        apsu::sender::QueryContext context;
+        try {
+            sender.request_query(hashed_items, channel, orig_items, socket, context);
+        } catch (const std::exception &ex) {
+            APSU_LOG_WARNING("Failed sending APSU query: " << ex.what());
+            return -1;
+        }
+        double mcrg_ms = ms_since(start);
+
+        pECRG_nECRG_OTP_Send(
+            socket,
+            context.decrypt_randoms_matrix,
+            context.cuckoo_item,
+            context.item_cnt,
+            context.alpha_max_cache_count,
+            params->item_params().mask_bit_count,
+            static_cast<u32>(apsu::ThreadPoolMgr::GetThreadCount()),
+            build_rot_config(cmd));
+        double total_ms = ms_since(start);
+
+        std::cout << std::fixed << std::setprecision(3) << "OPRF and MCRG time = " << mcrg_ms
+                  << " ms, pnECRG+OTP time = " << total_ms - mcrg_ms
+                  << " ms, total time = " << total_ms << " ms" << std::endl;
+        print_comm("MCRG", channel.bytes_sent() + channel.bytes_received());
+        print_timing_report(apsu::util::sender_stopwatch);
+
+        coproto::sync_wait(socket.flush());
+        coproto::sync_wait(socket.close());
+        return 0;
+    }
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    prepare_console();
+
+    ::CLP cmd("End-to-end unbalanced ePSU (MCRG and pnECRG+OTP)", APSU_VERSION);
+    if (!cmd.parse_args(argc, argv)) {
+        APSU_LOG_ERROR("Failed parsing command line arguments");
+        return -1;
+    }
+    if (cmd.role() != 0 && cmd.role() != 1) {
+        APSU_LOG_ERROR("Role must be 0 (receiver) or 1 (sender)");
+        return -1;
+    }
+
+    apsu::ThreadPoolMgr::SetThreadCount(cmd.threads());
+    APSU_LOG_INFO("Setting thread count to " << apsu::ThreadPoolMgr::GetThreadCount());
+    apsu::receiver::PlaintextCache::SetBudget(cmd.plaintext_cache_mb() << 20);
+    apsu::MemoryPoolMgr::SetRetentionLimit(cmd.pool_retention_mb() << 20);
+
+    return cmd.role() == 0 ? run_receiver(cmd) : run_sender(cmd);
+}
@@ -27,23 +27,33 @@ public:
     virtual void add_args()
     {
         add(compress_arg_);
+        add(plaintext_cache_mb_arg_);
+        add(pool_retention_mb_arg_);
         add(nonce_byte_count_arg_);
         add(net_port_arg_);
         add(params_file_arg_);
         add(db_file_arg_);
         add(sdb_out_file_arg_);
         add(item_byte_count_arg_);
+        add(serve_arg_);
+        add(max_concurrent_queries_arg_);
+        add(offline_oprf_arg_);
     }
 
     virtual void get_args()
     {
         compress_ = compress_arg_.getValue();
+        plaintext_cache_mb_ = plaintext_cache_mb_arg_.getValue();
+        pool_retention_mb_ = pool_retention_mb_arg_.getValue();
         nonce_byte_count_ = nonce_byte_count_arg_.getValue();
         db_file_ = db_file_arg_.getValue();
         net_port_ = net_port_arg_.getValue();
         params_file_ = params_file_arg_.getValue();
         sdb_out_file_ = sdb_out_file_arg_.getValue();
         item_byte_count_ = item_byte_count_arg_.getValue();
+        serve_ = serve_arg_.getValue();
+        max_concurrent_queries_ = max_concurrent_queries_arg_.getValue();
+        offline_oprf_ = offline_oprf_arg_.getValue();
     }
 
     std::size_t nonce_byte_count() const
@@ -61,6 +71,16 @@ public:
         return compress_;
     }
 
+    std::size_t plaintext_cache_mb() const
+    {
+        return plaintext_cache_mb_;
+    }
+
+    std::size_t pool_retention_mb() const
+    {
+        return pool_retention_mb_;
+    }
+
     int net_port() const
     {
         return net_port_;
@@ -81,6 +101,21 @@ public:
         return sdb_out_file_;
     }
 
+    bool serve() const
+    {
+        return serve_;
+    }
+
+    std::size_t max_concurrent_queries() const
+    {
+        return max_concurrent_queries_;
+    }
+
+    bool offline_oprf() const
+    {
+        return offline_oprf_;
+    }
+
 private:
     TCLAP::ValueArg<std::size_t> nonce_byte_count_arg_ = TCLAP::ValueArg<std::size_t>(
         "n",
@@ -126,10 +161,54 @@ private:
     TCLAP::SwitchArg compress_arg_ =
         TCLAP::SwitchArg("c", "compress", "Whether to compress the ReceiverDB in memory", false);
 
+    TCLAP::ValueArg<std::size_t> plaintext_cache_mb_arg_ = TCLAP::ValueArg<std::size_t>(
+        "",
+        "plaintextCacheMB",
+        "Memory budget in MB for keeping the ReceiverDB plaintexts loaded between queries; the "
+        "least recently used are dropped when over budget (default is 0, which disables it)",
+        false,
+        0,
+        "unsigned integer");
+
+    TCLAP::ValueArg<std::size_t> pool_retention_mb_arg_ = TCLAP::ValueArg<std::size_t>(
+        "",
+        "poolRetentionMB",
+        "Memory in MB that each thread may keep in its SEAL memory pool between queries (default is "
+        "0, which keeps everything)",
+        false,
+        0,
+        "unsigned integer");
+
+    TCLAP::SwitchArg serve_arg_ = TCLAP::SwitchArg(
+        "",
+        "serve",
+        "Keep serving queries until interrupted instead of exiting after the first one; the masks "
+        "of query i are written to randomM/receiver_pi_i",
+        false);
+
+    TCLAP::ValueArg<std::size_t> max_concurrent_queries_arg_ = TCLAP::ValueArg<std::size_t>(
+        "",
+        "maxConcurrentQueries",
+        "Maximum number of queries evaluated at the same time (default is 1)",
+        false,
+        1,
+        "unsigned integer");
+
+    TCLAP::SwitchArg offline_oprf_arg_ = TCLAP::SwitchArg(
+        "",
+        "offlineOPRF",
+        "Build the ReceiverDB with its own OPRF key instead of the sender's KKRT OPRF, so that it "
+        "can be saved with --sdbOutFile and loaded again with --dbFile",
+        false);
+
     std::size_t nonce_byte_count_;
     std::size_t item_byte_count_;
     bool compress_;
 
+    std::size_t plaintext_cache_mb_;
+
+    std::size_t pool_retention_mb_;
+
     int net_port_;
 
     std::string db_file_;
@@ -137,4 +216,10 @@ private:
     std::string params_file_;
 
     std::string sdb_out_file_;
+
+    bool serve_;
+
+    std::size_t max_concurrent_queries_;
+
+    bool offline_oprf_;
 };
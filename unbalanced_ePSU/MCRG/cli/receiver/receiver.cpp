@@ -15,7 +15,9 @@
 
 // APSU
 #include "apsu/log.h"
+#include "apsu/memory_pool_mgr.h"
 #include "apsu/oprf/oprf_sender.h"
+#include "apsu/plaintext_cache.h"
 #include "apsu/thread_pool_mgr.h"
 #include "apsu/version.h"
 #include "common_utils.h"
@@ -47,8 +49,10 @@ unique_ptr<CSVReader::DBData> load_db(const string &db_file);
 shared_ptr<ReceiverDB> create_receiver_db(
     const CSVReader::DBData &db_data,
     unique_ptr<PSUParams> psu_params,
+    OPRFKey &oprf_key,
     size_t nonce_byte_count,
     bool compress,
+    bool offline_oprf,
     coproto::AsioSocket ReceiverSocket
     );
 
@@ -71,33 +75,43 @@ void sigint_handler(int param [[maybe_unused]])
     exit(0);
 }
 
-shared_ptr<ReceiverDB> try_load_receiver_db(const CLP &cmd)
+shared_ptr<ReceiverDB> try_load_receiver_db(const CLP &cmd, OPRFKey &oprf_key)
 {
     shared_ptr<ReceiverDB> result = nullptr;
 
-    ifstream fs(cmd.db_file(), ios::binary);
-    fs.exceptions(ios_base::badbit | ios_base::failbit);
     try {
-        auto [data, size] = ReceiverDB::Load(fs);
+        // Map the file rather than reading it; the plaintexts are used where they lie
+        auto [data, size] = ReceiverDB::LoadMapped(cmd.db_file());
         APSU_LOG_INFO("Loaded ReceiverDB (" << size << " bytes) from " << cmd.db_file());
         if (!cmd.params_file().empty()) {
             APSU_LOG_WARNING(
                 "PSU parameters were loaded with the ReceiverDB; ignoring given PSU parameters");
         }
-        result = make_shared<ReceiverDB>(move(data));
 
-        // Load also the OPRF key
-        //oprf_key.load(fs);
-        //APSU_LOG_INFO("Loaded OPRF key (" << oprf_key_size << " bytes) from " << cmd.db_file());
+        // Load also the OPRF key, which follows the ReceiverDB
+        ifstream fs(cmd.db_file(), ios::binary);
+        fs.exceptions(ios_base::badbit | ios_base::failbit);
+        fs.seekg(static_cast<streamoff>(size));
+        oprf_key.load(fs);
+        APSU_LOG_INFO("Loaded OPRF key (" << oprf_key_size << " bytes) from " << cmd.db_file());
+
+        result = make_shared<ReceiverDB>(move(data));
     } catch (const exception &e) {
         // Failed to load ReceiverDB
         APSU_LOG_DEBUG("Failed to load ReceiverDB: " << e.what());
     }
 
+    // Only a ReceiverDB built offline can serve another session
+    if (result && !result->is_offline_oprf()) {
+        APSU_LOG_ERROR("The loaded ReceiverDB was built with the KKRT OPRF of an earlier session");
+        return nullptr;
+    }
+
     return result;
 }
 
-shared_ptr<ReceiverDB> try_load_csv_db(const CLP &cmd,coproto::AsioSocket receiversocket)
+shared_ptr<ReceiverDB> try_load_csv_db(
+    const CLP &cmd, OPRFKey &oprf_key, coproto::AsioSocket receiversocket)
 {
     unique_ptr<PSUParams> params = build_psu_params(cmd);
     if (!params) {
@@ -113,14 +127,27 @@ shared_ptr<ReceiverDB> try_load_csv_db(const CLP &cmd,coproto::AsioSocket receiv
         return nullptr;
     }
 
-    return create_receiver_db( *db_data, move(params), cmd.nonce_byte_count(), cmd.compress(),receiversocket);
+    return create_receiver_db(
+        *db_data,
+        move(params),
+        oprf_key,
+        cmd.nonce_byte_count(),
+        cmd.compress(),
+        cmd.offline_oprf(),
+        receiversocket);
 }
 
-bool try_save_receiver_db(const CLP &cmd, shared_ptr<ReceiverDB> receiver_db)
+bool try_save_receiver_db(const CLP &cmd, shared_ptr<ReceiverDB> receiver_db, const OPRFKey &oprf_key)
 {
     if (!receiver_db) {
         return false;
     }
+    if (!receiver_db->is_offline_oprf()) {
+        APSU_LOG_WARNING(
+            "Not saving ReceiverDB: it was built with the KKRT OPRF of this session; use "
+            "--offlineOPRF to build a reusable ReceiverDB");
+        return false;
+    }
 
     ofstream fs(cmd.sdb_out_file(), ios::binary);
     fs.exceptions(ios_base::badbit | ios_base::failbit);
@@ -129,41 +156,54 @@ bool try_save_receiver_db(const CLP &cmd, shared_ptr<ReceiverDB> receiver_db)
         APSU_LOG_INFO("Saved ReceiverDB (" << size << " bytes) to " << cmd.sdb_out_file());
 
         // Save also the OPRF key (fixed size: oprf_key_size bytes)
-    
+        oprf_key.save(fs);
         APSU_LOG_INFO("Saved OPRF key (" << oprf_key_size << " bytes) to " << cmd.sdb_out_file());
-
     } catch (const exception &e) {
         APSU_LOG_WARNING("Failed to save ReceiverDB: " << e.what());
         return false;
     }
 
-
-
     return true;
 }
 
 int start_receiver(const CLP &cmd)
 {
     auto start_time = std::chrono::steady_clock::now();
-    APSU_LOG_INFO(__FILE__ << __LINE__);
-    auto ReceiverKKRTSocket = coproto::asioConnect("localhost:1212",true);
-
-
 
     ThreadPoolMgr::SetThreadCount(cmd.threads());
     APSU_LOG_INFO("Setting thread count to " << ThreadPoolMgr::GetThreadCount());
+    PlaintextCache::SetBudget(cmd.plaintext_cache_mb() << 20);
+    if (cmd.plaintext_cache_mb()) {
+        APSU_LOG_INFO("Keeping up to " << cmd.plaintext_cache_mb() << " MB of plaintexts loaded");
+    }
+    MemoryPoolMgr::SetRetentionLimit(cmd.pool_retention_mb() << 20);
     signal(SIGINT, sigint_handler);
 
     // Check that the database file is valid
     throw_if_file_invalid(cmd.db_file());
 
-    // Try loading first as a ReceiverDB, then as a CSV file
+    // Try loading first as a ReceiverDB, then as a CSV file. A saved ReceiverDB is always in
+    // offline OPRF mode, so only a ReceiverDB built from CSV without --offlineOPRF runs the KKRT
+    // OPRF with the sender.
     shared_ptr<ReceiverDB> receiver_db;
-    // receiver_db->setSocket(ReceiverSocket);
-    //  OPRFKey oprf_key;
-    if (!(receiver_db = try_load_csv_db(cmd,ReceiverKKRTSocket))) {
-        APSU_LOG_ERROR("Failed to create ReceiverDB: terminating");
-        return -1;
+    OPRFKey oprf_key;
+    coproto::AsioSocket ReceiverKKRTSocket;
+    bool use_kkrt = false;
+    if (!(receiver_db = try_load_receiver_db(cmd, oprf_key))) {
+        use_kkrt = !cmd.offline_oprf();
+        if (use_kkrt) {
+            ReceiverKKRTSocket = coproto::asioConnect("localhost:1212", true);
+        }
+        if (!(receiver_db = try_load_csv_db(cmd, oprf_key, ReceiverKKRTSocket))) {
+            APSU_LOG_ERROR("Failed to create ReceiverDB: terminating");
+            return -1;
+        }
+
+        // Save the ReceiverDB if requested
+        if (!cmd.sdb_out_file().empty() && !try_save_receiver_db(cmd, receiver_db, oprf_key)) {
+            APSU_LOG_ERROR("Failed to save ReceiverDB: terminating");
+            return -1;
+        }
     }
 
     // Print the total number of bin bundles and the largest number of bin bundles for any bundle
@@ -187,23 +227,35 @@ int start_receiver(const CLP &cmd)
     // Run the dispatcher
     atomic<bool> stop = false;
     Receiver receiver;
-    receiver.setSocket(ReceiverKKRTSocket);
+    if (use_kkrt) {
+        receiver.setSocket(ReceiverKKRTSocket);
+    }
+    receiver.start_mask_pool(receiver_db);
 #if ARBITARY == 0 
 #else
     receiver.set_item_len(cmd.item_byte_count());
 #endif
-    ZMQReceiverDispatcher dispatcher(receiver_db, receiver);
 
+    // In offline OPRF mode the dispatcher answers the sender's OPRF request with the key the
+    // ReceiverDB was built with
+    ZMQReceiverDispatcher dispatcher =
+        receiver_db->is_offline_oprf() ? ZMQReceiverDispatcher(receiver_db, oprf_key, receiver)
+                                       : ZMQReceiverDispatcher(receiver_db, receiver);
+    if (cmd.serve()) {
+        dispatcher.set_query_limit(0);
+    }
+    dispatcher.set_max_concurrent_queries(cmd.max_concurrent_queries());
 
-    // The dispatcher will run until stopped.
+    // The dispatcher runs until stopped, or after the first query unless --serve is given
     dispatcher.run(stop, cmd.net_port());
 
     auto end_time = std::chrono::steady_clock::now();
     auto running_time = end_time-start_time;
     std::cout<<"\n\n\n\n receiver all time"<<std::chrono::duration<double,std::milli> (running_time).count()<<std::endl<<std::endl<<std::endl;
     print_timing_report(recv_stopwatch);
-    ReceiverKKRTSocket.close();
-    APSU_LOG_INFO(__LINE__);
+    if (use_kkrt) {
+        ReceiverKKRTSocket.close();
+    }
     return 0;
 }
 
@@ -224,8 +276,10 @@ unique_ptr<CSVReader::DBData> load_db(const string &db_file)
 shared_ptr<ReceiverDB> create_receiver_db(
     const CSVReader::DBData &db_data,
     unique_ptr<PSUParams> psu_params,
+    OPRFKey &oprf_key,
     size_t nonce_byte_count,
     bool compress,
+    bool offline_oprf,
     coproto::AsioSocket ReceiverSocket
     )
 {
@@ -237,8 +291,10 @@ shared_ptr<ReceiverDB> create_receiver_db(
     shared_ptr<ReceiverDB> receiver_db;
     if (holds_alternative<CSVReader::UnlabeledData>(db_data)) {
         try {
-            receiver_db = make_shared<ReceiverDB>(*psu_params, 0, 0, compress);
-            receiver_db->setSocket(ReceiverSocket);
+            receiver_db = make_shared<ReceiverDB>(*psu_params, 0, 0, compress, offline_oprf);
+            if (!offline_oprf) {
+                receiver_db->setSocket(ReceiverSocket);
+            }
             receiver_db->set_data(get<CSVReader::UnlabeledData>(db_data));
 
             APSU_LOG_INFO(
@@ -258,7 +314,7 @@ shared_ptr<ReceiverDB> create_receiver_db(
     }
 
     // Read the OPRFKey and strip the ReceiverDB to reduce memory use
-    receiver_db->strip();
+    oprf_key = receiver_db->strip();
 
     APSU_LOG_INFO("ReceiverDB packing rate: " << receiver_db->get_packing_rate());
 
@@ -24,6 +24,7 @@ public:
         add(query_file_arg_);
         add(params_file_arg_);
         add(out_file_arg_);
+        add(offline_oprf_arg_);
     }
 
     virtual void get_args()
@@ -33,6 +34,7 @@ public:
         query_file_ = query_file_arg_.getValue();
         params_file_ = params_file_arg_.getValue();
         output_file_ = out_file_arg_.getValue();
+        offline_oprf_ = offline_oprf_arg_.getValue();
     }
 
     const std::string &net_addr() const
@@ -58,6 +60,11 @@ public:
     {
         return params_file_;
     }
+
+    bool offline_oprf() const
+    {
+        return offline_oprf_;
+    }
 private:
     TCLAP::ValueArg<std::string> net_addr_arg_ = TCLAP::ValueArg<std::string>(
         "a", "ipAddr", "IP address for a sender endpoint", false, "localhost", "string");
@@ -89,6 +96,14 @@ private:
         false,
         "16M-1024.json",
         "string");
+
+    TCLAP::SwitchArg offline_oprf_arg_ = TCLAP::SwitchArg(
+        "",
+        "offlineOPRF",
+        "Hash the query with an OPRF request instead of the KKRT OPRF; the receiver must serve a "
+        "ReceiverDB built with --offlineOPRF",
+        false);
+
     std::string params_file_;
 
     std::string net_addr_;
@@ -98,4 +113,6 @@ private:
     std::string query_file_;
 
     std::string output_file_;
+
+    bool offline_oprf_;
 };
@@ -121,9 +121,12 @@ int main(int argc, char *argv[])
 
 int remote_query(const CLP &cmd)
 {
-    APSU_LOG_INFO(__FILE__ << __LINE__);
-    auto SenderKKRTSocket = coproto::asioConnect("localhost:1212",false);
-    APSU_LOG_INFO(__FILE__ << __LINE__);
+    // Against a ReceiverDB in offline OPRF mode the query is hashed with an OPRF request over the
+    // ZeroMQ channel; otherwise the receiver runs the KKRT OPRF with us over a separate socket
+    coproto::AsioSocket SenderKKRTSocket;
+    if (!cmd.offline_oprf()) {
+        SenderKKRTSocket = coproto::asioConnect("localhost:1212", false);
+    }
 
 
     // Connect to the network
@@ -173,9 +176,29 @@ int remote_query(const CLP &cmd)
 
     
 
+    if (cmd.offline_oprf()) {
+        try {
+            APSU_LOG_INFO("Sending OPRF request for " << items_vec.size() << " items");
+            oprf_items = Sender::RequestOPRF(items_vec, channel).first;
+            if (oprf_items.size() != items_vec.size()) {
+                throw runtime_error("invalid OPRF response");
+            }
+            APSU_LOG_INFO("Received OPRF response for " << oprf_items.size() << " items");
+        } catch (const exception &ex) {
+            APSU_LOG_WARNING("OPRF request failed: " << ex.what());
+            return -1;
+        }
+    }
+
     try {
         APSU_LOG_INFO("Sending APSU query");
-        sender.request_query(items_without_OPRF,  channel, orig_items,SenderKKRTSocket);
+        QueryContext context;
+        if (cmd.offline_oprf()) {
+            sender.request_query(oprf_items, channel, orig_items, context);
+        } else {
+            sender.request_query(
+                items_without_OPRF, channel, orig_items, SenderKKRTSocket, context);
+        }
         APSU_LOG_INFO("Received APSU query response");
     } catch (const exception &ex) {
         APSU_LOG_WARNING("Failed sending APSU query: " << ex.what());
@@ -183,7 +206,9 @@ int remote_query(const CLP &cmd)
     }
     print_transmitted_data(channel);
     print_timing_report(sender_stopwatch);
-    SenderKKRTSocket.close();
+    if (!cmd.offline_oprf()) {
+        SenderKKRTSocket.close();
+    }
     //print_intersection_results(orig_items, items_vec, query_result, cmd.output_file());
     // print_transmitted_data(channel);
     // print_timing_report(sender_stopwatch);
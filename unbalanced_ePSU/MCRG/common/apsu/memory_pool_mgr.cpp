@@ -0,0 +1,161 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+// STD
+#include <algorithm>
+#include <list>
+#include <memory>
+#include <mutex>
+
+// APSU
+#include "apsu/memory_pool_mgr.h"
+
+using namespace std;
+using namespace seal;
+using namespace apsu;
+
+namespace {
+    struct Slot {
+        mutex mtx;
+
+        MemoryPoolHandle pool = MemoryManager::GetPool(mm_prof_opt::mm_force_new);
+    };
+
+    mutex registry_mtx;
+
+    list<shared_ptr<Slot>> registry;
+
+    size_t retention_limit = 0;
+
+    size_t high_water_byte_count = 0;
+
+    size_t trimmed_pool_count = 0;
+
+    size_t in_flight_query_count = 0;
+
+    // Must be called with registry_mtx held
+    MemoryPoolMgr::Stats collect_stats();
+
+    /**
+    Registers the slot of a thread for as long as the thread runs.
+    */
+    class ThreadSlot {
+    public:
+        ThreadSlot() : slot_(make_shared<Slot>())
+        {
+            lock_guard<mutex> lock(registry_mtx);
+            registry.push_back(slot_);
+            pos_ = prev(registry.end());
+        }
+
+        ~ThreadSlot()
+        {
+            // The pool is dropped, so record the peak it contributed to
+            lock_guard<mutex> lock(registry_mtx);
+            collect_stats();
+            registry.erase(pos_);
+        }
+
+        Slot &slot()
+        {
+            return *slot_;
+        }
+
+    private:
+        shared_ptr<Slot> slot_;
+
+        list<shared_ptr<Slot>>::iterator pos_;
+    };
+
+    // Must be called with registry_mtx held
+    MemoryPoolMgr::Stats collect_stats()
+    {
+        MemoryPoolMgr::Stats stats;
+        for (const auto &slot : registry) {
+            lock_guard<mutex> lock(slot->mtx);
+            stats.retained_byte_count += static_cast<size_t>(slot->pool.alloc_byte_count());
+        }
+        stats.pool_count = registry.size();
+
+        high_water_byte_count = max(high_water_byte_count, stats.retained_byte_count);
+        stats.high_water_byte_count = high_water_byte_count;
+        stats.trimmed_pool_count = trimmed_pool_count;
+        return stats;
+    }
+
+    // Must be called with registry_mtx held
+    MemoryPoolMgr::Stats trim()
+    {
+        MemoryPoolMgr::Stats stats = collect_stats();
+        if (!retention_limit || in_flight_query_count) {
+            return stats;
+        }
+
+        for (const auto &slot : registry) {
+            lock_guard<mutex> slot_lock(slot->mtx);
+            if (static_cast<size_t>(slot->pool.alloc_byte_count()) > retention_limit) {
+                slot->pool = MemoryManager::GetPool(mm_prof_opt::mm_force_new);
+                trimmed_pool_count++;
+            }
+        }
+
+        return stats;
+    }
+} // namespace
+
+MemoryPoolMgr::QueryScope::QueryScope()
+{
+    lock_guard<mutex> lock(registry_mtx);
+    in_flight_query_count++;
+}
+
+MemoryPoolMgr::QueryScope::~QueryScope()
+{
+    if (in_flight_) {
+        lock_guard<mutex> lock(registry_mtx);
+        in_flight_query_count--;
+    }
+}
+
+MemoryPoolMgr::Stats MemoryPoolMgr::QueryScope::end()
+{
+    lock_guard<mutex> lock(registry_mtx);
+    if (in_flight_) {
+        in_flight_query_count--;
+        in_flight_ = false;
+    }
+    return trim();
+}
+
+MemoryPoolHandle MemoryPoolMgr::GetPool()
+{
+    thread_local ThreadSlot thread_slot;
+    Slot &slot = thread_slot.slot();
+
+    lock_guard<mutex> lock(slot.mtx);
+    return slot.pool;
+}
+
+void MemoryPoolMgr::SetRetentionLimit(size_t byte_count)
+{
+    lock_guard<mutex> lock(registry_mtx);
+    retention_limit = byte_count;
+}
+
+size_t MemoryPoolMgr::GetRetentionLimit()
+{
+    lock_guard<mutex> lock(registry_mtx);
+    return retention_limit;
+}
+
+MemoryPoolMgr::Stats MemoryPoolMgr::Trim()
+{
+    lock_guard<mutex> lock(registry_mtx);
+    return trim();
+}
+
+MemoryPoolMgr::Stats MemoryPoolMgr::GetStats()
+{
+    lock_guard<mutex> lock(registry_mtx);
+    return collect_stats();
+}
@@ -0,0 +1,106 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+// STD
+#include <cstddef>
+
+// SEAL
+#include "seal/memorymanager.h"
+
+namespace apsu {
+    /**
+    Gives every thread its own SEAL memory pool that outlives individual queries, so that a thread
+    reuses the ciphertext-sized allocations of earlier queries instead of faulting in fresh pages,
+    and threads do not contend on one pool. The pools are thread-safe, so objects allocated from
+    one thread's pool may be moved to and freed on another thread.
+
+    SEAL pools never return memory while they are in use. To bound what is retained between
+    queries, Trim replaces every pool holding more than the retention limit with a new one; the old
+    pool is freed once the last object allocated from it is gone. A query marks itself in flight
+    with a QueryScope, and pools are only replaced when no query is in flight, so that no task keeps
+    allocating from a pool that has already been dropped.
+    */
+    class MemoryPoolMgr {
+    public:
+        /**
+        Memory held by the thread pools.
+        */
+        struct Stats {
+            /**
+            Number of threads that have a pool.
+            */
+            std::size_t pool_count = 0;
+
+            /**
+            Bytes currently allocated by all thread pools.
+            */
+            std::size_t retained_byte_count = 0;
+
+            /**
+            Largest retained_byte_count so far. A pool only grows until it is dropped, so the total
+            is sampled whenever a pool is dropped, by Trim or by the exit of its thread, which makes
+            this the true peak.
+            */
+            std::size_t high_water_byte_count = 0;
+
+            /**
+            Number of pools that Trim has replaced.
+            */
+            std::size_t trimmed_pool_count = 0;
+        };
+
+        /**
+        Marks a query in flight for as long as it exists.
+        */
+        class QueryScope {
+        public:
+            QueryScope();
+
+            ~QueryScope();
+
+            /**
+            Ends the query early, trims the pools if no other query is in flight, and returns the
+            stats as they were before trimming.
+            */
+            Stats end();
+
+            QueryScope(const QueryScope &copy) = delete;
+
+            QueryScope &operator=(const QueryScope &assign) = delete;
+
+        private:
+            bool in_flight_ = true;
+        };
+
+        MemoryPoolMgr() = delete;
+
+        /**
+        Returns the memory pool of the calling thread, creating it on first use.
+        */
+        static seal::MemoryPoolHandle GetPool();
+
+        /**
+        Sets how many bytes a thread pool may keep across Trim calls. Zero, the default, means no
+        limit.
+        */
+        static void SetRetentionLimit(std::size_t byte_count);
+
+        /**
+        Returns the retention limit in bytes.
+        */
+        static std::size_t GetRetentionLimit();
+
+        /**
+        Replaces every pool above the retention limit with a new one and returns the stats as
+        they were before trimming. Does not replace any pool while a query is in flight.
+        */
+        static Stats Trim();
+
+        /**
+        Returns the current stats.
+        */
+        static Stats GetStats();
+    };
+} // namespace apsu
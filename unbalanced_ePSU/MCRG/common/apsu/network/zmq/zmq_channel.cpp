@@ -102,6 +102,7 @@ namespace apsu {
             try {
                 end_point_ = end_point;
                 get_socket()->bind(end_point);
+                open_wake_sockets();
             } catch (const zmq::error_t &) {
                 APSU_LOG_ERROR("ZeroMQ failed to bind socket to endpoint " << end_point);
                 throw;
@@ -115,6 +116,7 @@ namespace apsu {
             try {
                 end_point_ = end_point;
                 get_socket()->connect(end_point);
+                open_wake_sockets();
             } catch (const zmq::error_t &) {
                 APSU_LOG_ERROR("ZeroMQ failed to connect socket to endpoint " << end_point);
                 throw;
@@ -130,6 +132,17 @@ namespace apsu {
             if (nullptr != socket_) {
                 socket_->close();
             }
+            {
+                lock_guard<mutex> lock(wake_mutex_);
+                if (nullptr != wake_send_socket_) {
+                    wake_send_socket_->close();
+                    wake_send_socket_.reset();
+                }
+            }
+            if (nullptr != wake_recv_socket_) {
+                wake_recv_socket_->close();
+                wake_recv_socket_.reset();
+            }
             if (context_) {
                 context_->shutdown();
                 context_->close();
@@ -156,6 +169,53 @@ namespace apsu {
             }
         }
 
+        void ZMQChannel::open_wake_sockets()
+        {
+            // Every channel has its own context, so the inproc endpoint name cannot clash
+            const char *wake_end_point = "inproc://apsu-channel-wake";
+
+            wake_recv_socket_ = make_unique<socket_t>(*context_.get(), zmq::socket_type::pair);
+            wake_recv_socket_->bind(wake_end_point);
+
+            lock_guard<mutex> lock(wake_mutex_);
+            wake_send_socket_ = make_unique<socket_t>(*context_.get(), zmq::socket_type::pair);
+            wake_send_socket_->connect(wake_end_point);
+        }
+
+        bool ZMQChannel::poll_for_message(chrono::milliseconds timeout)
+        {
+            throw_if_not_connected();
+
+            lock_guard<mutex> lock(receive_mutex_);
+
+            zmq_pollitem_t items[] = {
+                { static_cast<void *>(*get_socket()), 0, ZMQ_POLLIN, 0 },
+                { static_cast<void *>(*wake_recv_socket_), 0, ZMQ_POLLIN, 0 }
+            };
+            zmq::poll(items, 2, timeout);
+
+            // Consume the wake-ups that ended this wait or arrived during it
+            if (items[1].revents & ZMQ_POLLIN) {
+                message_t wake;
+                while (wake_recv_socket_->recv(wake, recv_flags::dontwait)) {
+                }
+            }
+
+            return (items[0].revents & ZMQ_POLLIN) != 0;
+        }
+
+        void ZMQChannel::interrupt_wait()
+        {
+            lock_guard<mutex> lock(wake_mutex_);
+            if (nullptr == wake_send_socket_) {
+                return;
+            }
+
+            // If the pipe is full, a wake-up is pending anyway
+            message_t wake;
+            static_cast<void>(wake_send_socket_->send(wake, send_flags::dontwait));
+        }
+
         void ZMQChannel::send(unique_ptr<ReceiverOperation> rop)
         {
             throw_if_not_connected();
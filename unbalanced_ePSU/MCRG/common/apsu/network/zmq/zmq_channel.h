@@ -4,6 +4,7 @@
 #pragma once
 
 // STD
+#include <chrono>
 #include <memory>
 #include <mutex>
 #include <type_traits>
@@ -141,6 +142,20 @@ namespace apsu {
                 return receive_network_operation(std::move(context), false, expected);
             }
 
+            /**
+            Blocks until a message can be received, the timeout expires, or another thread calls
+            interrupt_wait. Returns true if a message is ready, in which case the next receive
+            does not block. This lets a receive loop wait for requests without sleeping.
+            */
+            bool poll_for_message(std::chrono::milliseconds timeout);
+
+            /**
+            Makes a call to poll_for_message that is blocked in another thread return early. A
+            wake-up that arrives while nobody is waiting ends the next wait instead. This function
+            is thread-safe.
+            */
+            void interrupt_wait();
+
             /**
             Send a ZMQReceiverOperationResponse from a sender to a receiver. These operations
             represent a response to either a parameter request, an OPRF request, or a query request.
@@ -212,12 +227,23 @@ namespace apsu {
 
             std::unique_ptr<zmq::context_t> context_;
 
+            /**
+            An inproc socket pair that interrupt_wait uses to wake up poll_for_message.
+            */
+            std::unique_ptr<zmq::socket_t> wake_recv_socket_;
+
+            std::unique_ptr<zmq::socket_t> wake_send_socket_;
+
+            std::mutex wake_mutex_;
+
             std::unique_ptr<zmq::socket_t> &get_socket();
 
             void throw_if_not_connected() const;
 
             void throw_if_connected() const;
 
+            void open_wake_sockets();
+
             bool receive_message(zmq::multipart_t &msg, bool wait_for_message = true);
 
             void send_message(zmq::multipart_t &msg);
@@ -109,6 +109,10 @@ namespace apsu {
             item_params_.felts_per_item > ItemParams::felts_per_item_max) {
             throw invalid_argument("felts_per_item is too large or too small");
         }
+        if (item_params_.mask_bit_count < ItemParams::mask_bit_count_min ||
+            item_params_.mask_bit_count > ItemParams::mask_bit_count_max) {
+            throw invalid_argument("mask_bit_count is too large or too small");
+        }
         if (query_params_.ps_low_degree > table_params_.max_items_per_bin) {
             throw invalid_argument("ps_low_degree cannot be larger than max_items_per_bin");
         }
@@ -155,6 +159,11 @@ namespace apsu {
             throw invalid_argument("parameters result in too large or too small item_bit_count");
         }
 
+        // The mask is packed from the low bits of the field elements, so it must fit in the item
+        if (item_params_.mask_bit_count > item_bit_count_) {
+            throw invalid_argument("mask_bit_count is larger than the item can hold");
+        }
+
         // Compute how many items fit into a bundle. If felts_per_item is not a power of two, then
         // we will simply leave a few of the batching slots unused instead of splitting items across
         // multiple SEAL batches.
@@ -183,7 +192,7 @@ namespace apsu {
     {
         flatbuffers::FlatBufferBuilder fbs_builder(128);
 
-        fbs::ItemParams item_params(item_params_.felts_per_item);
+        fbs::ItemParams item_params(item_params_.felts_per_item, item_params_.mask_bit_count);
 
         fbs::TableParams table_params(
             table_params_.table_size,
@@ -249,6 +258,7 @@ namespace apsu {
 
         PSUParams::ItemParams item_params;
         item_params.felts_per_item = psu_params->item_params()->felts_per_item();
+        item_params.mask_bit_count = psu_params->item_params()->mask_bit_count();
 
         PSUParams::TableParams table_params;
         table_params.table_size = psu_params->table_params()->table_size();
@@ -312,6 +322,9 @@ namespace apsu {
         try {
             const auto &json_item_params = get_non_null_json_value(root, "item_params");
             item_params.felts_per_item = json_value_ui32(json_item_params, "felts_per_item");
+            if (json_item_params.isMember("mask_bit_count")) {
+                item_params.mask_bit_count = json_value_ui32(json_item_params, "mask_bit_count");
+            }
         } catch (const exception &ex) {
             APSU_LOG_ERROR("Failed to load item_params from JSON string: " << ex.what());
             throw;
@@ -382,6 +395,7 @@ namespace apsu {
     {
         stringstream ss;
         ss << "item_params.felts_per_item: " << item_params_.felts_per_item
+           << "; item_params.mask_bit_count: " << item_params_.mask_bit_count
            << "; table_params.table_size: " << table_params_.table_size
            << "; table_params.max_items_per_bin: " << table_params_.max_items_per_bin
            << "; table_params.hash_func_count: " << table_params_.hash_func_count
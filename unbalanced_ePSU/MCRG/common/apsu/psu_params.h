@@ -52,10 +52,25 @@ namespace apsu {
 
             constexpr static std::uint32_t felts_per_item_min = 2;
 
+            constexpr static std::uint32_t mask_bit_count_max = 64;
+
+            constexpr static std::uint32_t mask_bit_count_min = 40;
+
+            constexpr static std::uint32_t mask_bit_count_default = 64;
+
             /**
             Specified how many SEAL batching slots are occupied by an item.
             */
             std::uint32_t felts_per_item;
+
+            /**
+            Specifies the bit width of the random masks produced by MCRG and consumed by pnECRG.
+            Only the first ceil(mask_bit_count / (plain_modulus.bit_count() - 1)) field elements of
+            each item contribute to the mask; the remaining slots are still masked in the encrypted
+            result, but are never stored or compared. pnECRG rejects a width below 40 plus log2 of
+            the number of masks it compares; mask_bit_count_min is that bound for a single mask.
+            */
+            std::uint32_t mask_bit_count = mask_bit_count_default;
         };
 
         /**
@@ -19,7 +19,7 @@ using namespace seal::util;
 namespace apsu {
     namespace util {
         namespace {
-            uint64_t read_u64_little_endian(const array<unsigned char, 8> &bytes)
+            uint64_t read_u64_little_endian(const unsigned char *bytes)
             {
                 uint64_t val = 0;
                 val |= static_cast<uint64_t>(bytes[0]);
@@ -34,6 +34,11 @@ namespace apsu {
                 return val;
             }
 
+            uint64_t read_u64_little_endian(const array<unsigned char, 8> &bytes)
+            {
+                return read_u64_little_endian(bytes.data());
+            }
+
             array<unsigned char, 8> write_u64_little_endian(uint64_t num)
             {
                 array<unsigned char, 8> bytes;
@@ -260,6 +265,86 @@ namespace apsu {
             return bits_to_field_elts(BitstringView<const unsigned char>(bits), mod);
         }
 
+        uint32_t field_elt_count(uint32_t bit_count, const Modulus &mod)
+        {
+            if (mod.is_zero()) {
+                throw invalid_argument("mod cannot be zero");
+            }
+
+            uint32_t bits_per_felt = static_cast<uint32_t>(mod.bit_count() - 1);
+            return (bit_count + bits_per_felt - 1) / bits_per_felt;
+        }
+
+        void bits_to_field_elts(
+            gsl::span<const unsigned char> bits,
+            uint32_t bit_count,
+            const Modulus &mod,
+            gsl::span<felt_t> felts)
+        {
+            constexpr size_t bitstring_byte_count = sizeof(Item::value_type);
+            static_assert(bitstring_byte_count == 16, "bitstrings must be made of two words");
+
+            if (!bit_count || bit_count > bitstring_byte_count * 8) {
+                throw invalid_argument("bit_count must be between 1 and 128");
+            }
+            if (static_cast<size_t>(bits.size()) % bitstring_byte_count) {
+                throw invalid_argument("bits must hold a whole number of bitstrings");
+            }
+
+            uint32_t num_felts = field_elt_count(bit_count, mod);
+            uint32_t bits_per_felt = static_cast<uint32_t>(mod.bit_count() - 1);
+            size_t bitstring_count = static_cast<size_t>(bits.size()) / bitstring_byte_count;
+            if (static_cast<size_t>(felts.size()) != bitstring_count * num_felts) {
+                throw invalid_argument("felts has the wrong size");
+            }
+
+            // The bitstrings are converted in blocks. First the two little-endian words of every
+            // bitstring in the block are read; then each field element is cut out of the words of
+            // all bitstrings with the same shift and mask. The inner loops have no data-dependent
+            // branches, so the compiler can vectorize them.
+            constexpr size_t block_size = 64;
+            array<uint64_t, block_size> low_words;
+            array<uint64_t, block_size> high_words;
+            for (size_t block_begin = 0; block_begin < bitstring_count;
+                 block_begin += block_size) {
+                size_t block_count = min(block_size, bitstring_count - block_begin);
+                const unsigned char *block_bits =
+                    bits.data() + block_begin * bitstring_byte_count;
+                felt_t *block_felts = felts.data() + block_begin * num_felts;
+
+                for (size_t i = 0; i < block_count; i++) {
+                    const unsigned char *bitstring = block_bits + i * bitstring_byte_count;
+                    low_words[i] = read_u64_little_endian(bitstring);
+                    high_words[i] = read_u64_little_endian(bitstring + 8);
+                }
+
+                for (uint32_t j = 0; j < num_felts; j++) {
+                    // Field element j holds bits [offset, offset + width) of the bitstring. Since
+                    // width < 64, the field element spans at most the two words.
+                    uint32_t offset = j * bits_per_felt;
+                    uint32_t width = min(bits_per_felt, bit_count - offset);
+                    uint64_t mask = (uint64_t(1) << width) - 1;
+
+                    if (offset >= 64) {
+                        uint32_t shift = offset - 64;
+                        for (size_t i = 0; i < block_count; i++) {
+                            block_felts[i * num_felts + j] = (high_words[i] >> shift) & mask;
+                        }
+                    } else if (offset == 0) {
+                        for (size_t i = 0; i < block_count; i++) {
+                            block_felts[i * num_felts + j] = low_words[i] & mask;
+                        }
+                    } else {
+                        for (size_t i = 0; i < block_count; i++) {
+                            block_felts[i * num_felts + j] =
+                                ((low_words[i] >> offset) | (high_words[i] << (64 - offset))) &
+                                mask;
+                        }
+                    }
+                }
+            }
+        }
+
         Bitstring field_elts_to_bits(
             gsl::span<const felt_t> felts, uint32_t bit_count, const Modulus &mod)
         {
@@ -360,9 +445,26 @@ namespace apsu {
         AlgItem algebraize_item(const HashedItem &item, size_t item_bit_count, const Modulus &mod)
         {
             // Convert the item from to a sequence of field elements. This is the "algebraic item".
-            BitstringView<const unsigned char> item_bsw(
-                item.get_as<const unsigned char>(), safe_cast<uint32_t>(item_bit_count));
-            return bits_to_field_elts(item_bsw, mod);
+            uint32_t bit_count = safe_cast<uint32_t>(item_bit_count);
+            AlgItem alg_item(field_elt_count(bit_count, mod));
+            algebraize_items({ &item, 1 }, item_bit_count, mod, alg_item);
+            return alg_item;
+        }
+
+        void algebraize_items(
+            gsl::span<const HashedItem> items,
+            size_t item_bit_count,
+            const Modulus &mod,
+            gsl::span<felt_t> felts)
+        {
+            static_assert(
+                sizeof(HashedItem) == sizeof(Item::value_type),
+                "HashedItem must hold nothing but its value");
+
+            gsl::span<const unsigned char> bits(
+                reinterpret_cast<const unsigned char *>(items.data()),
+                static_cast<size_t>(items.size()) * sizeof(HashedItem));
+            bits_to_field_elts(bits, safe_cast<uint32_t>(item_bit_count), mod, felts);
         }
 
         HashedItem dealgebraize_item(const AlgItem &item, size_t item_bit_count, const Modulus &mod)
@@ -371,6 +473,38 @@ namespace apsu {
             return HashedItem(bits.to_view());
         }
 
+        uint64_t field_elts_to_mask(
+            gsl::span<const felt_t> felts, uint32_t mask_bit_count, const Modulus &mod)
+        {
+            if (!mask_bit_count || mask_bit_count > 64) {
+                throw invalid_argument("mask_bit_count must be between 1 and 64");
+            }
+            if (mod.is_zero()) {
+                throw invalid_argument("mod cannot be zero");
+            }
+
+            // The top bit of a field element is almost always zero (e.g. it is set only for 65536
+            // modulo 65537), so it is dropped; the low bits of a uniformly random field element are
+            // close to uniform and every bit of the mask carries entropy.
+            uint32_t bits_per_felt = static_cast<uint32_t>(mod.bit_count() - 1);
+            uint64_t felt_mask = (uint64_t(1) << bits_per_felt) - 1;
+
+            uint64_t mask = 0;
+            uint32_t filled_bits = 0;
+            for (const felt_t &felt : felts) {
+                if (filled_bits >= mask_bit_count) {
+                    break;
+                }
+                mask |= (felt & felt_mask) << filled_bits;
+                filled_bits += bits_per_felt;
+            }
+            if (filled_bits < mask_bit_count) {
+                throw invalid_argument("mask_bit_count exceeds the max number of bits the input holds");
+            }
+
+            return (mask_bit_count == 64) ? mask : mask & ((uint64_t(1) << mask_bit_count) - 1);
+        }
+
         EncryptedLabel dealgebraize_label(
             const AlgLabel &label, size_t label_bit_count, const Modulus &mod)
         {
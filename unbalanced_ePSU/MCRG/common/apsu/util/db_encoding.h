@@ -48,12 +48,40 @@ namespace apsu {
         std::vector<felt_t> bits_to_field_elts(
             BitstringView<unsigned char> bits, const seal::Modulus &mod);
 
+        /**
+        Returns the number of field elements (modulo `mod`) that bits_to_field_elts produces for a
+        bitstring of bit_count bits.
+        */
+        std::uint32_t field_elt_count(std::uint32_t bit_count, const seal::Modulus &mod);
+
+        /**
+        Converts a batch of bitstrings to field elements (modulo `mod`). The bitstrings are stored
+        back to back in bits, each in sizeof(Item::value_type) bytes of which the first bit_count
+        bits are used. The field elements of the i-th bitstring are written to
+        felts[i * n], ..., felts[i * n + n - 1], where n = field_elt_count(bit_count, mod); they are
+        the same as those returned by bits_to_field_elts for the single bitstring.
+        */
+        void bits_to_field_elts(
+            gsl::span<const unsigned char> bits,
+            std::uint32_t bit_count,
+            const seal::Modulus &mod,
+            gsl::span<felt_t> felts);
+
         /**
         Converts the given field elements (modulo `mod`) to a bitstring.
         */
         Bitstring field_elts_to_bits(
             gsl::span<const felt_t> felts, std::uint32_t bit_count, const seal::Modulus &mod);
 
+        /**
+        Packs the first mask_bit_count bits of the given field elements (modulo `mod`) into a
+        single word. Every field element contributes its low mod.bit_count() - 1 bits, which are
+        close to uniform for uniformly random field elements; only as many field elements as
+        needed are read.
+        */
+        std::uint64_t field_elts_to_mask(
+            gsl::span<const felt_t> felts, std::uint32_t mask_bit_count, const seal::Modulus &mod);
+
         /**
         Converts an item and label into a sequence of (felt_t, felt_t) pairs, where the the first
         pair value is a chunk of the item, and the second is a chunk of the label. item_bit_count
@@ -75,6 +103,17 @@ namespace apsu {
         AlgItem algebraize_item(
             const HashedItem &item, std::size_t item_bit_count, const seal::Modulus &mod);
 
+        /**
+        Converts a batch of items as algebraize_item does, writing the field elements of the i-th
+        item to felts[i * n], ..., felts[i * n + n - 1], where n = field_elt_count(item_bit_count,
+        mod).
+        */
+        void algebraize_items(
+            gsl::span<const HashedItem> items,
+            std::size_t item_bit_count,
+            const seal::Modulus &mod,
+            gsl::span<felt_t> felts);
+
         /**
         Converts a sequence of field elements into a HashedItem. This will throw an invalid_argument
         if too many field elements are given, i.e., if modulus_bitlen * num_elements > 128.
@@ -4,6 +4,9 @@
 // STD
 #include <algorithm>
 #include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 
 // APSU
@@ -11,6 +14,8 @@
 #include "apsu/util/interpolate.h"
 
 // SEAL
+#include "seal/util/ntt.h"
+#include "seal/util/numth.h"
 #include "seal/util/uintarithsmallmod.h"
 
 using namespace std;
@@ -55,28 +60,144 @@ namespace apsu {
             polyn[0] = multiply_uint_mod(polyn[0], neg_a, mod);
         }
 
+        namespace {
+            /**
+            Roots per leaf of the product tree in polyn_with_roots. A leaf is expanded one root at
+            a time, which is the fastest way to build a polynomial of this size.
+            */
+            constexpr size_t product_tree_leaf_size = 32;
+
+            /**
+            Products of at least this degree are computed with the NTT, when the modulus allows it.
+            Below it, schoolbook multiplication does less work.
+            */
+            constexpr size_t ntt_mul_min_degree = 128;
+
+            /**
+            Returns the NTT tables of size 2^coeff_count_power for the given modulus, or nullptr
+            if the modulus has no 2^(coeff_count_power+1)-th root of unity. A batching plain
+            modulus always has one up to twice the polynomial modulus degree. The tables are
+            created once and shared by all threads and bins.
+            */
+            shared_ptr<const NTTTables> get_ntt_tables(int coeff_count_power, const Modulus &mod)
+            {
+                static mutex tables_mtx;
+                static map<pair<int, uint64_t>, shared_ptr<const NTTTables>> all_tables;
+
+                lock_guard<mutex> lock(tables_mtx);
+                auto key = make_pair(coeff_count_power, mod.value());
+                auto it = all_tables.find(key);
+                if (it != all_tables.end()) {
+                    return it->second;
+                }
+
+                shared_ptr<const NTTTables> tables;
+                uint64_t root = 0;
+                if (mod.is_prime() &&
+                    try_minimal_primitive_root(uint64_t(2) << coeff_count_power, mod, root)) {
+                    tables = make_shared<NTTTables>(coeff_count_power, mod);
+                }
+                all_tables.emplace(key, tables);
+
+                return tables;
+            }
+
+            vector<uint64_t> polyn_mul_schoolbook(
+                const vector<uint64_t> &a, const vector<uint64_t> &b, const Modulus &mod)
+            {
+                vector<uint64_t> result(a.size() + b.size() - 1, 0);
+                for (size_t i = 0; i < a.size(); i++) {
+                    MultiplyUIntModOperand a_i;
+                    a_i.set(a[i], mod);
+                    for (size_t j = 0; j < b.size(); j++) {
+                        result[i + j] = multiply_add_uint_mod(b[j], a_i, result[i + j], mod);
+                    }
+                }
+
+                return result;
+            }
+
+            /**
+            Multiplies two polynomials with a negacyclic NTT of a size larger than the degree of
+            the product, so that the product does not wrap around.
+            */
+            vector<uint64_t> polyn_mul_ntt(
+                const vector<uint64_t> &a, const vector<uint64_t> &b, const NTTTables &tables)
+            {
+                size_t coeff_count = tables.coeff_count();
+                const Modulus &mod = tables.modulus();
+
+                vector<uint64_t> a_ntt(coeff_count, 0);
+                vector<uint64_t> b_ntt(coeff_count, 0);
+                copy(a.begin(), a.end(), a_ntt.begin());
+                copy(b.begin(), b.end(), b_ntt.begin());
+                ntt_negacyclic_harvey(a_ntt.data(), tables);
+                ntt_negacyclic_harvey(b_ntt.data(), tables);
+
+                for (size_t i = 0; i < coeff_count; i++) {
+                    a_ntt[i] = multiply_uint_mod(a_ntt[i], b_ntt[i], mod);
+                }
+                inverse_ntt_negacyclic_harvey(a_ntt.data(), tables);
+
+                a_ntt.resize(a.size() + b.size() - 1);
+                return a_ntt;
+            }
+
+            vector<uint64_t> polyn_mul(
+                const vector<uint64_t> &a, const vector<uint64_t> &b, const Modulus &mod)
+            {
+                size_t product_coeff_count = a.size() + b.size() - 1;
+                if (product_coeff_count > ntt_mul_min_degree) {
+                    int coeff_count_power = 1;
+                    while ((size_t(1) << coeff_count_power) < product_coeff_count) {
+                        coeff_count_power++;
+                    }
+                    if (auto tables = get_ntt_tables(coeff_count_power, mod)) {
+                        return polyn_mul_ntt(a, b, *tables);
+                    }
+                }
+
+                return polyn_mul_schoolbook(a, b, mod);
+            }
+
+            /**
+            Returns (x-a₁)*...*(x-aₛ) for the s roots starting at roots. The roots are split in
+            halves whose products are multiplied, so that large products are computed with the
+            NTT; this takes O(s log² s) operations instead of O(s²).
+            */
+            vector<uint64_t> polyn_with_roots_tree(
+                const uint64_t *roots, size_t root_count, const Modulus &mod)
+            {
+                if (root_count <= product_tree_leaf_size) {
+                    vector<uint64_t> polyn;
+                    polyn.reserve(root_count + 1);
+                    polyn.push_back(1);
+                    for (size_t i = 0; i < root_count; i++) {
+                        polyn_mul_monic_monomial_inplace(polyn, roots[i], mod);
+                    }
+                    return polyn;
+                }
+
+                size_t half = root_count / 2;
+                return polyn_mul(
+                    polyn_with_roots_tree(roots, half, mod),
+                    polyn_with_roots_tree(roots + half, root_count - half, mod),
+                    mod);
+            }
+        } // namespace
+
         /**
         Given a set of distinct field elements a₁, ..., aₛ, returns the coefficients of the unique
         monic polynoimial P with roots a₁, ..., aₛ. Concretely, P = (x-a₁)*...*(x-aₛ). The returned
         coefficients are in degree-ascending order. That is, polyn[0] is the constant term.
         */
-        vector<uint64_t> polyn_with_roots(const vector<uint64_t> &roots, const Modulus &mod)
+        vector<uint64_t> polyn_with_roots(gsl::span<const uint64_t> roots, const Modulus &mod)
         {
             if (mod.is_zero()) {
                 throw invalid_argument("mod cannot be zero");
             }
 
-            // Start with P = 1 = 1 + 0x + 0x^2 + ...
-            vector<uint64_t> polyn;
-            polyn.reserve(roots.size() + 1);
-            polyn.push_back(1);
-
-            // For every root a, let P *= (x - a)
-            for (uint64_t root : roots) {
-                polyn_mul_monic_monomial_inplace(polyn, root, mod);
-            }
-
-            return polyn;
+            return polyn_with_roots_tree(roots.data(), static_cast<size_t>(roots.size()), mod);
         }
 
         /**
@@ -85,7 +206,7 @@ namespace apsu {
         for all i.
         */
         vector<uint64_t> newton_interpolate_polyn(
-            const vector<uint64_t> &points, const vector<uint64_t> &values, const Modulus &mod)
+            gsl::span<const uint64_t> points, gsl::span<const uint64_t> values, const Modulus &mod)
         {
             if (points.size() != values.size()) {
                 throw invalid_argument(
@@ -95,9 +216,9 @@ namespace apsu {
                 throw invalid_argument("mod must be prime");
             }
 
-            auto size = points.size();
+            auto size = static_cast<size_t>(points.size());
 
-            bool all_zeros = all_of(values.cbegin(), values.cend(), [](auto a) { return a == 0; });
+            bool all_zeros = all_of(values.begin(), values.end(), [](auto a) { return a == 0; });
             if (all_zeros) {
                 // Return a vector of all zeros
                 return vector<uint64_t>(max<size_t>(size, 1));
@@ -30,7 +30,7 @@ namespace apsu {
         coefficients are in degree-ascending order. That is, polyn[0] is the constant term.
         */
         std::vector<std::uint64_t> polyn_with_roots(
-            const std::vector<std::uint64_t> &roots, const seal::Modulus &mod);
+            gsl::span<const std::uint64_t> roots, const seal::Modulus &mod);
 
         /**
         Returns the Newton interpolation of the given points and values. Specifically, this function
@@ -38,8 +38,8 @@ namespace apsu {
         valueᵢ for all i.
         */
         std::vector<std::uint64_t> newton_interpolate_polyn(
-            const std::vector<std::uint64_t> &points,
-            const std::vector<std::uint64_t> &values,
+            gsl::span<const std::uint64_t> points,
+            gsl::span<const std::uint64_t> values,
             const seal::Modulus &mod);
     } // namespace util
 } // namespace apsu
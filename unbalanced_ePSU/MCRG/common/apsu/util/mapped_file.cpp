@@ -0,0 +1,61 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+// STD
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+// APSU
+#include "apsu/log.h"
+#include "apsu/util/mapped_file.h"
+
+// POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace apsu {
+    namespace util {
+        MappedFile::MappedFile(const string &path)
+        {
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                APSU_LOG_ERROR("Failed to open " << path << ": " << strerror(errno));
+                throw runtime_error("failed to map file");
+            }
+
+            struct stat st;
+            if (fstat(fd, &st) < 0) {
+                APSU_LOG_ERROR("Failed to read the size of " << path << ": " << strerror(errno));
+                close(fd);
+                throw runtime_error("failed to map file");
+            }
+            size_ = static_cast<size_t>(st.st_size);
+
+            // An empty file cannot be mapped; it simply has no data
+            if (size_) {
+                void *addr = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+                if (MAP_FAILED == addr) {
+                    APSU_LOG_ERROR("Failed to map " << path << ": " << strerror(errno));
+                    close(fd);
+                    throw runtime_error("failed to map file");
+                }
+                data_ = static_cast<const unsigned char *>(addr);
+            }
+
+            // The mapping stays valid after the file is closed
+            close(fd);
+        }
+
+        MappedFile::~MappedFile()
+        {
+            if (data_) {
+                munmap(const_cast<unsigned char *>(data_), size_);
+            }
+        }
+    } // namespace util
+} // namespace apsu
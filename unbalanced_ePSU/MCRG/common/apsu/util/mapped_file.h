@@ -0,0 +1,57 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+// STD
+#include <cstddef>
+#include <string>
+
+// GSL
+#include "gsl/span"
+
+namespace apsu {
+    namespace util {
+        /**
+        A file mapped read-only into memory. The pages are read from the file only when they are
+        first accessed, and the operating system can drop them again under memory pressure, so
+        data kept as views into a MappedFile costs no heap memory. The mapping is shared: the file
+        must not be modified or truncated while it is mapped.
+        */
+        class MappedFile {
+        public:
+            /**
+            Maps the whole file at the given path. Throws std::runtime_error if the file cannot be
+            opened or mapped.
+            */
+            explicit MappedFile(const std::string &path);
+
+            ~MappedFile();
+
+            MappedFile(const MappedFile &copy) = delete;
+
+            MappedFile &operator=(const MappedFile &assign) = delete;
+
+            /**
+            Returns the contents of the file.
+            */
+            gsl::span<const unsigned char> data() const noexcept
+            {
+                return { data_, size_ };
+            }
+
+            /**
+            Returns the size of the file in bytes.
+            */
+            std::size_t size() const noexcept
+            {
+                return size_;
+            }
+
+        private:
+            const unsigned char *data_ = nullptr;
+
+            std::size_t size_ = 0;
+        }; // class MappedFile
+    }      // namespace util
+} // namespace apsu
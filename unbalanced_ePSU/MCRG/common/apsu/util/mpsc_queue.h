@@ -0,0 +1,125 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+// STD
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace apsu {
+    namespace util {
+        /**
+        A bounded first-in first-out queue that any number of threads push to and a single thread
+        pops from. Neither side takes a lock: every slot carries a sequence number that tells
+        whether it is free for the producer holding the matching ticket or full for the consumer
+        (D. Vyukov's bounded queue). A push that finds the queue full and a pop that finds it empty
+        fail immediately; waiting is left to the caller.
+        */
+        template <typename T>
+        class MPSCQueue {
+        public:
+            /**
+            Creates a queue holding at least capacity elements; the capacity is rounded up to a
+            power of two.
+            */
+            explicit MPSCQueue(std::size_t capacity)
+            {
+                std::size_t cell_count = 1;
+                while (cell_count < capacity) {
+                    cell_count <<= 1;
+                }
+                cells_.reset(new Cell[cell_count]);
+                mask_ = cell_count - 1;
+                for (std::size_t i = 0; i < cell_count; i++) {
+                    cells_[i].seq.store(i, std::memory_order_relaxed);
+                }
+            }
+
+            MPSCQueue(const MPSCQueue &) = delete;
+
+            MPSCQueue &operator=(const MPSCQueue &) = delete;
+
+            /**
+            Moves value to the back of the queue and returns true, or returns false and leaves
+            value untouched if the queue is full. This can be called from any thread.
+            */
+            bool try_push(T &value)
+            {
+                std::size_t pos = tail_.load(std::memory_order_relaxed);
+                Cell *cell;
+                while (true) {
+                    cell = &cells_[pos & mask_];
+                    std::size_t seq = cell->seq.load(std::memory_order_acquire);
+                    auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+                    if (diff == 0) {
+                        // The cell is free; claim it by taking the ticket
+                        if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                            break;
+                        }
+                    } else if (diff < 0) {
+                        // The cell still holds the element pushed one lap earlier
+                        return false;
+                    } else {
+                        // Another producer took this ticket
+                        pos = tail_.load(std::memory_order_relaxed);
+                    }
+                }
+
+                cell->value = std::move(value);
+                cell->seq.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+
+            /**
+            Moves the front of the queue to value and returns true, or returns false if the queue
+            is empty. Only the consumer thread may call this.
+            */
+            bool try_pop(T &value)
+            {
+                Cell &cell = cells_[head_ & mask_];
+                if (cell.seq.load(std::memory_order_acquire) != head_ + 1) {
+                    return false;
+                }
+
+                value = std::move(cell.value);
+                cell.seq.store(head_ + mask_ + 1, std::memory_order_release);
+                head_++;
+                return true;
+            }
+
+            /**
+            Returns whether the next try_pop would fail. Only the consumer thread may call this.
+            */
+            bool empty() const
+            {
+                return cells_[head_ & mask_].seq.load(std::memory_order_acquire) != head_ + 1;
+            }
+
+            std::size_t capacity() const
+            {
+                return mask_ + 1;
+            }
+
+        private:
+            struct Cell {
+                std::atomic<std::size_t> seq;
+
+                T value;
+            };
+
+            std::unique_ptr<Cell[]> cells_;
+
+            std::size_t mask_ = 0;
+
+            // Next ticket for producers
+            std::atomic<std::size_t> tail_{ 0 };
+
+            // Next cell to pop; touched by the consumer only
+            std::size_t head_ = 0;
+        }; // class MPSCQueue
+    }      // namespace util
+} // namespace apsu
@@ -0,0 +1,94 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+// STD
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <utility>
+
+// APSU
+#include "apsu/util/thread_pool.h"
+
+namespace apsu {
+    namespace util {
+        /**
+        Runs a set of tasks on a ThreadPool, where a running task may add further tasks to the set.
+        This expresses a task graph without blocking pool threads: instead of waiting for its
+        inputs, a task is added by whichever task completes its last input. TaskGroup::wait runs
+        pending pool tasks until every task of the group has finished, and rethrows the first
+        exception any of them threw; tasks that have not started by then are skipped.
+        */
+        class TaskGroup {
+        public:
+            explicit TaskGroup(ThreadPool &pool) : pool_(pool)
+            {}
+
+            TaskGroup(const TaskGroup &) = delete;
+
+            TaskGroup &operator=(const TaskGroup &) = delete;
+
+            ~TaskGroup()
+            {
+                pool_.help_while([this]() { return pending_ != 0; });
+            }
+
+            /**
+            Adds a task to the group. This can be called from within a task of the same group.
+            */
+            template <typename Func>
+            void run(Func &&func)
+            {
+                pending_++;
+
+                pool_.submit([this, func = std::forward<Func>(func)]() mutable {
+                    try {
+                        if (!failed_) {
+                            func();
+                        }
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock(error_mtx_);
+                        if (!error_) {
+                            error_ = std::current_exception();
+                        }
+                        failed_ = true;
+                    }
+
+                    // This is the last access to the group; wait may return right after
+                    pending_--;
+                });
+            }
+
+            /**
+            Waits for every task in the group, including those added while waiting. The group
+            is empty afterwards and can be reused, even if a task threw.
+            */
+            void wait()
+            {
+                pool_.help_while([this]() { return pending_ != 0; });
+
+                std::lock_guard<std::mutex> lock(error_mtx_);
+                failed_ = false;
+                if (error_) {
+                    std::exception_ptr error = error_;
+                    error_ = nullptr;
+                    std::rethrow_exception(error);
+                }
+            }
+
+        private:
+            ThreadPool &pool_;
+
+            std::atomic<std::size_t> pending_{ 0 };
+
+            std::atomic<bool> failed_{ false };
+
+            std::mutex error_mtx_;
+
+            std::exception_ptr error_;
+        }; // class TaskGroup
+    }      // namespace util
+} // namespace apsu
@@ -22,21 +22,28 @@
 //
 // Modified for log4cplus, copyright (c) 2014-2015 Václav Zeman.
 // Modified for APSU: Copyright (c) Microsoft Corporation. All rights reserved.
+// Rewritten for APSU as a work-stealing pool.
 
 #pragma once
 
 // STD
 #include <algorithm>
+#include <array>
 #include <atomic>
-#include <cassert>
+#include <chrono>
 #include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
 #include <functional>
 #include <future>
 #include <memory>
 #include <mutex>
-#include <queue>
+#include <new>
 #include <stdexcept>
 #include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 // APSU
@@ -54,215 +61,586 @@
 
 namespace apsu {
     namespace util {
+        /**
+        A move-only void() callable. Callables of up to inline_size bytes are stored in the object
+        itself, so queueing them does not allocate; larger ones are stored on the heap.
+        */
+        class Task {
+        public:
+            static constexpr std::size_t inline_size = 64;
+
+            Task() = default;
+
+            template <
+                class F,
+                typename = std::enable_if_t<!std::is_same<std::decay_t<F>, Task>::value>>
+            Task(F &&f)
+            {
+                using Fn = std::decay_t<F>;
+                construct<Fn>(
+                    std::forward<F>(f),
+                    std::integral_constant<
+                        bool,
+                        sizeof(Fn) <= inline_size &&
+                            alignof(Fn) <= alignof(std::max_align_t) &&
+                            std::is_nothrow_move_constructible<Fn>::value>{});
+            }
+
+            Task(Task &&source) noexcept
+            {
+                *this = std::move(source);
+            }
+
+            Task &operator=(Task &&assign) noexcept
+            {
+                if (this != &assign) {
+                    reset();
+                    if (assign.ops_) {
+                        assign.ops_->move(storage_, assign.storage_);
+                        ops_ = assign.ops_;
+                        assign.reset();
+                    }
+                }
+                return *this;
+            }
+
+            Task(const Task &copy) = delete;
+
+            Task &operator=(const Task &assign) = delete;
 
+            ~Task()
+            {
+                reset();
+            }
+
+            void operator()()
+            {
+                ops_->invoke(storage_);
+            }
+
+            explicit operator bool() const noexcept
+            {
+                return ops_ != nullptr;
+            }
+
+        private:
+            struct Ops {
+                void (*invoke)(void *);
+
+                // Move-constructs into dst and leaves src to be destroyed
+                void (*move)(void *dst, void *src);
+
+                void (*destroy)(void *);
+            };
+
+            template <class Fn>
+            static const Ops *inline_ops()
+            {
+                static const Ops ops{
+                    [](void *p) { (*static_cast<Fn *>(p))(); },
+                    [](void *dst, void *src) {
+                        new (dst) Fn(std::move(*static_cast<Fn *>(src)));
+                    },
+                    [](void *p) { static_cast<Fn *>(p)->~Fn(); }
+                };
+                return &ops;
+            }
+
+            template <class Fn>
+            static const Ops *heap_ops()
+            {
+                static const Ops ops{
+                    [](void *p) { (**static_cast<Fn **>(p))(); },
+                    [](void *dst, void *src) {
+                        *static_cast<Fn **>(dst) = *static_cast<Fn **>(src);
+                        *static_cast<Fn **>(src) = nullptr;
+                    },
+                    [](void *p) { delete *static_cast<Fn **>(p); }
+                };
+                return &ops;
+            }
+
+            template <class Fn, class F>
+            void construct(F &&f, std::true_type)
+            {
+                new (storage_) Fn(std::forward<F>(f));
+                ops_ = inline_ops<Fn>();
+            }
+
+            template <class Fn, class F>
+            void construct(F &&f, std::false_type)
+            {
+                *reinterpret_cast<Fn **>(storage_) = new Fn(std::forward<F>(f));
+                ops_ = heap_ops<Fn>();
+            }
+
+            void reset() noexcept
+            {
+                if (ops_) {
+                    ops_->destroy(storage_);
+                    ops_ = nullptr;
+                }
+            }
+
+            alignas(std::max_align_t) unsigned char storage_[inline_size];
+
+            const Ops *ops_ = nullptr;
+        }; // class Task
+
+        /**
+        A work-stealing thread pool. Every worker has its own deque: a task submitted by a worker
+        goes to the back of that worker's deque, the worker takes its own tasks from the back, and
+        idle workers steal from the front of the other deques. Tasks submitted from outside the pool
+        go to a shared queue. Since workers mostly touch only their own deque, fine-grained tasks do
+        not all contend on one lock.
+
+        A thread waiting for pool work through get, help_while, or parallel_for runs pending tasks
+        in the meantime. Tasks can therefore wait for the tasks they submit without tying up the
+        pool, and the waiting thread, pool worker or not, helps with the work.
+        */
         class ThreadPool {
         public:
+            static constexpr std::size_t max_thread_count = 1024;
+
             explicit ThreadPool(
                 std::size_t threads = (std::max)(2u, std::thread::hardware_concurrency()));
+
+            ThreadPool(const ThreadPool &copy) = delete;
+
+            ThreadPool &operator=(const ThreadPool &assign) = delete;
+
+            /**
+            Runs the remaining tasks and joins the workers.
+            */
+            ~ThreadPool();
+
+            /**
+            Submits a task and returns a future for its result.
+            */
             template <class F, class... Args>
             auto enqueue(F &&f, Args &&... args) -> std::future<apsu_result_of_type>;
-            void wait_until_empty();
+
+            /**
+            Submits a task without a future. Nothing is allocated for callables of up to
+            Task::inline_size bytes. An exception thrown by the task is logged and dropped.
+            */
+            template <class F>
+            void submit(F &&f);
+
+            /**
+            Runs one pending task on the calling thread, if there is one. Returns whether a task
+            was run.
+            */
+            bool run_pending_task();
+
+            /**
+            Runs pending tasks on the calling thread for as long as keep_waiting returns true.
+            */
+            template <class Pred>
+            void help_while(Pred &&keep_waiting);
+
+            /**
+            Waits for a future of a task of this pool and returns its value, running pending tasks
+            in the meantime.
+            */
+            template <class T>
+            T get(std::future<T> &future);
+
+            /**
+            Calls func(i) for every i in [0, count) on the calling thread and the pool, and returns
+            once every call has finished. Rethrows the first exception any call threw; calls that
+            have not started by then are skipped.
+            */
+            template <class Func>
+            void parallel_for(std::size_t count, Func &&func);
+
+            /**
+            Blocks until every submitted task has finished.
+            */
             void wait_until_nothing_in_flight();
-            void set_queue_size_limit(std::size_t limit);
+
+            /**
+            Sets the number of worker threads. Surplus workers hand their queued tasks to the
+            shared queue and stay parked until the pool grows again.
+            */
             void set_pool_size(std::size_t limit);
-            ~ThreadPool();
+
+            /**
+            Returns the number of active worker threads.
+            */
+            std::size_t pool_size() const noexcept
+            {
+                return pool_size_;
+            }
 
         private:
-            void emplace_back_worker(std::size_t worker_number);
-            void set_queue_size_limit_no_lock(std::size_t limit);
-
-            // need to keep track of threads so we can join them
-            std::vector<std::thread> workers;
-            // target pool size
-            std::size_t pool_size;
-            // the task queue
-            std::queue<std::function<void()> > tasks;
-            // queue length limit
-            std::size_t max_queue_size = 100000;
-            // stop signal
-            bool stop = false;
-
-            // synchronization
-            std::mutex queue_mutex;
-            std::condition_variable condition_producers;
-            std::condition_variable condition_consumers;
-
-            std::mutex in_flight_mutex;
-            std::condition_variable in_flight_condition;
-            std::atomic<std::size_t> in_flight;
-
-            struct handle_in_flight_decrement {
-                ThreadPool &tp;
-
-                handle_in_flight_decrement(ThreadPool &tp_) : tp(tp_)
-                {}
-
-                ~handle_in_flight_decrement()
-                {
-                    std::size_t prev = std::atomic_fetch_sub_explicit(
-                        &tp.in_flight, std::size_t(1), std::memory_order_acq_rel);
-                    if (prev == 1) {
-                        std::unique_lock<std::mutex> guard(tp.in_flight_mutex);
-                        tp.in_flight_condition.notify_all();
-                    }
-                }
+            struct Worker {
+                std::mutex mtx;
+
+                std::deque<Task> tasks;
             };
-        };
 
-        // the constructor just launches some amount of workers
-        inline ThreadPool::ThreadPool(std::size_t threads) : pool_size(threads), in_flight(0)
+            struct ThreadId {
+                const ThreadPool *pool = nullptr;
+
+                std::size_t index = 0;
+            };
+
+            static ThreadId &this_thread_id()
+            {
+                static thread_local ThreadId id;
+                return id;
+            }
+
+            void push(Task task);
+
+            bool try_pop(Task &task);
+
+            void run(Task &task);
+
+            void worker_loop(std::size_t index);
+
+            // Worker slots are published once and never move, so thieves read them without locking
+            std::array<std::atomic<Worker *>, max_thread_count> workers_{};
+
+            std::atomic<std::size_t> worker_count_{ 0 };
+
+            std::atomic<std::size_t> pool_size_{ 0 };
+
+            // Owns the workers and threads; guarded by control_mtx_
+            std::mutex control_mtx_;
+
+            std::vector<std::unique_ptr<Worker>> owned_workers_;
+
+            std::vector<std::thread> threads_;
+
+            std::mutex global_mtx_;
+
+            std::deque<Task> global_tasks_;
+
+            // Number of tasks in any queue
+            std::atomic<std::size_t> queued_{ 0 };
+
+            // Number of submitted tasks that have not finished
+            std::atomic<std::size_t> in_flight_{ 0 };
+
+            std::atomic<std::size_t> steal_start_{ 0 };
+
+            std::mutex sleep_mtx_;
+
+            std::condition_variable sleep_cv_;
+
+            // Parked workers wait on their own condition variable so that they never swallow a
+            // notification meant for an active worker
+            std::condition_variable park_cv_;
+
+            std::condition_variable idle_cv_;
+
+            std::atomic<std::size_t> sleepers_{ 0 };
+
+            std::atomic<bool> stop_{ false };
+        }; // class ThreadPool
+
+        inline ThreadPool::ThreadPool(std::size_t threads)
+        {
+            set_pool_size(threads);
+        }
+
+        inline ThreadPool::~ThreadPool()
         {
-            for (std::size_t i = 0; i != threads; ++i)
-                emplace_back_worker(i);
+            {
+                std::lock_guard<std::mutex> lock(sleep_mtx_);
+                stop_ = true;
+            }
+            sleep_cv_.notify_all();
+            park_cv_.notify_all();
+
+            std::lock_guard<std::mutex> lock(control_mtx_);
+            for (auto &thread : threads_) {
+                thread.join();
+            }
         }
 
-        // add new work item to the pool
         template <class F, class... Args>
         auto ThreadPool::enqueue(F &&f, Args &&... args) -> std::future<apsu_result_of_type>
         {
             using return_type = apsu_result_of_type;
 
-            auto task = std::make_shared<std::packaged_task<return_type()> >(
+            std::packaged_task<return_type()> task(
                 std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+            std::future<return_type> res = task.get_future();
+            push(Task(std::move(task)));
 
-            std::future<return_type> res = task->get_future();
+            return res;
+        }
+
+        template <class F>
+        void ThreadPool::submit(F &&f)
+        {
+            push(Task(std::forward<F>(f)));
+        }
 
-            std::unique_lock<std::mutex> lock(queue_mutex);
-            if (tasks.size() >= max_queue_size) {
-                std::size_t new_queue_size = seal::util::mul_safe<std::size_t>(max_queue_size, 2);
-                APSU_LOG_WARNING(
-                    "Thread pool queue has reached maximum size. Increasing to " << new_queue_size
-                                                                                 << " tasks.");
-                set_queue_size_limit_no_lock(new_queue_size);
+        inline void ThreadPool::push(Task task)
+        {
+            if (stop_) {
+                throw std::runtime_error("enqueue on stopped ThreadPool");
+            }
 
-                // wait for the queue to empty or be stopped
-                condition_producers.wait(
-                    lock, [this] { return tasks.size() < max_queue_size || stop; });
+            in_flight_++;
+            const ThreadId &id = this_thread_id();
+            if (id.pool == this) {
+                Worker &worker = *workers_[id.index].load();
+                std::lock_guard<std::mutex> lock(worker.mtx);
+                worker.tasks.push_back(std::move(task));
+            } else {
+                std::lock_guard<std::mutex> lock(global_mtx_);
+                global_tasks_.push_back(std::move(task));
             }
 
-            // don't allow enqueueing after stopping the pool
-            if (stop)
-                throw std::runtime_error("enqueue on stopped ThreadPool");
+            // A sleeper increments sleepers_ before checking queued_, so either it sees this task
+            // or this sees it
+            queued_++;
+            if (sleepers_) {
+                std::lock_guard<std::mutex> lock(sleep_mtx_);
+                sleep_cv_.notify_one();
+            }
+        }
 
-            tasks.emplace([task]() { (*task)(); });
-            std::atomic_fetch_add_explicit(&in_flight, std::size_t(1), std::memory_order_relaxed);
-            condition_consumers.notify_one();
+        inline bool ThreadPool::try_pop(Task &task)
+        {
+            if (!queued_) {
+                return false;
+            }
 
-            return res;
+            // Own tasks first, newest first, since their data is most likely still in cache
+            const ThreadId &id = this_thread_id();
+            Worker *own = (id.pool == this) ? workers_[id.index].load() : nullptr;
+            if (own) {
+                std::lock_guard<std::mutex> lock(own->mtx);
+                if (!own->tasks.empty()) {
+                    task = std::move(own->tasks.back());
+                    own->tasks.pop_back();
+                    queued_--;
+                    return true;
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(global_mtx_);
+                if (!global_tasks_.empty()) {
+                    task = std::move(global_tasks_.front());
+                    global_tasks_.pop_front();
+                    queued_--;
+                    return true;
+                }
+            }
+
+            // Steal the oldest task of another worker
+            std::size_t worker_count = worker_count_;
+            std::size_t start = own ? id.index + 1 : steal_start_++;
+            for (std::size_t k = 0; k < worker_count; k++) {
+                Worker *victim = workers_[(start + k) % worker_count].load();
+                if (!victim || victim == own) {
+                    continue;
+                }
+
+                std::lock_guard<std::mutex> lock(victim->mtx);
+                if (!victim->tasks.empty()) {
+                    task = std::move(victim->tasks.front());
+                    victim->tasks.pop_front();
+                    queued_--;
+                    return true;
+                }
+            }
+
+            return false;
         }
 
-        // the destructor joins all threads
-        inline ThreadPool::~ThreadPool()
+        inline void ThreadPool::run(Task &task)
         {
-            std::unique_lock<std::mutex> lock(queue_mutex);
-            stop = true;
-            condition_consumers.notify_all();
-            condition_producers.notify_all();
-            pool_size = 0;
-            condition_consumers.wait(lock, [this] { return this->workers.empty(); });
-            assert(in_flight == 0);
+            try {
+                task();
+            } catch (const std::exception &ex) {
+                APSU_LOG_ERROR("Thread pool task threw an exception: " << ex.what());
+            } catch (...) {
+                APSU_LOG_ERROR("Thread pool task threw an exception");
+            }
+            task = Task();
+
+            if (!--in_flight_) {
+                std::lock_guard<std::mutex> lock(sleep_mtx_);
+                idle_cv_.notify_all();
+            }
         }
 
-        inline void ThreadPool::wait_until_empty()
+        inline bool ThreadPool::run_pending_task()
         {
-            std::unique_lock<std::mutex> lock(this->queue_mutex);
-            this->condition_producers.wait(lock, [this] { return this->tasks.empty(); });
+            Task task;
+            if (!try_pop(task)) {
+                return false;
+            }
+
+            run(task);
+            return true;
         }
 
-        inline void ThreadPool::wait_until_nothing_in_flight()
+        template <class Pred>
+        void ThreadPool::help_while(Pred &&keep_waiting)
         {
-            std::unique_lock<std::mutex> lock(this->in_flight_mutex);
-            this->in_flight_condition.wait(lock, [this] { return this->in_flight == 0; });
+            std::size_t idle_rounds = 0;
+            while (keep_waiting()) {
+                if (run_pending_task()) {
+                    idle_rounds = 0;
+                    continue;
+                }
+
+                if (++idle_rounds < 64) {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                // Nothing to help with. The awaited work may finish without submitting anything, so
+                // sleep only briefly unless a task is submitted.
+                std::unique_lock<std::mutex> lock(sleep_mtx_);
+                sleepers_++;
+                sleep_cv_.wait_for(
+                    lock, std::chrono::microseconds(200), [this]() { return queued_ || stop_; });
+                sleepers_--;
+            }
         }
 
-        inline void ThreadPool::set_queue_size_limit(std::size_t limit)
+        template <class T>
+        T ThreadPool::get(std::future<T> &future)
         {
-            std::unique_lock<std::mutex> lock(this->queue_mutex);
-            set_queue_size_limit_no_lock(limit);
+            help_while([&future]() {
+                return future.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+            });
+            return future.get();
         }
 
-        inline void ThreadPool::set_pool_size(std::size_t limit)
+        template <class Func>
+        void ThreadPool::parallel_for(std::size_t count, Func &&func)
         {
-            if (limit < 1)
-                limit = 1;
+            if (!count) {
+                return;
+            }
 
-            std::unique_lock<std::mutex> lock(this->queue_mutex);
+            struct State {
+                std::atomic<std::size_t> next{ 0 };
 
-            if (stop)
-                return;
+                std::atomic<std::size_t> done{ 0 };
 
-            pool_size = limit;
-            std::size_t const old_size = this->workers.size();
-            if (pool_size > old_size) {
-                // create new worker threads
-                for (std::size_t i = old_size; i != pool_size; ++i)
-                    emplace_back_worker(i);
-            } else if (pool_size < old_size)
-                // notify all worker threads to start downsizing
-                this->condition_consumers.notify_all();
-        }
+                std::atomic<bool> failed{ false };
 
-        inline void ThreadPool::emplace_back_worker(std::size_t worker_number)
-        {
-            workers.emplace_back([this, worker_number] {
-                for (;;) {
-                    std::function<void()> task;
-                    bool notify;
+                std::mutex error_mtx;
 
-                    {
-                        std::unique_lock<std::mutex> lock(this->queue_mutex);
-                        this->condition_consumers.wait(lock, [this, worker_number] {
-                            return this->stop || !this->tasks.empty() ||
-                                   pool_size < worker_number + 1;
-                        });
-
-                        // deal with downsizing of thread pool or shutdown
-                        if ((this->stop && this->tasks.empty()) ||
-                            (!this->stop && pool_size < worker_number + 1)) {
-                            std::thread &last_thread = this->workers.back();
-                            std::thread::id this_id = std::this_thread::get_id();
-                            if (this_id == last_thread.get_id()) {
-                                // highest number thread exits, resizes the workers
-                                // vector, and notifies others
-                                last_thread.detach();
-                                this->workers.pop_back();
-                                this->condition_consumers.notify_all();
-                                return;
-                            } else
-                                continue;
-                        } else if (!this->tasks.empty()) {
-                            task = std::move(this->tasks.front());
-                            this->tasks.pop();
-                            notify =
-                                this->tasks.size() + 1 == max_queue_size || this->tasks.empty();
-                        } else
-                            continue;
+                std::exception_ptr error;
+            };
+            auto state = std::make_shared<State>();
+
+            // Helpers call body only while there is work left, and this does not return before all
+            // work is done, so a pointer to it is enough
+            std::function<void(std::size_t)> body = std::forward<Func>(func);
+            auto work = [state, count, body_ptr = &body]() {
+                for (std::size_t i; (i = state->next++) < count;) {
+                    try {
+                        if (!state->failed) {
+                            (*body_ptr)(i);
+                        }
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock(state->error_mtx);
+                        if (!state->error) {
+                            state->error = std::current_exception();
+                        }
+                        state->failed = true;
                     }
+                    state->done++;
+                }
+            };
 
-                    handle_in_flight_decrement guard(*this);
+            std::size_t helpers = (std::min)(count, std::size_t(pool_size_)) - 1;
+            for (std::size_t h = 0; h < helpers; h++) {
+                submit(work);
+            }
+            work();
+            help_while([&state, count]() { return state->done != count; });
 
-                    if (notify) {
-                        std::unique_lock<std::mutex> lock(this->queue_mutex);
-                        condition_producers.notify_all();
-                    }
+            if (state->error) {
+                std::rethrow_exception(state->error);
+            }
+        }
 
-                    task();
-                }
-            });
+        inline void ThreadPool::wait_until_nothing_in_flight()
+        {
+            std::unique_lock<std::mutex> lock(sleep_mtx_);
+            idle_cv_.wait(lock, [this]() { return !in_flight_; });
         }
 
-        inline void ThreadPool::set_queue_size_limit_no_lock(std::size_t limit)
+        inline void ThreadPool::set_pool_size(std::size_t limit)
         {
-            if (stop) {
+            limit = (std::min)((std::max)(limit, std::size_t(1)), std::size_t(max_thread_count));
+
+            std::lock_guard<std::mutex> control_lock(control_mtx_);
+            if (stop_) {
                 return;
             }
 
-            std::size_t old_limit = max_queue_size;
-            max_queue_size = (std::max)(limit, std::size_t(1));
-            if (old_limit < max_queue_size) {
-                condition_producers.notify_all();
+            {
+                std::lock_guard<std::mutex> lock(sleep_mtx_);
+                pool_size_ = limit;
+            }
+            sleep_cv_.notify_all();
+            park_cv_.notify_all();
+
+            // Publish any new workers before starting their threads
+            for (std::size_t i = owned_workers_.size(); i < limit; i++) {
+                owned_workers_.push_back(std::make_unique<Worker>());
+                workers_[i] = owned_workers_.back().get();
+                worker_count_ = i + 1;
+                threads_.emplace_back([this, i]() { worker_loop(i); });
             }
         }
 
+        inline void ThreadPool::worker_loop(std::size_t index)
+        {
+            this_thread_id() = ThreadId{ this, index };
+            Worker &self = *workers_[index].load();
+
+            for (;;) {
+                if (stop_ && !queued_) {
+                    return;
+                }
+
+                if (!stop_ && index >= pool_size_) {
+                    // Parked: hand the queued tasks to the others and wait to be needed again
+                    {
+                        std::lock_guard<std::mutex> own_lock(self.mtx);
+                        std::lock_guard<std::mutex> global_lock(global_mtx_);
+                        for (auto &task : self.tasks) {
+                            global_tasks_.push_back(std::move(task));
+                        }
+                        self.tasks.clear();
+                    }
+
+                    std::unique_lock<std::mutex> lock(sleep_mtx_);
+                    sleep_cv_.notify_all();
+                    park_cv_.wait(lock, [this, index]() { return stop_ || index < pool_size_; });
+                    continue;
+                }
+
+                Task task;
+                if (try_pop(task)) {
+                    run(task);
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(sleep_mtx_);
+                sleepers_++;
+                sleep_cv_.wait(lock, [this, index]() {
+                    return stop_ || queued_ || index >= pool_size_;
+                });
+                sleepers_--;
+            }
+        }
     } // namespace util
 } // namespace apsu
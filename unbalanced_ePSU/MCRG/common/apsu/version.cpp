@@ -9,7 +9,7 @@ namespace apsu {
     const uint32_t apsu_version =
         (APSU_VERSION_PATCH << 20) + (APSU_VERSION_MINOR << 10) + APSU_VERSION_MAJOR;
 
-    const uint32_t apsu_serialization_version = 1;
+    const uint32_t apsu_serialization_version = 2;
 
     bool same_serialization_version(uint32_t sv)
     {
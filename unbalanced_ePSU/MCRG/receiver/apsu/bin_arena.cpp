@@ -0,0 +1,129 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+// STD
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+// APSU
+#include "apsu/bin_arena.h"
+
+using namespace std;
+
+namespace apsu {
+    using namespace util;
+
+    namespace receiver {
+        namespace {
+            /**
+            The capacity a bin gets when its first row is added.
+            */
+            constexpr size_t min_bin_capacity = 4;
+        } // namespace
+
+        BinArena::BinArena(size_t bin_count, size_t column_count)
+            : column_count_(column_count), offsets_(bin_count, 0), sizes_(bin_count, 0),
+              capacities_(bin_count, 0)
+        {
+            if (!column_count) {
+                throw invalid_argument("column_count cannot be zero");
+            }
+        }
+
+        void BinArena::push_back(size_t bin_idx, felt_t item, gsl::span<const felt_t> label)
+        {
+            if (static_cast<size_t>(label.size()) + 1 != column_count_) {
+                throw invalid_argument("label has the wrong number of parts");
+            }
+
+            size_t row_idx = sizes_[bin_idx];
+            if (row_idx == capacities_[bin_idx]) {
+                relocate(bin_idx, max(min_bin_capacity, 2 * row_idx));
+            }
+
+            felts_[column_offset(bin_idx, 0) + row_idx] = item;
+            for (size_t column_idx = 1; column_idx < column_count_; column_idx++) {
+                felts_[column_offset(bin_idx, column_idx) + row_idx] = label[column_idx - 1];
+            }
+
+            sizes_[bin_idx]++;
+            row_count_++;
+        }
+
+        void BinArena::erase(size_t bin_idx, size_t row_idx)
+        {
+            size_t size = sizes_[bin_idx];
+            if (row_idx >= size) {
+                throw out_of_range("row_idx is out of range");
+            }
+
+            for (size_t column_idx = 0; column_idx < column_count_; column_idx++) {
+                felt_t *column_data = felts_.data() + column_offset(bin_idx, column_idx);
+                copy(column_data + row_idx + 1, column_data + size, column_data + row_idx);
+            }
+
+            sizes_[bin_idx]--;
+            row_count_--;
+        }
+
+        void BinArena::resize(size_t bin_idx, size_t size)
+        {
+            size_t old_size = sizes_[bin_idx];
+            if (size > capacities_[bin_idx]) {
+                relocate(bin_idx, size);
+            }
+
+            if (size > old_size) {
+                for (size_t column_idx = 0; column_idx < column_count_; column_idx++) {
+                    felt_t *column_data = felts_.data() + column_offset(bin_idx, column_idx);
+                    fill(column_data + old_size, column_data + size, felt_t(0));
+                }
+            }
+
+            sizes_[bin_idx] = static_cast<uint32_t>(size);
+            row_count_ = row_count_ - old_size + size;
+        }
+
+        void BinArena::relocate(size_t bin_idx, size_t capacity)
+        {
+            if (capacity > numeric_limits<uint32_t>::max()) {
+                throw length_error("bin capacity is too large");
+            }
+
+            size_t old_capacity = capacities_[bin_idx];
+            size_t offset = felts_.size();
+            felts_.resize(offset + capacity * column_count_);
+
+            size_t size = sizes_[bin_idx];
+            for (size_t column_idx = 0; column_idx < column_count_; column_idx++) {
+                const felt_t *old_column_data =
+                    felts_.data() + offsets_[bin_idx] + column_idx * old_capacity;
+                copy_n(old_column_data, size, felts_.data() + offset + column_idx * capacity);
+            }
+
+            unused_felts_ += old_capacity * column_count_;
+            offsets_[bin_idx] = offset;
+            capacities_[bin_idx] = static_cast<uint32_t>(capacity);
+
+            if (unused_felts_ > felts_.size() / 2) {
+                compact();
+            }
+        }
+
+        void BinArena::compact()
+        {
+            vector<felt_t> felts;
+            felts.reserve(felts_.size() - unused_felts_);
+            for (size_t bin_idx = 0; bin_idx < bin_count(); bin_idx++) {
+                auto bin_begin = felts_.begin() + static_cast<ptrdiff_t>(offsets_[bin_idx]);
+                auto bin_felt_count = static_cast<ptrdiff_t>(capacities_[bin_idx] * column_count_);
+                offsets_[bin_idx] = felts.size();
+                felts.insert(felts.end(), bin_begin, bin_begin + bin_felt_count);
+            }
+
+            felts_ = move(felts);
+            unused_felts_ = 0;
+        }
+    } // namespace receiver
+} // namespace apsu
@@ -0,0 +1,166 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+// STD
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// APSU
+#include "apsu/util/db_encoding.h"
+
+// GSL
+#include "gsl/span"
+
+namespace apsu {
+    namespace receiver {
+        /**
+        Stores the bins of a BinBundle in one contiguous array of field elements. Every bin holds a
+        number of rows, each made of an item and the parts of its label, and is stored as columns:
+        first the items of the bin, then for each label part the parts of the bin's labels. The
+        columns of a bin are adjacent and each has room for the bin's capacity, so the items of a
+        bin can be handed to polynomial computations without copying them.
+
+        A bin that outgrows its capacity is moved to the end of the array with twice the capacity.
+        The array is compacted once more than half of it is left behind by such moves.
+        */
+        class BinArena {
+        public:
+            /**
+            Creates an arena with no bins.
+            */
+            BinArena() = default;
+
+            /**
+            Creates an arena of bin_count empty bins whose rows have column_count field elements.
+            */
+            BinArena(std::size_t bin_count, std::size_t column_count);
+
+            /**
+            Returns the number of bins.
+            */
+            std::size_t bin_count() const noexcept
+            {
+                return sizes_.size();
+            }
+
+            /**
+            Returns the number of field elements in each row.
+            */
+            std::size_t column_count() const noexcept
+            {
+                return column_count_;
+            }
+
+            /**
+            Returns the number of rows in the given bin.
+            */
+            std::size_t size(std::size_t bin_idx) const
+            {
+                return sizes_[bin_idx];
+            }
+
+            /**
+            Returns whether every bin is empty.
+            */
+            bool empty() const noexcept
+            {
+                return !row_count_;
+            }
+
+            /**
+            Returns the given column of the given bin. The span is invalidated by any change to
+            the number of rows of a bin.
+            */
+            gsl::span<util::felt_t> column(std::size_t bin_idx, std::size_t column_idx)
+            {
+                return { felts_.data() + column_offset(bin_idx, column_idx), sizes_[bin_idx] };
+            }
+
+            /**
+            Returns the given column of the given bin. The span is invalidated by any change to
+            the number of rows of a bin.
+            */
+            gsl::span<const util::felt_t> column(
+                std::size_t bin_idx, std::size_t column_idx) const
+            {
+                return { felts_.data() + column_offset(bin_idx, column_idx), sizes_[bin_idx] };
+            }
+
+            /**
+            Appends a row made of item followed by the column_count() - 1 parts in label to the
+            given bin.
+            */
+            void push_back(
+                std::size_t bin_idx, util::felt_t item, gsl::span<const util::felt_t> label);
+
+            /**
+            Removes the given row from the given bin. The rows after it move up by one.
+            */
+            void erase(std::size_t bin_idx, std::size_t row_idx);
+
+            /**
+            Sets the number of rows of the given bin. New rows are zero.
+            */
+            void resize(std::size_t bin_idx, std::size_t size);
+
+            /**
+            Returns the number of field elements the arena has allocated.
+            */
+            std::size_t capacity() const noexcept
+            {
+                return felts_.capacity();
+            }
+
+        private:
+            std::size_t column_offset(std::size_t bin_idx, std::size_t column_idx) const
+            {
+                return offsets_[bin_idx] + column_idx * capacities_[bin_idx];
+            }
+
+            /**
+            Moves the given bin to the end of the array with room for capacity rows.
+            */
+            void relocate(std::size_t bin_idx, std::size_t capacity);
+
+            /**
+            Moves every bin next to the previous one, dropping the space bins were moved away from.
+            */
+            void compact();
+
+            std::size_t column_count_ = 0;
+
+            /**
+            The columns of all bins.
+            */
+            std::vector<util::felt_t> felts_;
+
+            /**
+            Where in felts_ each bin starts.
+            */
+            std::vector<std::size_t> offsets_;
+
+            /**
+            The number of rows in each bin.
+            */
+            std::vector<std::uint32_t> sizes_;
+
+            /**
+            The number of rows each bin has room for.
+            */
+            std::vector<std::uint32_t> capacities_;
+
+            /**
+            The total number of rows in all bins.
+            */
+            std::size_t row_count_ = 0;
+
+            /**
+            The number of field elements in felts_ that belong to no bin.
+            */
+            std::size_t unused_felts_ = 0;
+        }; // class BinArena
+    }      // namespace receiver
+} // namespace apsu
@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <functional>
 #include <future>
+#include <limits>
 #include <type_traits>
 #include <utility>
 #include <chrono>
@@ -17,6 +18,9 @@
 
 // SEAL
 #include "seal/util/defines.h"
+#include "seal/util/uintarith.h"
+#include "seal/util/uintarithsmallmod.h"
+#include "seal/util/uintcore.h"
 
 namespace apsu {
     using namespace std;
@@ -31,37 +35,42 @@ namespace apsu {
             /**
             Helper function. Determines if a field element is present in a bin.
             */
-            bool is_present(const vector<felt_t> &bin, felt_t element)
+            bool is_present(gsl::span<const felt_t> bin, felt_t element)
             {
                 return bin.end() != find(bin.begin(), bin.end(), element);
             }
 
             /**
-            Helper function. Determines if a field element is present in a bin.
+            Helper function. Returns the position of the given field element in the items of a bin
+            if found and the size of the bin otherwise.
             */
-            bool is_present(const vector<felt_t> &bin, const CuckooFilter &filter, felt_t element)
+            size_t find_in_bin(
+                const BinArena &bins,
+                const CuckooFilterArray &filters,
+                size_t bin_idx,
+                felt_t element)
             {
-                // Check if the key is already in the current bin.
-                if (filter.contains(element)) {
+                gsl::span<const felt_t> bin = bins.column(bin_idx, 0);
+
+                // Check if the key is in the bin before searching the bin
+                if (filters.contains(bin_idx, element)) {
                     // Perform a linear search to determine true/false positives
-                    return is_present(bin, element);
+                    return static_cast<size_t>(find(bin.begin(), bin.end(), element) - bin.begin());
                 }
 
-                return false;
+                return bin.size();
             }
 
             /**
-            Helper function. Returns an iterator pointing to the given field element in the bin if
-            found and bin.end() otherwise.
+            Helper function. Determines if a field element is present in the items of a bin.
             */
-            template <typename BinT>
-            auto get_iterator(BinT &bin, const CuckooFilter &filter, felt_t element)
+            bool is_present(
+                const BinArena &bins,
+                const CuckooFilterArray &filters,
+                size_t bin_idx,
+                felt_t element)
             {
-                if (filter.contains(element)) {
-                    return find(bin.begin(), bin.end(), element);
-                }
-
-                return bin.end();
+                return find_in_bin(bins, filters, bin_idx, element) != bins.size(bin_idx);
             }
 
             void try_clear_irrelevant_bits(
@@ -95,6 +104,234 @@ namespace apsu {
                     }
                 }
             }
+
+            /**
+            The coefficients of a BatchedPlaintextPolyn for one evaluation. If the PlaintextCache
+            holds them they are used in place; otherwise they are loaded from batched_coeffs on
+            demand, at most coeff_chunk_size at a time, so the whole polynomial is never held.
+            */
+            class LoadedCoeffs {
+            public:
+                static constexpr size_t coeff_chunk_size = 32;
+
+                LoadedCoeffs(
+                    const BatchedPlaintextPolyn &polyn,
+                    const SEALContext &seal_context,
+                    MemoryPoolHandle pool)
+                    : polyn_(polyn), seal_context_(seal_context), pool_(move(pool))
+                {
+                    resident_ =
+                        PlaintextCache::Get(polyn.resident, seal_context, polyn.batched_coeffs);
+                }
+
+                /**
+                Returns the coefficient of degree deg, loading it into buffer unless it is resident.
+                */
+                const Plaintext &get(size_t deg, Plaintext &buffer) const
+                {
+                    if (resident_) {
+                        return (*resident_)[deg];
+                    }
+
+                    load(deg, buffer);
+                    return buffer;
+                }
+
+                /**
+                Calls func(first_deg, chunk) on consecutive chunks of the coefficients with degrees
+                in [begin, end), where chunk is a gsl::span<const Plaintext> starting at degree
+                first_deg. Resident coefficients are passed as a single chunk.
+                */
+                template <typename Func>
+                void for_each_chunk(size_t begin, size_t end, Func &&func) const
+                {
+                    if (resident_) {
+                        func(
+                            begin,
+                            gsl::span<const Plaintext>(resident_->data() + begin, end - begin));
+                        return;
+                    }
+
+                    vector<Plaintext> chunk;
+                    chunk.reserve(min(coeff_chunk_size, end - begin));
+                    while (chunk.size() < chunk.capacity()) {
+                        chunk.emplace_back(pool_);
+                    }
+                    for (size_t chunk_begin = begin; chunk_begin < end;
+                         chunk_begin += coeff_chunk_size) {
+                        size_t chunk_len = min(coeff_chunk_size, end - chunk_begin);
+                        for (size_t k = 0; k < chunk_len; k++) {
+                            load(chunk_begin + k, chunk[k]);
+                        }
+                        func(chunk_begin, gsl::span<const Plaintext>(chunk.data(), chunk_len));
+                    }
+                }
+
+            private:
+                void load(size_t deg, Plaintext &destination) const
+                {
+                    const auto &coeff_data = polyn_.batched_coeffs[deg];
+                    destination.unsafe_load(
+                        seal_context_,
+                        reinterpret_cast<const seal_byte *>(coeff_data.data()),
+                        coeff_data.size());
+                }
+
+                const BatchedPlaintextPolyn &polyn_;
+
+                const SEALContext &seal_context_;
+
+                MemoryPoolHandle pool_;
+
+                shared_ptr<const PlaintextCache::Coeffs> resident_;
+            };
+
+            /**
+            Accumulates the products of NTT-form ciphertexts and plaintexts, which must all be at
+            the given parms_id. This is what multiply_plain followed by add_inplace computes term by
+            term, but the products are summed as 128-bit integers and reduced only once every few
+            terms, and no temporary ciphertexts are written. The 128-bit accumulators are carried
+            from one call to add to the next, so the terms can be supplied in chunks. Within a chunk
+            the coefficients are processed in blocks so that the accumulators being updated stay in
+            L1.
+            */
+            class PlainProductAccumulator {
+            public:
+                PlainProductAccumulator(
+                    const SEALContext &seal_context,
+                    const parms_id_type &parms_id,
+                    size_t ct_size,
+                    MemoryPoolHandle &pool)
+                    : seal_context_(seal_context), parms_id_(parms_id), ct_size_(ct_size)
+                {
+                    auto context_data = seal_context.get_context_data(parms_id);
+                    if (!context_data) {
+                        throw invalid_argument("parms_id is not valid for encryption parameters");
+                    }
+
+                    coeff_modulus_ = context_data->parms().coeff_modulus();
+                    coeff_count_ = context_data->parms().poly_modulus_degree();
+
+                    // Each product is below 2^(2 * bit_count), so this many fit in 128 bits on top
+                    // of a reduced value
+                    for (const Modulus &modulus : coeff_modulus_) {
+                        int headroom = 128 - 2 * modulus.bit_count();
+                        max_lazy_terms_.push_back(
+                            (headroom >= 63) ? numeric_limits<size_t>::max()
+                                             : (size_t(1) << headroom) - 1);
+                    }
+                    lazy_terms_.assign(coeff_modulus_.size(), 0);
+
+                    size_t acc_count = ct_size_ * coeff_modulus_.size() * coeff_count_;
+                    acc_lo_ = allocate_zero_uint(acc_count, pool);
+                    acc_hi_ = allocate_zero_uint(acc_count, pool);
+                }
+
+                /**
+                Adds the products of cts[k] and pts[k] for every k.
+                */
+                void add(gsl::span<const Ciphertext> cts, gsl::span<const Plaintext> pts)
+                {
+                    if (cts.size() != pts.size()) {
+                        throw invalid_argument("cts and pts must have the same size");
+                    }
+                    for (size_t k = 0; k < pts.size(); k++) {
+                        if (!cts[k].is_ntt_form() || !pts[k].is_ntt_form()) {
+                            throw invalid_argument(
+                                "ciphertexts and plaintexts must be in NTT form");
+                        }
+                        if (cts[k].parms_id() != parms_id_ || pts[k].parms_id() != parms_id_ ||
+                            cts[k].size() != ct_size_) {
+                            throw invalid_argument("ciphertexts and plaintexts do not match");
+                        }
+                    }
+
+                    constexpr size_t block_size = 256;
+                    for (size_t j = 0; j < coeff_modulus_.size(); j++) {
+                        const Modulus &modulus = coeff_modulus_[j];
+                        size_t lazy_terms = lazy_terms_[j];
+
+                        for (size_t poly_idx = 0; poly_idx < ct_size_; poly_idx++) {
+                            size_t rns_offset = j * coeff_count_;
+                            for (size_t block_start = 0; block_start < coeff_count_;
+                                 block_start += block_size) {
+                                size_t block_len = min(block_size, coeff_count_ - block_start);
+                                size_t offset = rns_offset + block_start;
+                                size_t acc_offset =
+                                    poly_idx * coeff_modulus_.size() * coeff_count_ + offset;
+                                uint64_t *acc_lo = acc_lo_.get() + acc_offset;
+                                uint64_t *acc_hi = acc_hi_.get() + acc_offset;
+
+                                lazy_terms = lazy_terms_[j];
+                                for (size_t k = 0; k < pts.size(); k++) {
+                                    const uint64_t *ct_data = cts[k].data(poly_idx) + offset;
+                                    const uint64_t *pt_data = pts[k].data() + offset;
+                                    for (size_t i = 0; i < block_len; i++) {
+                                        unsigned long long prod[2];
+                                        multiply_uint64(ct_data[i], pt_data[i], prod);
+                                        acc_hi[i] +=
+                                            prod[1] + add_uint64(acc_lo[i], prod[0], acc_lo + i);
+                                    }
+
+                                    if (++lazy_terms == max_lazy_terms_[j]) {
+                                        for (size_t i = 0; i < block_len; i++) {
+                                            uint64_t acc[2]{ acc_lo[i], acc_hi[i] };
+                                            acc_lo[i] = barrett_reduce_128(acc, modulus);
+                                            acc_hi[i] = 0;
+                                        }
+                                        lazy_terms = 0;
+                                    }
+                                }
+                            }
+                        }
+
+                        // Every block went through the same terms, so they agree on the count
+                        lazy_terms_[j] = lazy_terms;
+                    }
+                }
+
+                /**
+                Sets destination to the reduced sum of all the products added so far.
+                */
+                void finish(Ciphertext &destination) const
+                {
+                    destination.resize(seal_context_, parms_id_, ct_size_);
+                    destination.is_ntt_form() = true;
+
+                    for (size_t j = 0; j < coeff_modulus_.size(); j++) {
+                        const Modulus &modulus = coeff_modulus_[j];
+                        for (size_t poly_idx = 0; poly_idx < ct_size_; poly_idx++) {
+                            size_t offset = j * coeff_count_;
+                            size_t acc_offset =
+                                poly_idx * coeff_modulus_.size() * coeff_count_ + offset;
+                            uint64_t *dest_data = destination.data(poly_idx) + offset;
+                            for (size_t i = 0; i < coeff_count_; i++) {
+                                uint64_t acc[2]{ acc_lo_[acc_offset + i], acc_hi_[acc_offset + i] };
+                                dest_data[i] = barrett_reduce_128(acc, modulus);
+                            }
+                        }
+                    }
+                }
+
+            private:
+                const SEALContext &seal_context_;
+
+                parms_id_type parms_id_;
+
+                size_t ct_size_;
+
+                vector<Modulus> coeff_modulus_;
+
+                size_t coeff_count_;
+
+                vector<size_t> max_lazy_terms_;
+
+                vector<size_t> lazy_terms_;
+
+                Pointer<uint64_t> acc_lo_;
+
+                Pointer<uint64_t> acc_hi_;
+            };
         } // namespace
 
         /**
@@ -135,28 +372,29 @@ namespace apsu {
             Ciphertext result(pool);
             result.resize(*seal_context, encode_parms_id, 2);
             result.is_ntt_form() = true;
-            Ciphertext temp(pool);
-            Plaintext coeff(pool);
-   
-
-            for (size_t deg = 1; deg < batched_coeffs.size(); deg++) {
-                coeff.unsafe_load(
-                    *seal_context,
-                    reinterpret_cast<const seal_byte *>(batched_coeffs[deg].data()),
-                    batched_coeffs[deg].size());
-                evaluator->multiply_plain(ciphertext_powers[deg], coeff, temp, pool);
-                evaluator->add_inplace(result, temp);
+            LoadedCoeffs coeffs(*this, *seal_context, pool);
+
+            if (batched_coeffs.size() > 1) {
+                PlainProductAccumulator acc(
+                    *seal_context, encode_parms_id, ciphertext_powers[1].size(), pool);
+                coeffs.for_each_chunk(
+                    1,
+                    batched_coeffs.size(),
+                    [&](size_t first_deg, gsl::span<const Plaintext> chunk) {
+                        acc.add(
+                            gsl::span<const Ciphertext>(
+                                ciphertext_powers.data() + first_deg, chunk.size()),
+                            chunk);
+                    });
+                acc.finish(result);
             }
 
 
             // Need to transform back from NTT form before we can add the constant coefficient. The
             // constant coefficient is specifically not in NTT form so this can work.
             evaluator->transform_from_ntt_inplace(result);
-            coeff.unsafe_load(
-                *seal_context,
-                reinterpret_cast<const seal_byte *>(batched_coeffs[0].data()),
-                batched_coeffs[0].size());
-            evaluator->add_plain_inplace(result, coeff);
+            Plaintext constant_coeff(pool);
+            evaluator->add_plain_inplace(result, coeffs.get(0, constant_coeff));
 
      
             evaluator->add_plain_inplace(result, random_plain);
@@ -239,69 +477,79 @@ namespace apsu {
             result.resize(*seal_context, high_powers_parms_id, 3);
             result.is_ntt_form() = false;
 
-            // Temporary variables
-            Ciphertext temp(pool);
-            Ciphertext temp_in(pool);
-            Plaintext coeff(pool);
-
-            // Calculate polynomial for i=1,...,ps_high_degree_powers-1
-            for (size_t i = 1; i < ps_high_degree_powers; i++) {
-                // Evaluate inner polynomial. The free term is left out and added later on.
-                // The evaluation result is stored in temp_in.
-                for (size_t j = 1; j < ps_high_degree; j++) {
-                    coeff.unsafe_load(
-                        *seal_context,
-                        reinterpret_cast<const seal_byte *>(
-                            batched_coeffs[i * ps_high_degree + j].data()),
-                        batched_coeffs[i * ps_high_degree + j].size());
-
-                    evaluator->multiply_plain(ciphertext_powers[j], coeff, temp, pool);
+            LoadedCoeffs coeffs(*this, *seal_context, pool);
 
-                    if (j == 1) {
-                        temp_in = temp;
-                    } else {
-                        evaluator->add_inplace(temp_in, temp);
-                    }
-                }
+            // Computes the part of the result that comes from the inner polynomial i. Its free term
+            // is not in NTT form, so it is multiplied by the high power on its own.
+            auto compute_part = [&](size_t i, Ciphertext &part) {
+                Ciphertext temp(pool);
+                Plaintext free_coeff(pool);
+                size_t free_deg = i * ps_high_degree;
 
-                // Transform inner polynomial to coefficient form
-                evaluator->transform_from_ntt_inplace(temp_in);
-                evaluator->mod_switch_to_inplace(temp_in, high_powers_parms_id);
+                // The inner polynomial for i=ps_high_degree_powers has degree degree % ps_high_degree
+                size_t inner_degree =
+                    (i == ps_high_degree_powers) ? degree % ps_high_degree : ps_high_degree - 1;
 
-                // The high powers are already in coefficient form
-                evaluator->multiply_inplace(temp_in, ciphertext_powers[i * ps_high_degree], pool);
-                evaluator->add_inplace(result, temp_in);
-            }
-
-            // Calculate polynomial for i=ps_high_degree_powers.
-            // Done separately because here the degree of the inner poly is degree % ps_high_degree.
-            // Once again, the free term will only be added later on.
-            if (degree % ps_high_degree > 0) {
-                for (size_t j = 1; j <= degree % ps_high_degree; j++) {
-                    coeff.unsafe_load(
+                if (inner_degree) {
+                    // Evaluate the inner polynomial and transform it to coefficient form
+                    PlainProductAccumulator acc(
                         *seal_context,
-                        reinterpret_cast<const seal_byte *>(
-                            batched_coeffs[ps_high_degree_powers * ps_high_degree + j].data()),
-                        batched_coeffs[ps_high_degree_powers * ps_high_degree + j].size());
-
-                    evaluator->multiply_plain(ciphertext_powers[j], coeff, temp, pool);
-
-                    if (j == 1) {
-                        temp_in = temp;
-                    } else {
-                        evaluator->add_inplace(temp_in, temp);
+                        ciphertext_powers[1].parms_id(),
+                        ciphertext_powers[1].size(),
+                        pool);
+                    coeffs.for_each_chunk(
+                        free_deg + 1,
+                        free_deg + inner_degree + 1,
+                        [&](size_t first_deg, gsl::span<const Plaintext> chunk) {
+                            acc.add(
+                                gsl::span<const Ciphertext>(
+                                    ciphertext_powers.data() + first_deg - free_deg, chunk.size()),
+                                chunk);
+                        });
+                    acc.finish(part);
+                    evaluator->transform_from_ntt_inplace(part);
+                    evaluator->mod_switch_to_inplace(part, high_powers_parms_id, pool);
+
+                    // The high powers are already in coefficient form. The inner polynomial for i=0
+                    // is not multiplied by any.
+                    if (i) {
+                        evaluator->multiply_inplace(part, ciphertext_powers[free_deg], pool);
                     }
+                } else {
+                    part.resize(*seal_context, high_powers_parms_id, 2);
+                    part.is_ntt_form() = false;
                 }
 
-                // Transform inner polynomial to coefficient form
-                evaluator->transform_from_ntt_inplace(temp_in);
-                evaluator->mod_switch_to_inplace(temp_in, high_powers_parms_id);
+                // Add the free term multiplied by the high power
+                if (i) {
+                    evaluator->multiply_plain(
+                        ciphertext_powers[free_deg], coeffs.get(free_deg, free_coeff), temp, pool);
+                    evaluator->mod_switch_to_inplace(temp, high_powers_parms_id, pool);
+                    evaluator->add_inplace(part, temp);
+                }
+            };
 
-                // The high powers are already in coefficient form
-                evaluator->multiply_inplace(
-                    temp_in, ciphertext_powers[ps_high_degree_powers * ps_high_degree], pool);
-                evaluator->add_inplace(result, temp_in);
-            }
+            // The inner polynomials are independent, so they are spread over the thread pool; this
+            // keeps the cores busy when there are fewer BinBundle caches than threads. The parts are
+            // then summed pairwise, also in parallel. The calling thread takes part in both, so this
+            // is safe to call from a pool task.
+            ThreadPoolMgr tpm;
+            size_t part_count = ps_high_degree_powers + 1;
+            vector<Ciphertext> parts;
+            parts.reserve(part_count);
+            for (size_t i = 0; i < part_count; i++) {
+                parts.emplace_back(pool);
+            }
+            tpm.thread_pool().parallel_for(
+                part_count, [&](size_t i) { compute_part(i, parts[i]); });
+            for (size_t stride = 1; stride < part_count; stride *= 2) {
+                size_t pair_count = (part_count - stride + 2 * stride - 1) / (2 * stride);
+                tpm.thread_pool().parallel_for(pair_count, [&](size_t k) {
+                    size_t i = 2 * stride * k;
+                    evaluator->add_inplace(parts[i], parts[i + stride]);
+                });
+            }
+            evaluator->add_inplace(result, parts[0]);
 
             // Relinearize sum of ciphertext-ciphertext products if relinearization is supported by
             // the parameters.
@@ -309,40 +557,9 @@ namespace apsu {
                 evaluator->relinearize_inplace(result, *relin_keys, pool);
             }
 
-            // Calculate inner polynomial for i=0.
-            // Done separately since there is no multiplication with a power of high-degree
-            for (size_t j = 1; j < ps_high_degree; j++) {
-                coeff.unsafe_load(
-                    *seal_context,
-                    reinterpret_cast<const seal_byte *>(batched_coeffs[j].data()),
-                    batched_coeffs[j].size());
-
-                evaluator->multiply_plain(ciphertext_powers[j], coeff, temp, pool);
-                evaluator->transform_from_ntt_inplace(temp);
-                evaluator->mod_switch_to_inplace(temp, high_powers_parms_id);
-                evaluator->add_inplace(result, temp);
-            }
-
-            // Add the constant coefficients of the inner polynomials multiplied by the respective
-            // powers of high-degree
-            for (size_t i = 1; i < ps_high_degree_powers + 1; i++) {
-                coeff.unsafe_load(
-                    *seal_context,
-                    reinterpret_cast<const seal_byte *>(batched_coeffs[i * ps_high_degree].data()),
-                    batched_coeffs[i * ps_high_degree].size());
-
-                evaluator->multiply_plain(ciphertext_powers[i * ps_high_degree], coeff, temp, pool);
-                evaluator->mod_switch_to_inplace(temp, high_powers_parms_id);
-                evaluator->add_inplace(result, temp);
-            }
-
             // Add the constant coefficient
-            coeff.unsafe_load(
-                *seal_context,
-                reinterpret_cast<const seal_byte *>(batched_coeffs[0].data()),
-                batched_coeffs[0].size());
-
-            evaluator->add_plain_inplace(result, coeff);
+            Plaintext constant_coeff(pool);
+            evaluator->add_plain_inplace(result, coeffs.get(0, constant_coeff));
             evaluator->add_plain_inplace(result, random_plain);
            
 
@@ -389,6 +606,8 @@ namespace apsu {
                 get_parms_id_for_chain_idx(*crypto_context.seal_context(), plain_coeffs_chain_idx);
 
             // Now make the Plaintexts. We let Plaintext i contain all bin coefficients of degree i.
+            auto encoded_coeffs = make_shared<vector<vector<unsigned char>>>();
+            encoded_coeffs->reserve(max_deg + 1);
             size_t num_polyns = polyns.size();
             for (size_t i = 0; i < max_deg + 1; i++) {
                 // Go through all the bins, collecting the coefficients at degree i
@@ -425,8 +644,11 @@ namespace apsu {
                 size_t size = static_cast<size_t>(pt.save(
                     reinterpret_cast<seal_byte *>(pt_data.data()), pt_data.size(), compr_mode));
                 pt_data.resize(size);
-                batched_coeffs.push_back(move(pt_data));
+                encoded_coeffs->push_back(move(pt_data));
             }
+
+            batched_coeffs.assign(encoded_coeffs->begin(), encoded_coeffs->end());
+            coeff_data = move(encoded_coeffs);
         }
 
         BinBundleCache::BinBundleCache(const CryptoContext &crypto_context, size_t label_size)
@@ -473,14 +695,14 @@ namespace apsu {
             return context_data->parms().plain_modulus();
         }
 
-        template <>
         int32_t BinBundle::multi_insert(
-            const vector<felt_t> &items, size_t start_bin_idx, bool dry_run)
+            gsl::span<const felt_t> items, size_t start_bin_idx, bool dry_run)
         {
             if (stripped_) {
                 APSU_LOG_ERROR("Cannot insert data to a stripped BinBundle");
                 throw logic_error("failed to insert data");
             }
+            materialize();
             if (items.empty()) {
                 APSU_LOG_ERROR("No item data to insert");
                 return -1;
@@ -502,22 +724,21 @@ namespace apsu {
             size_t max_bin_size = 0;
             size_t curr_bin_idx = start_bin_idx;
             for (felt_t curr_item : items) {
-                vector<felt_t> &curr_bin = item_bins_[curr_bin_idx];
+                size_t curr_bin_size = bins_.size(curr_bin_idx);
 
                 // Compare the would-be bin size here to the running max
-                if (max_bin_size < curr_bin.size() + 1) {
-                    max_bin_size = curr_bin.size() + 1;
+                if (max_bin_size < curr_bin_size + 1) {
+                    max_bin_size = curr_bin_size + 1;
                 }
 
                 // Insert if not dry run
                 if (!dry_run) {
                     // Insert the new item
-                    CuckooFilter &curr_filter = filters_[curr_bin_idx];
-                    curr_bin.push_back(curr_item);
-                    curr_filter.add(curr_item);
+                    bins_.push_back(curr_bin_idx, curr_item, {});
+                    filters_.add(curr_bin_idx, curr_item);
 
-                    // Indicate that the polynomials need to be recomputed
-                    cache_invalid_ = true;
+                    // Indicate that the polynomials of this bin need to be recomputed
+                    mark_bin_dirty(curr_bin_idx);
                 }
 
                 curr_bin_idx++;
@@ -536,6 +757,7 @@ namespace apsu {
                 APSU_LOG_ERROR("Cannot insert data to a stripped BinBundle");
                 throw logic_error("failed to insert data");
             }
+            materialize();
             if (item_labels.empty()) {
                 APSU_LOG_ERROR("No item or label data to insert");
                 return -1;
@@ -573,12 +795,10 @@ namespace apsu {
                 size_t curr_bin_idx = start_bin_idx;
                 for (auto &curr_item_label : item_labels) {
                     felt_t curr_item = curr_item_label.first;
-                    vector<felt_t> &curr_bin = item_bins_[curr_bin_idx];
-                    CuckooFilter &curr_filter = filters_[curr_bin_idx];
 
                     // Check if the key is already in the current bin. If so, that's an insertion
                     // error
-                    if (is_present(curr_bin, curr_filter, curr_item)) {
+                    if (is_present(bins_, filters_, curr_bin_idx, curr_item)) {
                         return -1;
                     }
 
@@ -591,29 +811,21 @@ namespace apsu {
             size_t curr_bin_idx = start_bin_idx;
             for (auto &curr_item_label : item_labels) {
                 felt_t curr_item = curr_item_label.first;
-                vector<felt_t> &curr_bin = item_bins_[curr_bin_idx];
+                size_t curr_bin_size = bins_.size(curr_bin_idx);
 
                 // Compare the would-be bin size here to the running max
-                if (max_bin_size < curr_bin.size() + 1) {
-                    max_bin_size = curr_bin.size() + 1;
+                if (max_bin_size < curr_bin_size + 1) {
+                    max_bin_size = curr_bin_size + 1;
                 }
 
                 // Insert if not dry run
                 if (!dry_run) {
-                    // Insert the new item
-                    CuckooFilter &curr_filter = filters_[curr_bin_idx];
-                    curr_bin.push_back(curr_item);
-                    curr_filter.add(curr_item);
-
-                    // Insert the new label; loop over each label part
-                    for (size_t label_idx = 0; label_idx < get_label_size(); label_idx++) {
-                        // Add this label part to the matching bin
-                        felt_t curr_label = curr_item_label.second[label_idx];
-                        label_bins_[label_idx][curr_bin_idx].push_back(curr_label);
-                    }
+                    // Insert the new item together with all parts of its label
+                    bins_.push_back(curr_bin_idx, curr_item, curr_item_label.second);
+                    filters_.add(curr_bin_idx, curr_item);
 
-                    // Indicate that the polynomials need to be recomputed
-                    cache_invalid_ = true;
+                    // Indicate that the polynomials of this bin need to be recomputed
+                    mark_bin_dirty(curr_bin_idx);
                 }
 
                 curr_bin_idx++;
@@ -622,13 +834,13 @@ namespace apsu {
             return safe_cast<int>(max_bin_size);
         }
 
-        template <>
-        bool BinBundle::try_multi_overwrite(const vector<felt_t> &items, size_t start_bin_idx)
+        bool BinBundle::try_multi_overwrite(gsl::span<const felt_t> items, size_t start_bin_idx)
         {
             if (stripped_) {
                 APSU_LOG_ERROR("Cannot overwrite data in a stripped BinBundle");
                 throw logic_error("failed to overwrite data");
             }
+            materialize();
             if (items.empty()) {
                 APSU_LOG_ERROR("No item data to insert");
                 return false;
@@ -649,19 +861,18 @@ namespace apsu {
             // Check that all the item components appear sequentially in this BinBundle
             size_t curr_bin_idx = start_bin_idx;
             for (felt_t curr_item : items) {
-                vector<felt_t> &curr_bin = item_bins_[curr_bin_idx];
-                CuckooFilter &curr_filter = filters_[curr_bin_idx];
-
                 // A non-match was found; the item is not here.
-                if (!is_present(curr_bin, curr_filter, curr_item)) {
+                if (!is_present(bins_, filters_, curr_bin_idx, curr_item)) {
                     return false;
                 }
 
                 curr_bin_idx++;
             }
 
-            // Nothing was done, but mark the cache as dirty anyway
-            cache_invalid_ = true;
+            // Nothing was done, but mark the bins as dirty anyway
+            for (size_t bin_idx = start_bin_idx; bin_idx < curr_bin_idx; bin_idx++) {
+                mark_bin_dirty(bin_idx);
+            }
 
             return true;
         }
@@ -674,6 +885,7 @@ namespace apsu {
                 APSU_LOG_ERROR("Cannot overwrite data in a stripped BinBundle");
                 throw logic_error("failed to overwrite data");
             }
+            materialize();
             if (item_labels.empty()) {
                 APSU_LOG_ERROR("No item or label data to insert");
                 return false;
@@ -702,11 +914,9 @@ namespace apsu {
             size_t curr_bin_idx = start_bin_idx;
             for (auto &curr_item_label : item_labels) {
                 felt_t curr_item = curr_item_label.first;
-                vector<felt_t> &curr_bin = item_bins_[curr_bin_idx];
-                CuckooFilter &curr_filter = filters_[curr_bin_idx];
 
                 // A non-match was found; the item is not here.
-                if (!is_present(curr_bin, curr_filter, curr_item)) {
+                if (!is_present(bins_, filters_, curr_bin_idx, curr_item)) {
                     return false;
                 }
 
@@ -719,7 +929,7 @@ namespace apsu {
                 felt_t curr_item = curr_item_label.first;
 
                 // Overwrite the label in the bin
-                vector<felt_t> &curr_bin = item_bins_[curr_bin_idx];
+                gsl::span<const felt_t> curr_bin = bins_.column(curr_bin_idx, 0);
 
                 // No point in using cuckoo filters here for look-up: we know the item exists so do
                 // linear search
@@ -741,11 +951,11 @@ namespace apsu {
                 for (size_t label_idx = 0; label_idx < get_label_size(); label_idx++) {
                     // Overwrite this label part in the matching bin
                     felt_t curr_label = curr_item_label.second[label_idx];
-                    label_bins_[label_idx][curr_bin_idx][item_idx_in_bin] = curr_label;
+                    bins_.column(curr_bin_idx, label_idx + 1)[item_idx_in_bin] = curr_label;
                 }
 
-                // Indicate that the polynomials need to be recomputed
-                cache_invalid_ = true;
+                // Indicate that the polynomials of this bin need to be recomputed
+                mark_bin_dirty(curr_bin_idx);
 
                 curr_bin_idx++;
             }
@@ -753,12 +963,13 @@ namespace apsu {
             return true;
         }
 
-        bool BinBundle::try_multi_remove(const vector<felt_t> &items, size_t start_bin_idx)
+        bool BinBundle::try_multi_remove(gsl::span<const felt_t> items, size_t start_bin_idx)
         {
             if (stripped_) {
                 APSU_LOG_ERROR("Cannot remove data from a stripped BinBundle");
                 throw logic_error("failed to remove data");
             }
+            materialize();
             if (items.empty()) {
                 APSU_LOG_ERROR("No item data to remove");
                 return false;
@@ -772,62 +983,39 @@ namespace apsu {
             // Go through all the items. If any item doesn't appear, we scrap the whole computation
             // and return false.
             size_t curr_bin_idx = start_bin_idx;
-            vector<vector<felt_t>::iterator> to_remove_item_its;
-            vector<vector<vector<felt_t>::iterator>> to_remove_label_its(get_label_size());
-
+            vector<size_t> to_remove_item_locs;
             for (auto &item : items) {
-                vector<felt_t> &curr_bin = item_bins_[curr_bin_idx];
-                CuckooFilter &curr_filter = filters_[curr_bin_idx];
-
-                auto to_remove_item_it = get_iterator(curr_bin, curr_filter, item);
-                if (curr_bin.end() == to_remove_item_it) {
+                size_t item_loc_in_bin = find_in_bin(bins_, filters_, curr_bin_idx, item);
+                if (item_loc_in_bin == bins_.size(curr_bin_idx)) {
                     // One of the items isn't there; return false;
                     return false;
-                } else {
-                    // Found the item; mark it for removal
-                    to_remove_item_its.push_back(to_remove_item_it);
-
-                    // We need to also mark the corresponding labels for removal
-                    auto item_loc_in_bin = distance(curr_bin.begin(), to_remove_item_it);
-                    for (size_t label_idx = 0; label_idx < get_label_size(); label_idx++) {
-                        auto to_remove_label_it =
-                            label_bins_[label_idx][curr_bin_idx].begin() + item_loc_in_bin;
-                        to_remove_label_its[label_idx].push_back(to_remove_label_it);
-                    }
                 }
 
+                // Found the item; mark it for removal
+                to_remove_item_locs.push_back(item_loc_in_bin);
+
                 curr_bin_idx++;
             }
 
-            // We got to this point, so all of the items were found. Now just erase them.
+            // We got to this point, so all of the items were found. Now erase them together with
+            // the corresponding label parts.
             curr_bin_idx = start_bin_idx;
-            for (auto to_remove_item_it : to_remove_item_its) {
+            for (size_t item_loc_in_bin : to_remove_item_locs) {
                 // Remove the item
-                filters_[curr_bin_idx].remove(*to_remove_item_it);
-                item_bins_[curr_bin_idx].erase(to_remove_item_it);
+                filters_.remove(curr_bin_idx, bins_.column(curr_bin_idx, 0)[item_loc_in_bin]);
+                bins_.erase(curr_bin_idx, item_loc_in_bin);
 
-                // Indicate that the polynomials need to be recomputed
-                cache_invalid_ = true;
+                // Indicate that the polynomials of this bin need to be recomputed
+                mark_bin_dirty(curr_bin_idx);
 
                 curr_bin_idx++;
             }
 
-            // Finally erase the label parts
-            for (size_t label_idx = 0; label_idx < get_label_size(); label_idx++) {
-                curr_bin_idx = start_bin_idx;
-                for (auto to_remove_label_it : to_remove_label_its[label_idx]) {
-                    // Remove the label
-                    label_bins_[label_idx][curr_bin_idx].erase(to_remove_label_it);
-
-                    curr_bin_idx++;
-                }
-            }
-
             return true;
         }
 
         bool BinBundle::try_get_multi_label(
-            const vector<felt_t> &items, size_t start_bin_idx, vector<felt_t> &labels) const
+            gsl::span<const felt_t> items, size_t start_bin_idx, vector<felt_t> &labels) const
         {
             if (stripped_) {
                 APSU_LOG_ERROR("Cannot retrieve labels from a stripped BinBundle");
@@ -847,17 +1035,43 @@ namespace apsu {
             labels.clear();
             labels.resize(items.size() * get_label_size());
 
+            // Bins that were not copied out of the loaded buffer are searched in place
+            if (!unmaterialized_.empty()) {
+                auto bb = fbs::GetSizePrefixedBinBundle(unmaterialized_.data());
+                size_t curr_bin_idx = start_bin_idx;
+                for (size_t item_idx = 0; item_idx < items.size(); item_idx++) {
+                    auto bin_offset = static_cast<flatbuffers::uoffset_t>(curr_bin_idx);
+                    const auto &curr_bin = *bb->item_bins()->rows()->Get(bin_offset)->felts();
+                    auto item_it = find(curr_bin.begin(), curr_bin.end(), items[item_idx]);
+                    if (curr_bin.end() == item_it) {
+                        labels.clear();
+                        return false;
+                    }
+
+                    auto item_idx_in_bin =
+                        static_cast<flatbuffers::uoffset_t>(item_it - curr_bin.begin());
+                    for (size_t label_idx = 0; label_idx < get_label_size(); label_idx++) {
+                        const auto &label_bins =
+                            *bb->label_bins()->Get(static_cast<flatbuffers::uoffset_t>(label_idx));
+                        labels[items.size() * label_idx + item_idx] =
+                            label_bins.rows()->Get(bin_offset)->felts()->Get(item_idx_in_bin);
+                    }
+
+                    curr_bin_idx++;
+                }
+
+                return true;
+            }
+
             // Go through all the items. If the item appears, find its label and write to labels. If
             // any item doesn't appear, we scrap the whole computation and return false.
             size_t curr_bin_idx = start_bin_idx;
             for (size_t item_idx = 0; item_idx < items.size(); item_idx++) {
-                const vector<felt_t> &curr_bin = item_bins_[curr_bin_idx];
-                const CuckooFilter &curr_filter = filters_[curr_bin_idx];
-
                 // Find the item if present in this bin
-                auto item_it = get_iterator(curr_bin, curr_filter, items[item_idx]);
+                size_t item_idx_in_bin =
+                    find_in_bin(bins_, filters_, curr_bin_idx, items[item_idx]);
 
-                if (curr_bin.end() == item_it) {
+                if (item_idx_in_bin == bins_.size(curr_bin_idx)) {
                     // One of the items isn't there. No label to fetch. Clear the labels and return
                     // early.
                     labels.clear();
@@ -865,11 +1079,10 @@ namespace apsu {
                 }
 
                 // Found the (felt) item. Next collect the label parts for this and write to label.
-                size_t item_idx_in_bin = static_cast<size_t>(distance(curr_bin.begin(), item_it));
                 for (size_t label_idx = 0; label_idx < get_label_size(); label_idx++) {
                     // Need to reorder the felts
                     labels[items.size() * label_idx + item_idx] =
-                        label_bins_[label_idx][curr_bin_idx][item_idx_in_bin];
+                        bins_.column(curr_bin_idx, label_idx + 1)[item_idx_in_bin];
                 }
 
                 curr_bin_idx++;
@@ -878,34 +1091,28 @@ namespace apsu {
             return true;
         }
 
+        void BinBundle::reset_bins(bool allocate)
+        {
+            // Clear item and label data
+            bins_ = allocate ? BinArena(num_bins_, 1 + label_size_) : BinArena();
+
+            // Nothing has been computed yet, so there is nothing to recompute selectively
+            dirty_bins_.assign(allocate ? num_bins_ : 0, false);
+
+            // Clear filters
+            filters_ = allocate ? CuckooFilterArray(num_bins_, max_bin_size_, /* bits per tag */ 12)
+                                : CuckooFilterArray();
+        }
+
         void BinBundle::clear(bool stripped)
         {
             // Set the stripped flag
             stripped_ = stripped;
 
-            // Clear item data
-            item_bins_.clear();
-            if (!stripped_) {
-                item_bins_.resize(num_bins_);
-            }
-
-            // Clear label data
-            label_bins_.clear();
-            if (!stripped_) {
-                label_bins_.reserve(label_size_);
-                for (size_t i = 0; i < label_size_; i++) {
-                    label_bins_.emplace_back(num_bins_);
-                }
-            }
-
-            // Clear filters
-            filters_.clear();
-            if (!stripped_) {
-                filters_.reserve(num_bins_);
-                for (size_t i = 0; i < num_bins_; i++) {
-                    filters_.emplace_back(max_bin_size_, /* bits per tag */ 12);
-                }
-            }
+            // Forget the loaded buffer, if any, and reset the bins
+            unmaterialized_ = {};
+            unmaterialized_data_.reset();
+            reset_bins(!stripped_);
 
             // Clear the cache
             clear_cache();
@@ -933,8 +1140,10 @@ namespace apsu {
 
         void BinBundle::regen_plaintexts()
         {
-            // This function assumes that BinBundle::clear_cache and BinBundle::regen_polyns have
-            // been called and the polynomials have not been modified since then.
+            STOPWATCH(recv_stopwatch, "BinBundle::regen_plaintexts");
+
+            // This function assumes that BinBundle::regen_polyns has been called and the
+            // polynomials have not been modified since then.
 
             // Allocate memory for the batched "label polynomials"
             cache_.batched_interp_polyns.resize(get_label_size());
@@ -966,17 +1175,19 @@ namespace apsu {
                 }));
             }
 
-            // Wait for the tasks to finish
+            // Wait for the tasks to finish, helping with them; this may run inside a pool task
             for (auto &f : futures) {
-                f.get();
+                tpm.thread_pool().get(f);
             }
         }
 
         void BinBundle::regen_polyns()
         {
-            // This function assumes that BinBundle::clear_cache has been called and the polynomials
-            // have not been modified since then. Specifically, it assumes that item_bins_ is empty
-            // and and label_bins_ is set to the correct size.
+            STOPWATCH(recv_stopwatch, "BinBundle::regen_polyns");
+
+            // If BinBundle::clear_cache has been called, every bin is computed. Otherwise cache_
+            // holds the polynomials of every bin as of the last call, and only the bins that have
+            // changed since are computed again.
 
             // Get the field modulus. We need this for polynomial calculations
             // auto start = chrono::steady_clock::now(); 
@@ -984,6 +1195,7 @@ namespace apsu {
 
             size_t num_bins = get_num_bins();
             size_t label_size = get_label_size();
+            bool all_bins = cache_.felt_matching_polyns.size() != num_bins;
             cache_.felt_matching_polyns.resize(num_bins);
             cache_.felt_interp_polyns.resize(label_size);
             for (auto &fips : cache_.felt_interp_polyns) {
@@ -996,9 +1208,12 @@ namespace apsu {
             // For each bin in the bundle, compute and cache the corresponding "matching
             // polynomial"
             for (size_t bin_idx = 0; bin_idx < num_bins; bin_idx++) {
+                if (!all_bins && !dirty_bins_[bin_idx]) {
+                    continue;
+                }
                 futures.push_back(tpm.thread_pool().enqueue([&, bin_idx]() {
                     // Compute and cache the matching polynomial
-                    FEltPolyn fmp = polyn_with_roots(item_bins_[bin_idx], mod);
+                    FEltPolyn fmp = polyn_with_roots(bins_.column(bin_idx, 0), mod);
                     cache_.felt_matching_polyns[bin_idx] = move(fmp);
                 }));
             }
@@ -1006,19 +1221,23 @@ namespace apsu {
             // For each bin in the bundle, compute and cache the corresponding "label polynomials"
             for (size_t label_idx = 0; label_idx < label_size; label_idx++) {
                 for (size_t bin_idx = 0; bin_idx < num_bins; bin_idx++) {
+                    if (!all_bins && !dirty_bins_[bin_idx]) {
+                        continue;
+                    }
                     futures.push_back(tpm.thread_pool().enqueue([&, label_idx, bin_idx]() {
                         // Compute and cache the matching polynomial
                         FEltPolyn fip = newton_interpolate_polyn(
-                            item_bins_[bin_idx], label_bins_[label_idx][bin_idx], mod);
+                            bins_.column(bin_idx, 0), bins_.column(bin_idx, label_idx + 1), mod);
                         cache_.felt_interp_polyns[label_idx][bin_idx] = move(fip);
                     }));
                 }
             }
 
-            // Wait for the tasks to finish
+            // Wait for the tasks to finish, helping with them; this may run inside a pool task
             for (auto &f : futures) {
-                f.get();
+                tpm.thread_pool().get(f);
             }
+            dirty_bins_.assign(num_bins, false);
             // auto finish = chrono::steady_clock::now(); 
             // auto dur = finish - start;
             // cout<<"one bundle time"<<std::chrono::duration<double> (dur).count() << std::endl;
@@ -1029,20 +1248,48 @@ namespace apsu {
         {
             // Only recompute the cache if it needs to be recomputed
             if (cache_invalid_) {
-              
-                clear_cache();
-           
+                materialize();
+
+                // Keep the polynomials of unchanged bins if every bin has them; a stripped
+                // BinBundle has no bins to recompute them from
+                if (stripped_ || cache_.felt_matching_polyns.size() != get_num_bins()) {
+                    clear_cache();
+                }
+
                 regen_polyns();
-              
+
                 regen_plaintexts();
-                
+
                 cache_invalid_ = false;
             }
         }
 
+        size_t BinBundle::get_bin_size(size_t bin_idx) const
+        {
+            if (!unmaterialized_.empty()) {
+                auto bin_offset = static_cast<flatbuffers::uoffset_t>(bin_idx);
+                return fbs::GetSizePrefixedBinBundle(unmaterialized_.data())
+                    ->item_bins()
+                    ->rows()
+                    ->Get(bin_offset)
+                    ->felts()
+                    ->size();
+            }
+
+            return bins_.size(bin_idx);
+        }
+
         bool BinBundle::empty() const
         {
-            return all_of(item_bins_.begin(), item_bins_.end(), [](auto &b) { return b.empty(); });
+            if (!unmaterialized_.empty()) {
+                const auto &item_bins =
+                    *fbs::GetSizePrefixedBinBundle(unmaterialized_.data())->item_bins()->rows();
+                return all_of(item_bins.begin(), item_bins.end(), [](auto b) {
+                    return !b->felts()->size();
+                });
+            }
+
+            return bins_.empty();
         }
 
         void BinBundle::strip()
@@ -1052,9 +1299,12 @@ namespace apsu {
 
             stripped_ = true;
 
-            item_bins_.clear();
-            label_bins_.clear();
-            filters_.clear();
+            // Bins that were never copied out of the loaded buffer need only be forgotten
+            unmaterialized_ = {};
+            unmaterialized_data_.reset();
+
+            bins_ = BinArena();
+            filters_ = CuckooFilterArray();
 
             cache_.felt_matching_polyns.clear();
             cache_.felt_interp_polyns.clear();
@@ -1081,8 +1331,25 @@ namespace apsu {
                 return fbs::CreateFEltMatrix(fbs_builder, felt_matrix_data);
             }
 
+            flatbuffers::Offset<fbs::FEltMatrix> fbs_create_felt_matrix(
+                flatbuffers::FlatBufferBuilder &fbs_builder,
+                const BinArena &bins,
+                size_t column_idx)
+            {
+                auto felt_matrix_data = fbs_builder.CreateVector([&]() {
+                    vector<flatbuffers::Offset<fbs::FEltArray>> ret;
+                    for (size_t bin_idx = 0; bin_idx < bins.bin_count(); bin_idx++) {
+                        gsl::span<const felt_t> felts = bins.column(bin_idx, column_idx);
+                        auto felt_array_data = fbs_builder.CreateVector(felts.data(), felts.size());
+                        ret.push_back(fbs::CreateFEltArray(fbs_builder, felt_array_data));
+                    }
+                    return ret;
+                }());
+                return fbs::CreateFEltMatrix(fbs_builder, felt_matrix_data);
+            }
+
             flatbuffers::Offset<fbs::Plaintext> fbs_create_plaintext(
-                flatbuffers::FlatBufferBuilder &fbs_builder, const vector<unsigned char> &pt)
+                flatbuffers::FlatBufferBuilder &fbs_builder, gsl::span<const unsigned char> pt)
             {
                 auto pt_data = fbs_builder.CreateVector(
                     reinterpret_cast<const uint8_t *>(pt.data()), pt.size());
@@ -1091,7 +1358,7 @@ namespace apsu {
 
             flatbuffers::Offset<fbs::BatchedPlaintextPolyn> fbs_create_batched_plaintext_polyn(
                 flatbuffers::FlatBufferBuilder &fbs_builder,
-                const vector<vector<unsigned char>> &polyn)
+                const vector<gsl::span<const unsigned char>> &polyn)
             {
                 auto polyn_data = fbs_builder.CreateVector([&]() {
                     vector<flatbuffers::Offset<fbs::Plaintext>> ret;
@@ -1104,16 +1371,31 @@ namespace apsu {
             }
         } // namespace
 
-        size_t BinBundle::save(ostream &out, uint32_t bundle_idx) const
+        vector<unsigned char> BinBundle::save(uint32_t bundle_idx) const
         {
+            // An unmodified loaded BinBundle is saved exactly as it was loaded; its cache, even if
+            // cleared since, was computed from the same bins
+            if (!unmaterialized_.empty()) {
+                uint32_t loaded_bundle_idx =
+                    fbs::GetSizePrefixedBinBundle(unmaterialized_.data())->bundle_idx();
+                if (loaded_bundle_idx != bundle_idx) {
+                    APSU_LOG_ERROR(
+                        "Cannot save a BinBundle loaded at bundle index "
+                        << loaded_bundle_idx << " at bundle index " << bundle_idx);
+                    throw logic_error("failed to save BinBundle");
+                }
+
+                return { unmaterialized_.begin(), unmaterialized_.end() };
+            }
+
             flatbuffers::FlatBufferBuilder fbs_builder(1024);
 
             // Write the items and labels
-            auto item_bins = fbs_create_felt_matrix(fbs_builder, item_bins_);
+            auto item_bins = fbs_create_felt_matrix(fbs_builder, bins_, 0);
             auto label_bins = fbs_builder.CreateVector([&]() {
                 vector<flatbuffers::Offset<fbs::FEltMatrix>> ret;
-                for (auto &bin : label_bins_) {
-                    ret.push_back(fbs_create_felt_matrix(fbs_builder, bin));
+                for (size_t column_idx = 1; column_idx < bins_.column_count(); column_idx++) {
+                    ret.push_back(fbs_create_felt_matrix(fbs_builder, bins_, column_idx));
                 }
                 return ret;
             }());
@@ -1161,14 +1443,145 @@ namespace apsu {
             auto bb = bin_bundle_builder.Finish();
             fbs_builder.FinishSizePrefixed(bb);
 
+            const unsigned char *out_data = fbs_builder.GetBufferPointer();
+            return { out_data, out_data + fbs_builder.GetSize() };
+        }
+
+        size_t BinBundle::save(ostream &out, uint32_t bundle_idx) const
+        {
+            vector<unsigned char> out_data = save(bundle_idx);
             out.write(
-                reinterpret_cast<const char *>(fbs_builder.GetBufferPointer()),
-                safe_cast<streamsize>(fbs_builder.GetSize()));
+                reinterpret_cast<const char *>(out_data.data()),
+                safe_cast<streamsize>(out_data.size()));
+
+            return out_data.size();
+        }
+
+        namespace {
+            /**
+            Points the coefficients of a BatchedPlaintextPolyn to serialized plaintexts in a buffer
+            owned by in_data.
+            */
+            void load_batched_plaintext_polyn(
+                BatchedPlaintextPolyn &polyn,
+                const flatbuffers::Vector<flatbuffers::Offset<fbs::Plaintext>> &coeffs,
+                const shared_ptr<const void> &in_data)
+            {
+                polyn.batched_coeffs.reserve(coeffs.size());
+                for (const auto coeff : coeffs) {
+                    polyn.batched_coeffs.emplace_back(
+                        reinterpret_cast<const unsigned char *>(coeff->data()->data()),
+                        coeff->data()->size());
+                }
+                polyn.coeff_data = in_data;
+            }
+        } // namespace
+
+        void BinBundle::load_bins(const fbs::BinBundle &bb)
+        {
+            size_t num_bins = get_num_bins();
+            size_t label_size = get_label_size();
+
+            // The bins are empty, so each is placed right after the previous one
+            const auto &item_bins = *bb.item_bins()->rows();
+            for (size_t bin_idx = 0; bin_idx < num_bins; bin_idx++) {
+                auto &item_bin = *item_bins[static_cast<flatbuffers::uoffset_t>(bin_idx)]->felts();
+                bins_.resize(bin_idx, item_bin.size());
+
+                gsl::span<felt_t> items = bins_.column(bin_idx, 0);
+                copy(item_bin.begin(), item_bin.end(), items.begin());
+                for (size_t item_idx = 0; item_idx < items.size(); item_idx++) {
+                    felt_t felt_item = items[item_idx];
+#ifdef APSU_DEBUG
+                    if (label_size && filters_.contains(bin_idx, felt_item) &&
+                        is_present(items.first(item_idx), felt_item)) {
+                        APSU_LOG_ERROR(
+                            "The loaded BinBundle data contains a repeated value "
+                            << felt_item << " in bin at index " << bin_idx);
+                        throw runtime_error("failed to load BinBundle");
+                    }
+#endif
+                    // Add to the cuckoo filter
+                    filters_.add(bin_idx, felt_item);
+                }
+            }
+
+            // Loading checked that every label bin has as many parts as its item bin
+            for (size_t label_idx = 0; label_idx < label_size; label_idx++) {
+                auto &label_bins =
+                    *bb.label_bins()->Get(static_cast<flatbuffers::uoffset_t>(label_idx))->rows();
+                for (size_t bin_idx = 0; bin_idx < num_bins; bin_idx++) {
+                    auto &label_bin =
+                        *label_bins[static_cast<flatbuffers::uoffset_t>(bin_idx)]->felts();
+                    copy(
+                        label_bin.begin(),
+                        label_bin.end(),
+                        bins_.column(bin_idx, label_idx + 1).begin());
+                }
+            }
+        }
+
+        void BinBundle::load_felt_polyns(const fbs::BinBundle &bb)
+        {
+            size_t num_bins = get_num_bins();
+            size_t label_size = get_label_size();
+            const auto &cache = *bb.cache();
+
+            const auto &felt_matching_polyns = *cache.felt_matching_polyns()->rows();
+            cache_.felt_matching_polyns.reserve(num_bins);
+            for (size_t bin_idx = 0; bin_idx < num_bins; bin_idx++) {
+                auto &felt_matching_polyn =
+                    *felt_matching_polyns[static_cast<flatbuffers::uoffset_t>(bin_idx)]->felts();
+                cache_.felt_matching_polyns.emplace_back(
+                    felt_matching_polyn.begin(), felt_matching_polyn.end());
+            }
+
+            cache_.felt_interp_polyns.resize(label_size);
+            for (size_t label_idx = 0; label_idx < label_size; label_idx++) {
+                const auto &felt_interp_polyns =
+                    *cache.felt_interp_polyns()
+                         ->Get(static_cast<flatbuffers::uoffset_t>(label_idx))
+                         ->rows();
+                cache_.felt_interp_polyns[label_idx].reserve(num_bins);
+                for (size_t bin_idx = 0; bin_idx < num_bins; bin_idx++) {
+                    auto &felt_interp_polyn =
+                        *felt_interp_polyns[static_cast<flatbuffers::uoffset_t>(bin_idx)]->felts();
+                    cache_.felt_interp_polyns[label_idx].emplace_back(
+                        felt_interp_polyn.begin(), felt_interp_polyn.end());
+                }
+            }
+        }
+
+        void BinBundle::materialize()
+        {
+            if (unmaterialized_.empty()) {
+                return;
+            }
+
+            // The buffer was verified when it was loaded
+            auto bb = fbs::GetSizePrefixedBinBundle(unmaterialized_.data());
+
+            reset_bins(true);
+            load_bins(*bb);
 
-            return fbs_builder.GetSize();
+            // Polynomials of a cleared cache would be recomputed anyway
+            if (!cache_invalid_) {
+                load_felt_polyns(*bb);
+            }
+
+            unmaterialized_ = {};
+            unmaterialized_data_.reset();
         }
 
         pair<uint32_t, size_t> BinBundle::load(gsl::span<const unsigned char> in)
+        {
+            auto in_data = make_shared<vector<unsigned char>>(in.begin(), in.end());
+            gsl::span<const unsigned char> in_view(*in_data);
+            return load(in_view, move(in_data));
+        }
+
+        pair<uint32_t, size_t> BinBundle::load(
+            gsl::span<const unsigned char> in, shared_ptr<const void> in_data)
         {
             auto verifier = flatbuffers::Verifier(
                 reinterpret_cast<const unsigned char *>(in.data()), in.size());
@@ -1193,9 +1606,10 @@ namespace apsu {
                 throw runtime_error("failed to load BinBundle");
             }
 
-            // Remove all data and clear the cache; reset data structures according to the stripped
-            // flag
-            clear(bb->stripped());
+            // Remove all data and clear the cache. The bins are not allocated here: they stay in
+            // the buffer until materialize copies them out.
+            clear(true);
+            stripped_ = bb->stripped();
 
             // Check that the number of bins is correct
             size_t num_bins = get_num_bins();
@@ -1217,10 +1631,9 @@ namespace apsu {
             // The loaded label size must match the label size for this BinBundle
             size_t label_size = get_label_size();
 
+            // Check that the sizes of the bins are at most max_bin_size_
             for (size_t bin_idx = 0; !stripped_ && (bin_idx < num_bins); bin_idx++) {
                 auto &item_bin = *item_bins[static_cast<flatbuffers::uoffset_t>(bin_idx)]->felts();
-
-                // Check that the sizes of the bins are at most max_bin_size_
                 if (item_bin.size() > max_bin_size_) {
                     APSU_LOG_ERROR(
                         "The loaded BinBundle has an item bin of size "
@@ -1228,28 +1641,6 @@ namespace apsu {
                         << max_bin_size_);
                     throw runtime_error("failed to load BinBundle");
                 }
-
-                // All is good; copy over the item data
-                transform(
-                    item_bin.begin(),
-                    item_bin.end(),
-                    back_inserter(item_bins_[bin_idx]),
-                    [&](auto felt_item) {
-#ifdef APSU_DEBUG
-                        if (label_size &&
-                            is_present(item_bins_[bin_idx], filters_[bin_idx], felt_item)) {
-                            APSU_LOG_ERROR(
-                                "The loaded BinBundle data contains a repeated value "
-                                << felt_item << " in bin at index " << bin_idx);
-                            throw runtime_error("failed to load BinBundle");
-                        }
-#endif
-                        // Add to the cuckoo filter
-                        filters_[bin_idx].add(felt_item);
-
-                        // Return to add the item to item_bins_[bin_idx]
-                        return felt_item;
-                    });
             }
 
             // We are now done with the item data; next check that the label size is correct
@@ -1270,10 +1661,8 @@ namespace apsu {
 
             for (size_t label_idx = 0; !stripped_ && (label_idx < label_size); label_idx++) {
                 // We can now safely dereference bb->label_bins()
-                auto &label_bins = *bb->label_bins()
-                                        ->
-                                        operator[](static_cast<flatbuffers::uoffset_t>(label_idx))
-                                        ->rows();
+                auto &label_bins =
+                    *bb->label_bins()->Get(static_cast<flatbuffers::uoffset_t>(label_idx))->rows();
 
                 // Check that the number of bins is the same as for the items
                 if (label_bins.size() != num_bins) {
@@ -1286,22 +1675,16 @@ namespace apsu {
 
                 // Check that each bin has the same size as the corresponding items bin
                 for (size_t bin_idx = 0; bin_idx < num_bins; bin_idx++) {
-                    size_t item_bin_size = item_bins_[bin_idx].size();
-                    auto &label_bin =
-                        *label_bins[static_cast<flatbuffers::uoffset_t>(bin_idx)]->felts();
-                    if (label_bin.size() != item_bin_size) {
+                    auto bin_offset = static_cast<flatbuffers::uoffset_t>(bin_idx);
+                    size_t item_bin_size = item_bins[bin_offset]->felts()->size();
+                    size_t label_bin_size = label_bins[bin_offset]->felts()->size();
+                    if (label_bin_size != item_bin_size) {
                         APSU_LOG_ERROR(
                             "The loaded BinBundle has at bin index "
-                            << bin_idx << " a label bin of size " << label_bin.size()
+                            << bin_idx << " a label bin of size " << label_bin_size
                             << " which does not match the item bin size " << item_bin_size);
                         throw runtime_error("failed to load BinBundle");
                     }
-
-                    // All is good; copy over the label data
-                    copy(
-                        label_bin.begin(),
-                        label_bin.end(),
-                        back_inserter(label_bins_[label_idx][bin_idx]));
                 }
             }
 
@@ -1328,20 +1711,12 @@ namespace apsu {
 
                 // We keep track of the largest polynomial coefficient count
                 size_t max_coeff_count = 0;
-
                 for (size_t bin_idx = 0; !stripped_ && (bin_idx < num_bins); bin_idx++) {
-                    auto &felt_matching_polyn =
-                        *felt_matching_polyns[static_cast<flatbuffers::uoffset_t>(bin_idx)]
-                             ->felts();
-
-                    // Copy over the matching polynomial coefficients for this bin index
-                    FEltPolyn p;
-                    p.reserve(felt_matching_polyn.size());
-                    copy(felt_matching_polyn.begin(), felt_matching_polyn.end(), back_inserter(p));
-                    cache_.felt_matching_polyns.push_back(move(p));
-
-                    // Keep track of the largest coefficient count
-                    max_coeff_count = max<size_t>(max_coeff_count, felt_matching_polyn.size());
+                    size_t coeff_count =
+                        felt_matching_polyns[static_cast<flatbuffers::uoffset_t>(bin_idx)]
+                            ->felts()
+                            ->size();
+                    max_coeff_count = max<size_t>(max_coeff_count, coeff_count);
                 }
 
                 // max_coeff_count can't be larger than the bin size
@@ -1373,26 +1748,10 @@ namespace apsu {
                     throw runtime_error("failed to load BinBundle");
                 }
 
-                // Create the batched matching polynomial; we load the data below
+                // The number of plaintexts is correct; refer to them in the buffer
                 cache_.batched_matching_polyn = crypto_context_;
-
-                // The number of plaintexts is correct; copy them over
-                for (flatbuffers::uoffset_t coeff_idx = 0;
-                     coeff_idx < batched_matching_polyn.size();
-                     coeff_idx++) {
-                    // Get the current coefficient data
-                    auto &batched_matching_polyn_coeff = *batched_matching_polyn[coeff_idx]->data();
-
-                    // Copy the data over to a local vector
-                    vector<unsigned char> pt_data(batched_matching_polyn_coeff.size());
-                    copy_bytes(
-                        batched_matching_polyn_coeff.data(),
-                        batched_matching_polyn_coeff.size(),
-                        pt_data.data());
-
-                    // Move the loaded data to the cache
-                    cache_.batched_matching_polyn.batched_coeffs.push_back(move(pt_data));
-                }
+                load_batched_plaintext_polyn(
+                    cache_.batched_matching_polyn, batched_matching_polyn, in_data);
 
                 // We are now done with the item cache data; next check that the label cache size is
                 // correct
@@ -1416,22 +1775,17 @@ namespace apsu {
                     throw runtime_error("failed to load BinBundle");
                 }
 
-                // Resize felt_interp_polyns to correct size at this point; reserve space for
-                // batched_interp_polyns but construct them only when needed
-                if (!stripped_) {
-                    cache_.felt_interp_polyns.resize(label_size);
-                }
+                // Reserve space for batched_interp_polyns but construct them only when needed
                 cache_.batched_interp_polyns.reserve(label_size);
 
                 for (size_t label_idx = 0; label_idx < label_size; label_idx++) {
+                    auto label_offset = static_cast<flatbuffers::uoffset_t>(label_idx);
+
                     // The felt interpolation polynomial data is present only when the BinBundle is
                     // not stripped
                     auto felt_interp_polyns_ptr =
                         stripped_ ? nullptr
-                                  : cache.felt_interp_polyns()
-                                        ->
-                                        operator[](static_cast<flatbuffers::uoffset_t>(label_idx))
-                                        ->rows();
+                                  : cache.felt_interp_polyns()->Get(label_offset)->rows();
 
                     // Do we have the right number of rows in the loaded felt_interp_polyns data?
                     if (!stripped_ && (felt_interp_polyns_ptr->size() != num_bins)) {
@@ -1442,19 +1796,16 @@ namespace apsu {
                         throw runtime_error("failed to load BinBundle");
                     }
 
-                    // Next, check that the number of coefficients is correct and copy data over
+                    // Next, check that the number of coefficients is correct
                     for (size_t bin_idx = 0; !stripped_ && (bin_idx < num_bins); bin_idx++) {
-                        auto &felt_interp_polyn =
-                            *felt_interp_polyns_ptr
-                                 ->
-                                 operator[](static_cast<flatbuffers::uoffset_t>(bin_idx))
-                                 ->felts();
+                        auto bin_offset = static_cast<flatbuffers::uoffset_t>(bin_idx);
 
                         // Compare the number of interpolation polynomial coefficients to the number
                         // of matching polynomial coefficients
                         size_t matching_polyn_coeff_count =
-                            cache_.felt_matching_polyns[bin_idx].size();
-                        size_t interp_polyn_coeff_count = felt_interp_polyn.size();
+                            felt_matching_polyns[bin_offset]->felts()->size();
+                        size_t interp_polyn_coeff_count =
+                            felt_interp_polyns_ptr->Get(bin_offset)->felts()->size();
 
                         // This is an empty bin if the matching polynomial has zero or one
                         // coefficients; in this case the interpolation polynomial size should equal
@@ -1464,8 +1815,7 @@ namespace apsu {
                         size_t expected_interp_polyn_coeff_count =
                             empty_bin ? matching_polyn_coeff_count : matching_polyn_coeff_count - 1;
 
-                        if (!stripped_ &&
-                            (interp_polyn_coeff_count != expected_interp_polyn_coeff_count)) {
+                        if (interp_polyn_coeff_count != expected_interp_polyn_coeff_count) {
                             APSU_LOG_ERROR(
                                 "The loaded BinBundle cache has at bin index "
                                 << bin_idx << " " << interp_polyn_coeff_count
@@ -1473,21 +1823,12 @@ namespace apsu {
                                 << expected_interp_polyn_coeff_count << ")");
                             throw runtime_error("failed to load BinBundle");
                         }
-
-                        // Copy over the interpolation polynomial coefficients for this bin index
-                        FEltPolyn p;
-                        p.reserve(interp_polyn_coeff_count);
-                        copy(felt_interp_polyn.begin(), felt_interp_polyn.end(), back_inserter(p));
-                        cache_.felt_interp_polyns[label_idx].push_back(move(p));
                     }
 
                     // Finally check that the number of batched interpolation polynomial
-                    // coefficients is correct and copy them over.
+                    // coefficients is correct and refer to them.
                     auto &batched_interp_polyn =
-                        *cache.batched_interp_polyns()
-                             ->
-                             operator[](static_cast<flatbuffers::uoffset_t>(label_idx))
-                             ->coeffs();
+                        *cache.batched_interp_polyns()->Get(label_offset)->coeffs();
                     flatbuffers::uoffset_t batched_interp_polyn_coeff_count =
                         batched_interp_polyn.size();
                     bool empty_bundle = max_coeff_count <= 1;
@@ -1511,40 +1852,29 @@ namespace apsu {
                         throw runtime_error("failed to load BinBundle");
                     }
 
-                    // Create a new batched interpolation polynomial; we load the data below
                     cache_.batched_interp_polyns.emplace_back(crypto_context_);
-
-                    // The number of plaintexts is correct; copy them over
-                    for (flatbuffers::uoffset_t coeff_idx = 0;
-                         coeff_idx < batched_interp_polyn_coeff_count;
-                         coeff_idx++) {
-                        // Get the current coefficient data
-                        auto &batched_interp_polyn_coeff = *batched_interp_polyn[coeff_idx]->data();
-
-                        // Copy the data over to a local vector
-                        vector<unsigned char> pt_data(batched_interp_polyn_coeff.size());
-                        copy_bytes(
-                            batched_interp_polyn_coeff.data(),
-                            batched_interp_polyn_coeff.size(),
-                            pt_data.data());
-
-                        // Move the loaded data to the cache
-                        cache_.batched_interp_polyns[label_idx].batched_coeffs.push_back(
-                            move(pt_data));
-                    }
+                    load_batched_plaintext_polyn(
+                        cache_.batched_interp_polyns[label_idx], batched_interp_polyn, in_data);
                 }
 
                 // Mark the cache as valid
                 cache_invalid_ = false;
             }
 
+            // Keep the bins in the buffer until they are needed
+            if (!stripped_) {
+                unmaterialized_ = in;
+                unmaterialized_data_ = move(in_data);
+            }
+
             return { bundle_idx, in.size() };
         }
 
         pair<uint32_t, size_t> BinBundle::load(istream &in)
         {
-            vector<unsigned char> in_data = read_from_stream(in);
-            return load(in_data);
+            auto in_data = make_shared<vector<unsigned char>>(read_from_stream(in));
+            gsl::span<const unsigned char> in_view(*in_data);
+            return load(in_view, move(in_data));
         }
     } // namespace receiver
 } // namespace apsu
@@ -9,8 +9,10 @@
 #include <vector>
 
 // APSU
+#include "apsu/bin_arena.h"
 #include "apsu/crypto_context.h"
-#include "apsu/util/cuckoo_filter.h"
+#include "apsu/plaintext_cache.h"
+#include "apsu/util/cuckoo_filter_array.h"
 #include "apsu/util/db_encoding.h"
 
 // SEAL
@@ -23,6 +25,10 @@
 using namespace apsu::util;
 
 namespace apsu {
+    namespace fbs {
+        struct BinBundle;
+    } // namespace fbs
+
     namespace receiver {
         /**
         Represents a polynomial with coefficients that are field elements. Coefficients are stored
@@ -54,13 +60,24 @@ namespace apsu {
             A sequence of coefficients represented as batched plaintexts. The length of this vector
             is the degree of the highest-degree polynomial in the sequence.
             */
-            std::vector<std::vector<unsigned char>> batched_coeffs;
+            std::vector<gsl::span<const unsigned char>> batched_coeffs;
+
+            /**
+            Owns the memory batched_coeffs points to: the encoded coefficients themselves, or the
+            serialized BinBundle, possibly in a MappedFile, they were loaded from.
+            */
+            std::shared_ptr<const void> coeff_data;
 
             /**
             We need this to compute eval()
             */
             CryptoContext crypto_context;
 
+            /**
+            The coefficients loaded as Plaintexts, while they are resident in the PlaintextCache.
+            */
+            std::shared_ptr<PlaintextCache::Slot> resident = std::make_shared<PlaintextCache::Slot>();
+
             BatchedPlaintextPolyn(const BatchedPlaintextPolyn &copy) = delete;
 
             BatchedPlaintextPolyn(BatchedPlaintextPolyn &&source) = default;
@@ -188,27 +205,17 @@ namespace apsu {
             CryptoContext crypto_context_;
 
             /**
-            Items (decomposed into field elements) for each bin in the BinBundle. The dimensions
-            are, in order:
-                - Bins in the BinBundle
-                - Field elements in the bin
-            */
-            std::vector<std::vector<felt_t>> item_bins_;
-
-            /**
-            Item-size chunks of the label (decomposed into field elements) for each bin in the
-            BinBundle. The dimensions are, in order:
-                - Components of the label
-                - Bins in the BinBundle
-                - Field elements in the bin
+            Items (decomposed into field elements) for each bin in the BinBundle, together with the
+            item-size chunks of their labels. Column 0 of a bin holds its items, and column i + 1
+            the i-th component of their labels.
             */
-            std::vector<std::vector<std::vector<felt_t>>> label_bins_;
+            BinArena bins_;
 
             /**
-            Each bin in the BinBundle has a CuckooFilter that helps quickly determine whether a
-            field element is contained.
+            Each bin in the BinBundle has a Cuckoo Filter that helps quickly determine whether a
+            field element is contained. The filter of a bin has the same index in filters_.
             */
-            std::vector<util::CuckooFilter> filters_;
+            util::CuckooFilterArray filters_;
 
             /**
             Indicates whether SEAL plaintexts are compressed in memory.
@@ -246,6 +253,58 @@ namespace apsu {
             */
             BinBundleCache cache_;
 
+            /**
+            Bins whose data changed since their polynomials were last computed. While the cache
+            holds the field-element polynomials of every bin, regenerating it recomputes only the
+            polynomials of these bins.
+            */
+            std::vector<bool> dirty_bins_;
+
+            /**
+            The serialized BinBundle this BinBundle was loaded from, while its bins and field-element
+            polynomials have not been copied out of it; empty otherwise. Loading keeps only the
+            batched plaintexts, as views into the buffer, so a BinBundle that is only ever queried
+            never copies its bins. Anything that changes the bins first calls materialize.
+            */
+            gsl::span<const unsigned char> unmaterialized_;
+
+            /**
+            Owns the memory unmaterialized_ points to.
+            */
+            std::shared_ptr<const void> unmaterialized_data_;
+
+            /**
+            Copies the bins, and the field-element polynomials if the cache is valid, out of
+            unmaterialized_ and rebuilds the filters. Does nothing if there is nothing to copy.
+            */
+            void materialize();
+
+            /**
+            Copies the bins out of a verified serialized BinBundle and rebuilds the filters. The
+            bins must be empty.
+            */
+            void load_bins(const fbs::BinBundle &bb);
+
+            /**
+            Copies the field-element polynomials out of the cache of a verified serialized
+            BinBundle. The polynomials in cache_ must be empty.
+            */
+            void load_felt_polyns(const fbs::BinBundle &bb);
+
+            /**
+            Resets the bins and filters to num_bins_ empty ones, or to none if allocate is false.
+            */
+            void reset_bins(bool allocate);
+
+            /**
+            Marks the polynomials of a bin, and therefore the cache, for recomputation.
+            */
+            void mark_bin_dirty(std::size_t bin_idx)
+            {
+                dirty_bins_[bin_idx] = true;
+                cache_invalid_ = true;
+            }
+
             /**
             Returns the modulus that defines the finite field that we're working in
             */
@@ -254,7 +313,8 @@ namespace apsu {
             /**
             Computes and caches the appropriate polynomials of each bin. For unlabeled PSU, this is
             just the "matching" polynomial. For labeled PSU, this is the "matching" polynomial and
-            the Newton interpolation polynomial. Resulting values are stored in cache_.
+            the Newton interpolation polynomial. Resulting values are stored in cache_. Only the
+            dirty bins are computed, unless cache_ holds no polynomials.
             */
             void regen_polyns();
 
@@ -292,6 +352,12 @@ namespace apsu {
             std::int32_t multi_insert(
                 const std::vector<T> &item_labels, std::size_t start_bin_idx, bool dry_run);
 
+            /**
+            Inserts items without labels into sequential bins, as the function above does.
+            */
+            std::int32_t multi_insert(
+                gsl::span<const felt_t> items, std::size_t start_bin_idx, bool dry_run);
+
             /**
             Does a dry-run insertion of item-label pairs into sequential bins, beginning at
             start_bin_idx. This does not mutate the BinBundle. On success, returns the size of the
@@ -305,6 +371,15 @@ namespace apsu {
                 return multi_insert(item_labels, start_bin_idx, true);
             }
 
+            /**
+            Does a dry-run insertion of items without labels into sequential bins.
+            */
+            std::int32_t multi_insert_dry_run(
+                gsl::span<const felt_t> items, std::size_t start_bin_idx)
+            {
+                return multi_insert(items, start_bin_idx, true);
+            }
+
             /**
             Inserts item-label pairs into sequential bins, beginning at start_bin_idx. On success,
             returns the size of the largest bin bins in the modified range, after insertion has
@@ -318,23 +393,35 @@ namespace apsu {
                 return multi_insert(item_labels, start_bin_idx, false);
             }
 
+            /**
+            Inserts items without labels into sequential bins.
+            */
+            std::int32_t multi_insert_for_real(
+                gsl::span<const felt_t> items, std::size_t start_bin_idx)
+            {
+                return multi_insert(items, start_bin_idx, false);
+            }
+
             /**
             Attempts to overwrite the stored items' labels with the given labels. Returns true iff
             it found a contiguous sequence of given items. If no such sequence was found, this
-            BinBundle is not mutated. This function can be called on a
-            BinBundle<std::vector<felt_t>> but it won't do anything except force the cache to get
-            recomputed, so don't bother. The labeled case has T equal to std::pair<felt_t,
-            std::vector<felt_t>>.
+            BinBundle is not mutated. T is std::pair<felt_t, std::vector<felt_t>>.
             */
             template <typename T>
             bool try_multi_overwrite(const std::vector<T> &item_labels, std::size_t start_bin_idx);
 
+            /**
+            Overload for items without labels. It won't do anything except force the cache to get
+            recomputed, so don't bother.
+            */
+            bool try_multi_overwrite(gsl::span<const felt_t> items, std::size_t start_bin_idx);
+
             /**
             Attempts to remove the stored items and labels. Returns true iff it found a contiguous
             sequence of given items and the data was successfully removed. If no such sequence was
             found, this BinBundle is not mutated.
             */
-            bool try_multi_remove(const std::vector<felt_t> &items, std::size_t start_bin_idx);
+            bool try_multi_remove(gsl::span<const felt_t> items, std::size_t start_bin_idx);
 
             /**
             Sets the given labels to the set of labels associated with the sequence of items in this
@@ -342,7 +429,7 @@ namespace apsu {
             returns false and clears the given labels vector. Returns true on success.
             */
             bool try_get_multi_label(
-                const std::vector<felt_t> &items,
+                gsl::span<const felt_t> items,
                 std::size_t start_bin_idx,
                 std::vector<felt_t> &labels) const;
 
@@ -371,16 +458,20 @@ namespace apsu {
             const BinBundleCache &get_cache() const;
 
             /**
-            Generates and caches all the polynomials and plaintexts that this BinBundle requires
+            Generates and caches all the polynomials and plaintexts that this BinBundle requires.
+            If the cache was generated before and has not been cleared, only the polynomials of
+            bins that changed since then are recomputed; the batched plaintexts mix every bin and
+            are always re-encoded.
             */
             void regen_cache();
 
             /**
-            Returns a constant reference to the items in this BinBundle.
+            Returns a constant reference to the items and label parts in this BinBundle. This has
+            no bins for a loaded BinBundle whose bins have not been needed yet.
             */
-            const std::vector<std::vector<felt_t>> &get_item_bins() const noexcept
+            const BinArena &get_bins() const noexcept
             {
-                return item_bins_;
+                return bins_;
             }
 
             /**
@@ -400,12 +491,9 @@ namespace apsu {
             }
 
             /**
-            Returns a constant reference to the label parts in this BinBundle.
+            Returns the number of items in the given bin. The BinBundle must not be stripped.
             */
-            const std::vector<std::vector<std::vector<felt_t>>> &get_label_bins() const noexcept
-            {
-                return label_bins_;
-            }
+            std::size_t get_bin_size(std::size_t bin_idx) const;
 
             /**
             Returns whether this BinBundle is empty.
@@ -432,10 +520,24 @@ namespace apsu {
             std::size_t save(std::ostream &out, std::uint32_t bundle_idx) const;
 
             /**
-            Loads the BinBundle from a buffer.
+            Saves the BinBundle to a new size-prefixed buffer. BinBundles can be saved this way
+            concurrently.
+            */
+            std::vector<unsigned char> save(std::uint32_t bundle_idx) const;
+
+            /**
+            Loads the BinBundle from a buffer. The buffer is copied.
             */
             std::pair<std::uint32_t, std::size_t> load(gsl::span<const unsigned char> in);
 
+            /**
+            Loads the BinBundle from a buffer owned by in_data, which may be a util::MappedFile.
+            The buffer is verified once and not copied: the batched plaintexts refer to it, and the
+            bins are copied out of it only when the BinBundle is modified.
+            */
+            std::pair<std::uint32_t, std::size_t> load(
+                gsl::span<const unsigned char> in, std::shared_ptr<const void> in_data);
+
             /**
             Loads the BinBundle from a stream.
             */
@@ -0,0 +1,148 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+// STD
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+// APSU
+#include "apsu/bin_capacity_index.h"
+
+// SEAL
+#include "seal/util/common.h"
+
+using namespace std;
+using namespace seal::util;
+
+namespace apsu {
+    namespace receiver {
+        namespace {
+            constexpr uint32_t full_leaf = numeric_limits<uint32_t>::max();
+        } // namespace
+
+        BinCapacityIndex::BinCapacityIndex(size_t bins_per_bundle, size_t bins_per_item)
+            : bins_per_item_(bins_per_item)
+        {
+            if (!bins_per_item || bins_per_bundle % bins_per_item) {
+                throw invalid_argument("bins_per_bundle must be a multiple of bins_per_item");
+            }
+            slot_count_ = bins_per_bundle / bins_per_item;
+        }
+
+        void BinCapacityIndex::reserve(size_t leaf_count)
+        {
+            if (leaf_count <= leaf_count_) {
+                return;
+            }
+
+            size_t new_leaf_count = max<size_t>(leaf_count_, 1);
+            while (new_leaf_count < leaf_count) {
+                new_leaf_count <<= 1;
+            }
+
+            // Move the leaves over and recompute the inner nodes
+            vector<uint32_t> new_trees(slot_count_ * 2 * new_leaf_count, full_leaf);
+            for (size_t slot = 0; slot < slot_count_; slot++) {
+                const uint32_t *tree = trees_.data() + slot * 2 * leaf_count_;
+                uint32_t *new_tree = new_trees.data() + slot * 2 * new_leaf_count;
+                copy_n(tree + leaf_count_, bin_bundle_count_, new_tree + new_leaf_count);
+                for (size_t node = new_leaf_count - 1; node > 0; node--) {
+                    new_tree[node] = min(new_tree[2 * node], new_tree[2 * node + 1]);
+                }
+            }
+
+            trees_ = move(new_trees);
+            leaf_count_ = new_leaf_count;
+        }
+
+        void BinCapacityIndex::set_leaf(size_t slot, size_t bin_bundle_pos, uint32_t value)
+        {
+            uint32_t *tree = trees_.data() + slot * 2 * leaf_count_;
+            size_t node = leaf_count_ + bin_bundle_pos;
+            tree[node] = value;
+            for (node >>= 1; node > 0; node >>= 1) {
+                uint32_t smallest = min(tree[2 * node], tree[2 * node + 1]);
+                if (tree[node] == smallest) {
+                    break;
+                }
+                tree[node] = smallest;
+            }
+        }
+
+        void BinCapacityIndex::rebuild(const vector<BinBundle> &bin_bundles)
+        {
+            trees_.clear();
+            leaf_count_ = 0;
+            bin_bundle_count_ = 0;
+            reserve(bin_bundles.size());
+            bin_bundle_count_ = bin_bundles.size();
+            stale_ = false;
+            if (!bin_bundle_count_) {
+                return;
+            }
+
+            for (size_t slot = 0; slot < slot_count_; slot++) {
+                uint32_t *tree = trees_.data() + slot * 2 * leaf_count_;
+                for (size_t pos = 0; pos < bin_bundle_count_; pos++) {
+                    tree[leaf_count_ + pos] = safe_cast<uint32_t>(
+                        bin_bundles[pos].get_bin_size(slot * bins_per_item_));
+                }
+                for (size_t node = leaf_count_ - 1; node > 0; node--) {
+                    tree[node] = min(tree[2 * node], tree[2 * node + 1]);
+                }
+            }
+        }
+
+        void BinCapacityIndex::add_bin_bundle()
+        {
+            reserve(bin_bundle_count_ + 1);
+            for (size_t slot = 0; slot < slot_count_; slot++) {
+                set_leaf(slot, bin_bundle_count_, 0);
+            }
+            bin_bundle_count_++;
+        }
+
+        void BinCapacityIndex::set_bin_size(size_t bin_bundle_pos, size_t bin_idx, size_t size)
+        {
+            set_leaf(bin_idx / bins_per_item_, bin_bundle_pos, safe_cast<uint32_t>(size));
+        }
+
+        size_t BinCapacityIndex::find_last_smaller(size_t bin_idx, size_t bound, size_t end) const
+        {
+            end = min(end, bin_bundle_count_);
+            if (!end || !bound) {
+                return npos;
+            }
+
+            const uint32_t *tree = trees_.data() + (bin_idx / bins_per_item_) * 2 * leaf_count_;
+            return find_last_smaller(
+                tree, 1, 0, leaf_count_, safe_cast<uint32_t>(min<size_t>(bound, full_leaf)), end);
+        }
+
+        size_t BinCapacityIndex::find_last_smaller(
+            const uint32_t *tree,
+            size_t node,
+            size_t node_begin,
+            size_t node_end,
+            uint32_t bound,
+            size_t end) const
+        {
+            // Nothing before end in this subtree has room
+            if (node_begin >= end || tree[node] >= bound) {
+                return npos;
+            }
+            if (node_end - node_begin == 1) {
+                return node_begin;
+            }
+
+            // Prefer the right half; only look left if the right half has no match before end
+            size_t node_mid = node_begin + (node_end - node_begin) / 2;
+            size_t pos = find_last_smaller(tree, 2 * node + 1, node_mid, node_end, bound, end);
+            if (pos != npos) {
+                return pos;
+            }
+            return find_last_smaller(tree, 2 * node, node_begin, node_mid, bound, end);
+        }
+    } // namespace receiver
+} // namespace apsu
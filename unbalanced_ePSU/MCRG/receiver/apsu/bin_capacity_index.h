@@ -0,0 +1,114 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+// STD
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// APSU
+#include "apsu/bin_bundle.h"
+
+namespace apsu {
+    namespace receiver {
+        /**
+        Tracks how full the bins of the BinBundles at one bundle index are, so that an insertion
+        finds a BinBundle with room without trying every BinBundle in turn.
+
+        An item occupies bins_per_item consecutive bins starting at a multiple of bins_per_item;
+        we call such a range a slot. Items are inserted into and removed from whole slots, so all
+        bins of a slot hold the same number of items. For every slot, a segment tree over the
+        BinBundles holds the smallest size the slot has in any BinBundle of a range, which finds
+        the last BinBundle with room in the slot in O(log(#BinBundles)) steps.
+
+        The index is stale until it is built from the BinBundles, and must be invalidated whenever
+        the BinBundles change other than through it.
+        */
+        class BinCapacityIndex {
+        public:
+            /**
+            Returned by find_last_smaller when no BinBundle has room.
+            */
+            static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+            BinCapacityIndex(std::size_t bins_per_bundle, std::size_t bins_per_item);
+
+            /**
+            Returns whether the index needs to be rebuilt.
+            */
+            bool stale() const noexcept
+            {
+                return stale_;
+            }
+
+            /**
+            Marks the index for rebuilding.
+            */
+            void invalidate() noexcept
+            {
+                stale_ = true;
+            }
+
+            /**
+            Rebuilds the index from the BinBundles at this bundle index. The BinBundles must not be
+            stripped.
+            */
+            void rebuild(const std::vector<BinBundle> &bin_bundles);
+
+            /**
+            Appends a BinBundle with empty bins.
+            */
+            void add_bin_bundle();
+
+            /**
+            Records the number of items in the slot containing bin_idx of the BinBundle at the
+            given position.
+            */
+            void set_bin_size(std::size_t bin_bundle_pos, std::size_t bin_idx, std::size_t size);
+
+            /**
+            Returns the position of the last BinBundle before end whose slot containing bin_idx
+            holds fewer than bound items, or npos if there is none.
+            */
+            std::size_t find_last_smaller(
+                std::size_t bin_idx, std::size_t bound, std::size_t end) const;
+
+        private:
+            std::size_t find_last_smaller(
+                const std::uint32_t *tree,
+                std::size_t node,
+                std::size_t node_begin,
+                std::size_t node_end,
+                std::uint32_t bound,
+                std::size_t end) const;
+
+            void set_leaf(std::size_t slot, std::size_t bin_bundle_pos, std::uint32_t value);
+
+            /**
+            Sets the number of leaves of every tree to a power of two at least leaf_count.
+            */
+            void reserve(std::size_t leaf_count);
+
+            std::size_t slot_count_;
+
+            std::size_t bins_per_item_;
+
+            std::size_t bin_bundle_count_ = 0;
+
+            /**
+            Number of leaves of each tree; a power of two.
+            */
+            std::size_t leaf_count_ = 0;
+
+            /**
+            The trees of all slots one after another, each with 2 * leaf_count_ nodes stored as a
+            binary heap. Leaves past the last BinBundle are full so that they are never found.
+            */
+            std::vector<std::uint32_t> trees_;
+
+            bool stale_ = true;
+        }; // class BinCapacityIndex
+    }      // namespace receiver
+} // namespace apsu
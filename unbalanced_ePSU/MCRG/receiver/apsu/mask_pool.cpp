@@ -0,0 +1,200 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+// STD
+#include <algorithm>
+#include <exception>
+#include <future>
+#include <stdexcept>
+#include <utility>
+
+// APSU
+#include "apsu/log.h"
+#include "apsu/mask_pool.h"
+#include "apsu/thread_pool_mgr.h"
+#include "apsu/util/db_encoding.h"
+#include "apsu/util/stopwatch.h"
+#include "apsu/util/utils.h"
+
+// SEAL
+#include "seal/randomgen.h"
+
+using namespace std;
+using namespace seal;
+
+namespace apsu {
+    using namespace util;
+
+    namespace receiver {
+        bool QueryMasks::matches(const ReceiverDB &receiver_db) const
+        {
+            size_t bundle_idx_count = receiver_db.get_params().bundle_idx_count();
+            if (cache_cnt_per_bundle.size() != bundle_idx_count) {
+                return false;
+            }
+            for (size_t bundle_idx = 0; bundle_idx < bundle_idx_count; bundle_idx++) {
+                if (cache_cnt_per_bundle[bundle_idx] !=
+                    receiver_db.get_bin_bundle_count(static_cast<uint32_t>(bundle_idx))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        MaskPool::MaskPool(shared_ptr<ReceiverDB> receiver_db)
+            : receiver_db_(move(receiver_db))
+        {
+            if (!receiver_db_) {
+                throw invalid_argument("receiver_db is not set");
+            }
+
+            worker_ = thread([this]() { refill(); });
+        }
+
+        MaskPool::~MaskPool()
+        {
+            if (worker_.joinable()) {
+                worker_.join();
+            }
+        }
+
+        void MaskPool::refill()
+        {
+            // On failure the pool hands out an empty set, which take regenerates on demand
+            QueryMasks masks;
+            try {
+                masks = Generate(*receiver_db_);
+            } catch (const exception &ex) {
+                APSU_LOG_ERROR("Failed to generate masks in the background: " << ex.what());
+            }
+
+            lock_guard<mutex> lock(mtx_);
+            masks_ = move(masks);
+            ready_ = true;
+            ready_cv_.notify_all();
+        }
+
+        QueryMasks MaskPool::take()
+        {
+            // Only one caller at a time may join and restart the worker
+            lock_guard<mutex> take_lock(take_mtx_);
+
+            QueryMasks masks;
+            {
+                unique_lock<mutex> lock(mtx_);
+                ready_cv_.wait(lock, [this]() { return ready_; });
+                masks = move(masks_);
+                ready_ = false;
+            }
+
+            // The previous refill has finished; start the next one
+            if (worker_.joinable()) {
+                worker_.join();
+            }
+
+            if (!masks.matches(*receiver_db_)) {
+                APSU_LOG_INFO("ReceiverDB changed since the masks were generated; regenerating");
+                try {
+                    masks = Generate(*receiver_db_);
+                } catch (...) {
+                    // Restart the worker anyway, or every later take would wait for it forever
+                    worker_ = thread([this]() { refill(); });
+                    throw;
+                }
+            }
+
+            worker_ = thread([this]() { refill(); });
+            return masks;
+        }
+
+        QueryMasks MaskPool::Generate(const ReceiverDB &receiver_db)
+        {
+            STOPWATCH(recv_stopwatch, "MaskPool::Generate");
+
+            const PSUParams &params = receiver_db.get_params();
+            const CryptoContext &crypto_context = receiver_db.get_crypto_context();
+            auto encoder = crypto_context.encoder();
+            const Modulus &plain_modulus_mod = params.seal_params().plain_modulus();
+            uint64_t plain_modulus = plain_modulus_mod.value();
+            size_t slot_count = encoder->slot_count();
+
+            size_t bundle_idx_count = safe_cast<size_t>(params.bundle_idx_count());
+            size_t felts_per_item = safe_cast<size_t>(params.item_params().felts_per_item);
+            size_t items_per_bundle = safe_cast<size_t>(params.items_per_bundle());
+
+            QueryMasks masks;
+            for (size_t bundle_idx = 0; bundle_idx < bundle_idx_count; bundle_idx++) {
+                masks.cache_cnt_per_bundle.push_back(
+                    receiver_db.get_bin_bundle_count(static_cast<uint32_t>(bundle_idx)));
+                masks.alpha_max_cache_count =
+                    max<uint64_t>(masks.alpha_max_cache_count, masks.cache_cnt_per_bundle.back());
+            }
+            masks.item_cnt = mul_safe(bundle_idx_count, items_per_bundle);
+
+            // Only mask_bit_count bits of every item mask are kept; padded caches get an all-ones
+            // mask, which never equals the zero the sender stores for them
+            uint32_t mask_bit_count = params.item_params().mask_bit_count;
+            uint64_t padding_mask =
+                (mask_bit_count == 64) ? ~uint64_t(0) : (uint64_t(1) << mask_bit_count) - 1;
+
+            size_t pack_count =
+                mul_safe(safe_cast<size_t>(masks.alpha_max_cache_count), bundle_idx_count);
+            masks.random_matrix.resize(mul_safe(pack_count, items_per_bundle));
+            masks.random_plains.resize(pack_count);
+
+            // Every cache has its own PRNG and writes only its own slice of the outputs
+            ThreadPoolMgr tpm;
+            vector<future<void>> futures;
+            futures.reserve(pack_count);
+            for (size_t pack_idx = 0; pack_idx < pack_count; pack_idx++) {
+                size_t cache_idx = pack_idx / bundle_idx_count;
+                size_t bundle_idx = pack_idx % bundle_idx_count;
+                uint64_t *item_masks = masks.random_matrix.data() + pack_idx * items_per_bundle;
+
+                if (cache_idx >= masks.cache_cnt_per_bundle[bundle_idx]) {
+                    fill_n(item_masks, items_per_bundle, padding_mask);
+                    continue;
+                }
+
+                futures.push_back(tpm.thread_pool().enqueue([&, pack_idx, item_masks]() {
+                    prng_seed_type seed;
+                    random_bytes(reinterpret_cast<seal_byte *>(seed.data()), prng_seed_byte_count);
+                    auto prng = UniformRandomGeneratorInfo(prng_type::blake2xb, seed).make_prng();
+
+                    vector<uint64_t> random_num(slot_count);
+                    prng->generate(
+                        random_num.size() * sizeof(uint64_t),
+                        reinterpret_cast<seal_byte *>(random_num.data()));
+                    for (auto &r : random_num) {
+                        r %= plain_modulus;
+                    }
+
+                    for (size_t i = 0; i < items_per_bundle; i++) {
+                        gsl::span<const felt_t> item_felts(
+                            random_num.data() + i * felts_per_item, felts_per_item);
+                        item_masks[i] = field_elts_to_mask(item_felts, mask_bit_count, plain_modulus_mod);
+                    }
+
+                    encoder->encode(random_num, masks.random_plains[pack_idx]);
+                }));
+            }
+
+            // Every task must finish before rethrowing, since the tasks use masks and encoder
+            exception_ptr error;
+            for (auto &f : futures) {
+                try {
+                    f.get();
+                } catch (...) {
+                    if (!error) {
+                        error = current_exception();
+                    }
+                }
+            }
+            if (error) {
+                rethrow_exception(error);
+            }
+
+            return masks;
+        }
+    } // namespace receiver
+} // namespace apsu
@@ -0,0 +1,108 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+// STD
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// APSU
+#include "apsu/receiver_db.h"
+
+// SEAL
+#include "seal/plaintext.h"
+
+namespace apsu {
+    namespace receiver {
+        /**
+        The random masks of one query. A cache that exists in the ReceiverDB gets a fresh random
+        plaintext that is added to its matching polynomial; a padding cache (one beyond the
+        number of caches at its bundle index) gets no plaintext and an all-ones mask.
+        */
+        struct QueryMasks {
+            /**
+            Number of caches at each bundle index when the masks were generated.
+            */
+            std::vector<std::size_t> cache_cnt_per_bundle;
+
+            std::uint64_t alpha_max_cache_count = 0;
+
+            std::uint64_t item_cnt = 0;
+
+            /**
+            alpha_max_cache_count rows of item_cnt masks; the masks of a cache are at
+            (cache_idx * bundle_idx_count + bundle_idx) * items_per_bundle.
+            */
+            std::vector<std::uint64_t> random_matrix;
+
+            /**
+            Batch-encoded masks, indexed by cache_idx * bundle_idx_count + bundle_idx.
+            */
+            std::vector<seal::Plaintext> random_plains;
+
+            /**
+            Returns whether the masks were generated for the current shape of the ReceiverDB.
+            */
+            bool matches(const ReceiverDB &receiver_db) const;
+        };
+
+        /**
+        The masks do not depend on the query, so MaskPool generates the masks of the next query in
+        the background as soon as the ReceiverDB is loaded, and again after each take. The work is
+        spread over the APSU thread pool, one seeded PRNG per cache.
+        */
+        class MaskPool {
+        public:
+            MaskPool(std::shared_ptr<ReceiverDB> receiver_db);
+
+            ~MaskPool();
+
+            MaskPool(const MaskPool &) = delete;
+
+            MaskPool &operator=(const MaskPool &) = delete;
+
+            /**
+            Returns the masks for one query and starts generating the next set. If the ReceiverDB
+            changed shape since the ready set was generated, a new set is generated first. Concurrent
+            calls are served one at a time.
+            */
+            QueryMasks take();
+
+            /**
+            Generates the masks for one query on the calling thread, using the APSU thread pool.
+            */
+            static QueryMasks Generate(const ReceiverDB &receiver_db);
+
+            /**
+            Returns the ReceiverDB the pool generates masks for.
+            */
+            const std::shared_ptr<ReceiverDB> &receiver_db() const
+            {
+                return receiver_db_;
+            }
+
+        private:
+            void refill();
+
+            std::shared_ptr<ReceiverDB> receiver_db_;
+
+            std::mutex take_mtx_;
+
+            std::mutex mtx_;
+
+            std::condition_variable ready_cv_;
+
+            bool ready_ = false;
+
+            QueryMasks masks_;
+
+            std::thread worker_;
+        }; // class MaskPool
+    }      // namespace receiver
+} // namespace apsu
@@ -0,0 +1,166 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+// STD
+#include <algorithm>
+#include <mutex>
+
+// APSU
+#include "apsu/plaintext_cache.h"
+
+// SEAL
+#include "seal/memorymanager.h"
+
+using namespace std;
+using namespace seal;
+
+namespace apsu {
+    namespace receiver {
+        namespace {
+            mutex cache_mtx;
+
+            size_t budget = 0;
+
+            size_t resident_byte_count = 0;
+
+            // Most recently evaluated polynomial first; each entry records its size in bytes. An
+            // entry is removed by its slot's destructor, so the resident bytes never include
+            // polynomials that no longer exist.
+            list<pair<weak_ptr<PlaintextCache::Slot>, size_t>> lru;
+
+            // Drops entries from the back of the list until byte_count more bytes fit in the budget.
+            // drop receives the slot of each dropped entry; it must release the slot only after
+            // cache_mtx is unlocked, since the slot's destructor takes the lock. An entry whose slot
+            // is being destroyed is left to that destructor. Must be called with cache_mtx held.
+            template <typename DropFun>
+            void make_room(size_t byte_count, DropFun drop)
+            {
+                auto it = lru.end();
+                while (it != lru.begin() && resident_byte_count + byte_count > budget) {
+                    --it;
+                    auto slot = it->first.lock();
+                    if (!slot) {
+                        continue;
+                    }
+
+                    resident_byte_count -= it->second;
+                    it = lru.erase(it);
+                    drop(move(slot));
+                }
+            }
+        } // namespace
+
+        PlaintextCache::Slot::~Slot()
+        {
+            lock_guard<mutex> lock(cache_mtx);
+            if (coeffs_) {
+                resident_byte_count -= lru_pos_->second;
+                lru.erase(lru_pos_);
+            }
+        }
+
+        void PlaintextCache::SetBudget(size_t byte_count)
+        {
+            // Released after the lock; see make_room
+            vector<shared_ptr<Slot>> victims;
+
+            lock_guard<mutex> lock(cache_mtx);
+            budget = byte_count;
+            make_room(0, [&](shared_ptr<Slot> victim) {
+                victim->coeffs_.reset();
+                victims.push_back(move(victim));
+            });
+        }
+
+        size_t PlaintextCache::GetBudget()
+        {
+            lock_guard<mutex> lock(cache_mtx);
+            return budget;
+        }
+
+        size_t PlaintextCache::GetResidentByteCount()
+        {
+            lock_guard<mutex> lock(cache_mtx);
+            return resident_byte_count;
+        }
+
+        shared_ptr<const PlaintextCache::Coeffs> PlaintextCache::Get(
+            const shared_ptr<Slot> &slot,
+            const SEALContext &seal_context,
+            const vector<gsl::span<const unsigned char>> &batched_coeffs)
+        {
+            if (!slot) {
+                return nullptr;
+            }
+
+            {
+                lock_guard<mutex> lock(cache_mtx);
+                if (!budget) {
+                    return nullptr;
+                }
+                if (slot->coeffs_) {
+                    lru.splice(lru.begin(), lru, slot->lru_pos_);
+                    return slot->coeffs_;
+                }
+            }
+
+            // Load outside the lock. Every polynomial gets its own memory pool, so dropping it
+            // returns the memory. The pool allocates each coefficient array of a Plaintext in its
+            // own 64-byte multiple, and SEAL aligns those allocations to 64 bytes.
+            auto pool = MemoryManager::GetPool(mm_prof_opt::mm_force_new);
+            auto coeffs = make_shared<Coeffs>();
+            coeffs->reserve(batched_coeffs.size());
+            size_t byte_count = 0;
+            for (const auto &coeff_data : batched_coeffs) {
+                coeffs->emplace_back(pool);
+                coeffs->back().unsafe_load(
+                    seal_context,
+                    reinterpret_cast<const seal_byte *>(coeff_data.data()),
+                    coeff_data.size());
+                byte_count += coeffs->back().capacity() * sizeof(Plaintext::pt_coeff_type);
+            }
+
+            // Released after the lock; see make_room
+            vector<shared_ptr<Slot>> victims;
+
+            lock_guard<mutex> lock(cache_mtx);
+
+            // Another thread may have loaded the same polynomial in the meantime
+            if (slot->coeffs_) {
+                lru.splice(lru.begin(), lru, slot->lru_pos_);
+                return slot->coeffs_;
+            }
+
+            if (byte_count > budget) {
+                return coeffs;
+            }
+
+            make_room(byte_count, [&](shared_ptr<Slot> victim) {
+                victim->coeffs_.reset();
+                victims.push_back(move(victim));
+            });
+
+            lru.emplace_front(slot, byte_count);
+            resident_byte_count += byte_count;
+            slot->lru_pos_ = lru.begin();
+            slot->coeffs_ = coeffs;
+
+            return coeffs;
+        }
+
+        void PlaintextCache::Clear()
+        {
+            // Released after the lock; see make_room
+            vector<shared_ptr<Slot>> victims;
+
+            lock_guard<mutex> lock(cache_mtx);
+            size_t saved_budget = budget;
+            budget = 0;
+            make_room(0, [&](shared_ptr<Slot> victim) {
+                victim->coeffs_.reset();
+                victims.push_back(move(victim));
+            });
+            budget = saved_budget;
+        }
+    } // namespace receiver
+} // namespace apsu
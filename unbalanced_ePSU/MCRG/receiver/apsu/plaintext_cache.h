@@ -0,0 +1,91 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+// STD
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// SEAL
+#include "seal/context.h"
+#include "seal/plaintext.h"
+
+// GSL
+#include "gsl/span"
+
+namespace apsu {
+    namespace receiver {
+        /**
+        Keeps the coefficients of BatchedPlaintextPolyns resident as loaded seal::Plaintexts, so that
+        evaluating a polynomial does not deserialize, and possibly decompress, every coefficient on
+        every query. The coefficients are kept exactly as they were encoded, so all but the constant
+        terms are in NTT form and ready for multiply_plain.
+
+        One cache is shared by all BinBundles and is bounded by a memory budget. When a polynomial
+        does not fit, the least recently evaluated polynomials are dropped. The budget is zero by
+        default, which disables the cache.
+        */
+        class PlaintextCache {
+        public:
+            using Coeffs = std::vector<seal::Plaintext>;
+
+            /**
+            The resident coefficients of one polynomial. Every BatchedPlaintextPolyn owns a slot and
+            the cache only refers to it, so a polynomial that is regenerated or destroyed simply
+            drops out of the cache.
+            */
+            class Slot {
+            public:
+                /**
+                Stops accounting for the resident coefficients, if any, as soon as the polynomial
+                is gone.
+                */
+                ~Slot();
+
+            private:
+                friend class PlaintextCache;
+
+                std::shared_ptr<const Coeffs> coeffs_;
+
+                std::list<std::pair<std::weak_ptr<Slot>, std::size_t>>::iterator lru_pos_;
+            };
+
+            PlaintextCache() = delete;
+
+            /**
+            Sets the memory budget in bytes and drops polynomials until the cache fits in it. A
+            budget of zero disables the cache.
+            */
+            static void SetBudget(std::size_t byte_count);
+
+            /**
+            Returns the memory budget in bytes.
+            */
+            static std::size_t GetBudget();
+
+            /**
+            Returns the number of bytes held by resident coefficients.
+            */
+            static std::size_t GetResidentByteCount();
+
+            /**
+            Returns the loaded coefficients of the polynomial owning the given slot, loading them
+            from batched_coeffs if they are not resident. Returns nullptr if the cache is disabled
+            or the slot is null. A polynomial larger than the whole budget is loaded but not kept.
+            */
+            static std::shared_ptr<const Coeffs> Get(
+                const std::shared_ptr<Slot> &slot,
+                const seal::SEALContext &seal_context,
+                const std::vector<gsl::span<const unsigned char>> &batched_coeffs);
+
+            /**
+            Drops all resident coefficients.
+            */
+            static void Clear();
+        }; // class PlaintextCache
+    }      // namespace receiver
+} // namespace apsu
@@ -3,10 +3,14 @@
 
 // STD
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <future>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <mutex>
+#include <numeric>
 #include <sstream>
 
 // APSU
@@ -16,6 +20,7 @@
 #include "apsu/thread_pool_mgr.h"
 #include "apsu/util/db_encoding.h"
 #include "apsu/util/label_encryptor.h"
+#include "apsu/util/mapped_file.h"
 #include "apsu/util/utils.h"
 
 // Kuku
@@ -105,6 +110,100 @@ namespace apsu {
                 return { bin_idx, bundle_idx };
             }
 
+            /**
+            Groups the items of data_with_indices by bundle index with a parallel counting sort.
+            On return, the positions in data_with_indices of the items at bundle index i are
+            item_positions[bucket_offsets[i]] up to item_positions[bucket_offsets[i + 1]], in their
+            original order.
+            */
+            template <typename T>
+            void bucket_by_bundle_idx(
+                const vector<pair<T, size_t>> &data_with_indices,
+                size_t bins_per_bundle,
+                size_t bundle_idx_count,
+                vector<size_t> &bucket_offsets,
+                vector<size_t> &item_positions)
+            {
+                ThreadPoolMgr tpm;
+
+                // Each chunk of the input is counted and scattered by one task; chunks are large
+                // enough that the per-chunk counters stay small next to the data
+                constexpr size_t min_chunk_size = 4096;
+                size_t item_count = data_with_indices.size();
+                size_t chunk_count = max<size_t>(
+                    1, min<size_t>(tpm.thread_pool().pool_size(), item_count / min_chunk_size));
+                size_t chunk_size = (item_count + chunk_count - 1) / chunk_count;
+
+                // Count the items of every chunk at every bundle index
+                vector<size_t> chunk_offsets(chunk_count * bundle_idx_count, 0);
+                tpm.thread_pool().parallel_for(chunk_count, [&](size_t chunk) {
+                    size_t *counts = chunk_offsets.data() + chunk * bundle_idx_count;
+                    size_t end = min(item_count, (chunk + 1) * chunk_size);
+                    for (size_t i = chunk * chunk_size; i < end; i++) {
+                        size_t bundle_idx = data_with_indices[i].second / bins_per_bundle;
+                        if (bundle_idx >= bundle_idx_count) {
+                            APSU_LOG_ERROR(
+                                "Cuckoo index " << data_with_indices[i].second
+                                                << " is out of range for " << bundle_idx_count
+                                                << " bundle indices");
+                            throw out_of_range("cuckoo index is out of range");
+                        }
+                        counts[bundle_idx]++;
+                    }
+                });
+
+                // Turn the counts into the position where each chunk starts writing at each
+                // bundle index; earlier chunks come first so the original order is kept
+                bucket_offsets.assign(bundle_idx_count + 1, 0);
+                size_t offset = 0;
+                for (size_t bundle_idx = 0; bundle_idx < bundle_idx_count; bundle_idx++) {
+                    bucket_offsets[bundle_idx] = offset;
+                    for (size_t chunk = 0; chunk < chunk_count; chunk++) {
+                        size_t &chunk_offset = chunk_offsets[chunk * bundle_idx_count + bundle_idx];
+                        size_t count = chunk_offset;
+                        chunk_offset = offset;
+                        offset += count;
+                    }
+                }
+                bucket_offsets[bundle_idx_count] = offset;
+
+                // Write the positions of the items into their buckets
+                item_positions.resize(item_count);
+                tpm.thread_pool().parallel_for(chunk_count, [&](size_t chunk) {
+                    size_t *offsets = chunk_offsets.data() + chunk * bundle_idx_count;
+                    size_t end = min(item_count, (chunk + 1) * chunk_size);
+                    for (size_t i = chunk * chunk_size; i < end; i++) {
+                        size_t bundle_idx = data_with_indices[i].second / bins_per_bundle;
+                        item_positions[offsets[bundle_idx]++] = i;
+                    }
+                });
+            }
+
+            /**
+            Returns the bundle indices that have items in the given buckets, largest bucket first.
+            Handing these out one at a time to the threads keeps them busy evenly even when a few
+            bundle indices get most of the items.
+            */
+            vector<size_t> order_buckets_by_size(const vector<size_t> &bucket_offsets)
+            {
+                vector<size_t> bundle_indices;
+                for (size_t bundle_idx = 0; bundle_idx + 1 < bucket_offsets.size(); bundle_idx++) {
+                    if (bucket_offsets[bundle_idx + 1] != bucket_offsets[bundle_idx]) {
+                        bundle_indices.push_back(bundle_idx);
+                    }
+                }
+
+                auto bucket_size = [&](size_t bundle_idx) {
+                    return bucket_offsets[bundle_idx + 1] - bucket_offsets[bundle_idx];
+                };
+                stable_sort(
+                    bundle_indices.begin(), bundle_indices.end(), [&](size_t a, size_t b) {
+                        return bucket_size(a) > bucket_size(b);
+                    });
+
+                return bundle_indices;
+            }
+
             /**
             Converts each given Item-Label pair in between the given iterators into its algebraic
             form, i.e., a sequence of felt-felt pairs. Also computes each Item's cuckoo index.
@@ -239,11 +338,22 @@ namespace apsu {
                 APSU_LOG_INFO("outputs_as_items"<<outputs_as_items[525].size());
                 return outputs_as_items;
             }
+
+            /**
+            Algebraized items paired with the cuckoo index of every location of every item. The
+            field elements of all items are stored once in felts, which data_with_indices refers to.
+            */
+            struct AlgItemsWithIndices {
+                vector<felt_t> felts;
+
+                vector<pair<gsl::span<const felt_t>, size_t>> data_with_indices;
+            };
+
             /**
             Converts each given Item into its algebraic form, i.e., a sequence of felt-monostate
             pairs. Also computes each Item's cuckoo index.
             */
-            vector<pair<AlgItem, size_t>> preprocess_unlabeled_data(
+            AlgItemsWithIndices preprocess_unlabeled_data(
                 const vector<HashedItem>::const_iterator begin,
                 const vector<HashedItem>::const_iterator end,
                 const PSUParams &params,
@@ -266,7 +376,7 @@ namespace apsu {
                 // Calculate the cuckoo indices for each item. Store every pair of (item-label,
                 // cuckoo_idx) in a vector. Later, we're gonna sort this vector by cuckoo_idx and
                 // use the result to parallelize the work of inserting the items into BinBundles.
-                vector<pair<AlgItem, size_t>> data_with_indices;
+                AlgItemsWithIndices result;
                 for (auto it = begin; it != end; it++) {
                     const HashedItem &item = *it;
 
@@ -289,47 +399,128 @@ namespace apsu {
                 }
                 auto oprf_out = oprf_sender(oprf_in,dbsocket);
                 size_t hash_table_size = oprf_in.size();
+
+                // The field elements of all locations go into one buffer
+                size_t alg_item_count = 0;
+                for (const auto &location_items : oprf_out) {
+                    alg_item_count += location_items.size();
+                }
+                result.felts.resize(alg_item_count * bins_per_item);
+                result.data_with_indices.reserve(alg_item_count);
+
+                felt_t *location_felts = result.felts.data();
                 for(size_t location = 0; location < hash_table_size; location++){
                     size_t bin_idx = location * bins_per_item;
                     // APSU_LOG_INFO(oprf_out[location].size());
-                    for(auto item: oprf_out[location]){
-                        AlgItem alg_item =
-                            algebraize_item(item, item_bit_count, params.seal_params().plain_modulus());
-                        data_with_indices.emplace_back(make_pair(alg_item, bin_idx));
+
+                    // Serialize all items at this location into field elements at once
+                    const vector<HashedItem> &location_items = oprf_out[location];
+                    algebraize_items(
+                        location_items,
+                        item_bit_count,
+                        params.seal_params().plain_modulus(),
+                        { location_felts, location_items.size() * bins_per_item });
+
+                    for (size_t item_idx = 0; item_idx < location_items.size(); item_idx++) {
+                        result.data_with_indices.emplace_back(
+                            gsl::span<const felt_t>(location_felts, bins_per_item), bin_idx);
+                        location_felts += bins_per_item;
                     }
+                }
+
+                APSU_LOG_DEBUG(
+                    "Finished preprocessing " << distance(begin, end) << " unlabeled items");
+                APSU_LOG_INFO("data_with_indices"<<result.data_with_indices.size());
+                return result;
+            }
+
+            /**
+            Converts each given Item, already hashed with the OPRF key of the ReceiverDB, into its
+            algebraic form, i.e., a sequence of felt-monostate pairs. Also computes each Item's
+            cuckoo index. Unlike the function above this needs no interaction with the sender, so
+            the result can be saved and reused across sessions.
+            */
+            AlgItemsWithIndices preprocess_unlabeled_data(
+                const vector<HashedItem>::const_iterator begin,
+                const vector<HashedItem>::const_iterator end,
+                const PSUParams &params)
+            {
+                STOPWATCH(recv_stopwatch, "preprocess_unlabeled_data");
+                APSU_LOG_DEBUG(
+                    "Start preprocessing " << distance(begin, end) << " unlabeled items");
+
+                // Some variables we'll need
+                size_t bins_per_item = params.item_params().felts_per_item;
+                size_t item_bit_count = params.item_bit_count();
+
+                // Set up Kuku hash functions
+                auto hash_funcs = hash_functions(params);
+
+                // Serialize all items into field elements at once
+                size_t item_count = static_cast<size_t>(distance(begin, end));
+                AlgItemsWithIndices result;
+                result.felts.resize(item_count * bins_per_item);
+                if (item_count) {
+                    algebraize_items(
+                        { &*begin, item_count },
+                        item_bit_count,
+                        params.seal_params().plain_modulus(),
+                        result.felts);
+                }
 
+                // The sender cuckoo hashes the same OPRF outputs, so every location of an item
+                // holds the same algebraic item
+                for (size_t item_idx = 0; item_idx < item_count; item_idx++) {
+                    gsl::span<const felt_t> alg_item(
+                        result.felts.data() + item_idx * bins_per_item, bins_per_item);
+
+                    // Get the cuckoo table locations for this item and add to data_with_indices
+                    for (auto location : all_locations(hash_funcs, begin[item_idx])) {
+                        size_t bin_idx = location * bins_per_item;
+                        result.data_with_indices.emplace_back(alg_item, bin_idx);
+                    }
                 }
 
                 APSU_LOG_DEBUG(
                     "Finished preprocessing " << distance(begin, end) << " unlabeled items");
-                APSU_LOG_INFO("data_with_indices"<<data_with_indices.size());
-                return data_with_indices;
+
+                return result;
             }
 
             /**
             Converts given Item into its algebraic form, i.e., a sequence of felt-monostate pairs.
-            Also computes the Item's cuckoo index.
+            Also computes the Item's cuckoo index. The item is encoded the same way as the items of
+            the ReceiverDB: without interaction if offline_oprf is set, and with the KKRT OPRF
+            over dbsocket otherwise.
             */
-            vector<pair<AlgItem, size_t>> preprocess_unlabeled_data(
-                const HashedItem &item, const PSUParams &params, coproto::AsioSocket dbsocket)
+            AlgItemsWithIndices preprocess_unlabeled_data(
+                const HashedItem &item,
+                const PSUParams &params,
+                bool offline_oprf,
+                coproto::AsioSocket dbsocket)
             {
                 vector<HashedItem> item_singleton{ item };
-                return preprocess_unlabeled_data(
-                    item_singleton.begin(), item_singleton.end(), params,dbsocket);
+                return offline_oprf
+                           ? preprocess_unlabeled_data(
+                                 item_singleton.begin(), item_singleton.end(), params)
+                           : preprocess_unlabeled_data(
+                                 item_singleton.begin(), item_singleton.end(), params, dbsocket);
             }
 
             /**
             Inserts the given items and corresponding labels into bin_bundles at their respective
-            cuckoo indices. It will only insert the data with bundle index in the half-open range
-            range indicated by work_range. If inserting into a BinBundle would make the number of
-            items in a bin larger than max_bin_size, this function will create and insert a new
-            BinBundle. If overwrite is set, this will overwrite the labels if it finds an
-            AlgItemLabel that matches the input perfectly.
+            cuckoo indices. It will only insert the data at the given positions of
+            data_with_indices, all of which must have bundle index bundle_index. If inserting into
+            a BinBundle would make the number of items in a bin larger than max_bin_size, this
+            function will create and insert a new BinBundle. If overwrite is set, this will
+            overwrite the labels if it finds an AlgItemLabel that matches the input perfectly.
             */
             template <typename T>
             void insert_or_assign_worker(
                 const vector<pair<T, size_t>> &data_with_indices,
+                gsl::span<const size_t> item_positions,
                 vector<vector<BinBundle>> &bin_bundles,
+                BinCapacityIndex &capacity_index,
                 CryptoContext &crypto_context,
                 uint32_t bundle_index,
                 uint32_t bins_per_bundle,
@@ -345,8 +536,14 @@ namespace apsu {
                     << bundle_index << "; mode of operation: "
                     << (overwrite ? "overwriting existing" : "inserting new"));
 
+                // Bring the capacity index up to date with the BinBundles at this bundle index
+                if (capacity_index.stale()) {
+                    capacity_index.rebuild(bin_bundles[bundle_index]);
+                }
+
                 // Iteratively insert each item-label pair at the given cuckoo index
-                for (auto &data_with_idx : data_with_indices) {
+                for (size_t item_pos : item_positions) {
+                    auto &data_with_idx = data_with_indices[item_pos];
                     const T &data = data_with_idx.first;
 
                     // Get the bundle index
@@ -354,43 +551,52 @@ namespace apsu {
                     size_t bin_idx, bundle_idx;
                     tie(bin_idx, bundle_idx) = unpack_cuckoo_idx(cuckoo_idx, bins_per_bundle);
 
-                    // If the bundle_idx isn't in the prescribed range, don't try to insert this
-                    // data
-                    if (bundle_idx != bundle_index) {
-                        // Dealing with this bundle index is not our job
-                        continue;
-                    }
-
                     // Get the bundle set at the given bundle index
                     vector<BinBundle> &bundle_set = bin_bundles[bundle_idx];
 
                     // Try to insert or overwrite these field elements in an existing BinBundle at
                     // this bundle index. Keep track of whether or not we succeed.
                     bool written = false;
-                    for (auto bundle_it = bundle_set.rbegin(); bundle_it != bundle_set.rend();
-                         bundle_it++) {
-                        // If we're supposed to overwrite, try to overwrite. One of these BinBundles
-                        // has to have the data we're trying to overwrite.
-                        if (overwrite) {
-                            // If we successfully overwrote, we're done with this bundle
-                            written = bundle_it->try_multi_overwrite(data, bin_idx);
+                    if (overwrite) {
+                        for (size_t pos = bundle_set.size(); pos-- > 0;) {
+                            // One of these BinBundles has to have the data we're trying to
+                            // overwrite. If we successfully overwrote, we're done with this bundle
+                            written = bundle_set[pos].try_multi_overwrite(data, bin_idx);
                             if (written) {
                                 break;
                             }
-                        }
 
-                        // Do a dry-run insertion and see if the new largest bin size in the range
-                        // exceeds the limit
-                        int32_t new_largest_bin_size =
-                            bundle_it->multi_insert_dry_run(data, bin_idx);
-
-                        // Check if inserting would violate the max bin size constraint
-                        if (new_largest_bin_size > 0 &&
-                            safe_cast<size_t>(new_largest_bin_size) < max_bin_size) {
-                            // All good
-                            bundle_it->multi_insert_for_real(data, bin_idx);
-                            written = true;
-                            break;
+                            // Do a dry-run insertion and see if the new largest bin size in the
+                            // range exceeds the limit
+                            int32_t new_largest_bin_size =
+                                bundle_set[pos].multi_insert_dry_run(data, bin_idx);
+
+                            // Check if inserting would violate the max bin size constraint
+                            if (new_largest_bin_size > 0 &&
+                                safe_cast<size_t>(new_largest_bin_size) < max_bin_size) {
+                                // All good
+                                bundle_set[pos].multi_insert_for_real(data, bin_idx);
+                                capacity_index.set_bin_size(
+                                    pos, bin_idx, safe_cast<size_t>(new_largest_bin_size));
+                                written = true;
+                                break;
+                            }
+                        }
+                    } else {
+                        // Ask the capacity index for the last BinBundle with room in these bins. A
+                        // labeled item is refused where one of its parts is already in the bin, so
+                        // keep looking before such a BinBundle.
+                        size_t pos = bundle_set.size();
+                        while (!written && (pos = capacity_index.find_last_smaller(
+                                                bin_idx, max_bin_size - 1, pos)) !=
+                                               BinCapacityIndex::npos) {
+                            int32_t new_largest_bin_size =
+                                bundle_set[pos].multi_insert_for_real(data, bin_idx);
+                            if (new_largest_bin_size > 0) {
+                                capacity_index.set_bin_size(
+                                    pos, bin_idx, safe_cast<size_t>(new_largest_bin_size));
+                                written = true;
+                            }
                         }
                     }
 
@@ -430,6 +636,9 @@ namespace apsu {
 
                         // Push a new BinBundle to the set of BinBundles at this bundle index
                         bundle_set.push_back(move(new_bin_bundle));
+                        capacity_index.add_bin_bundle();
+                        capacity_index.set_bin_size(
+                            bundle_set.size() - 1, bin_idx, safe_cast<size_t>(res));
                     }
                 }
 
@@ -446,6 +655,7 @@ namespace apsu {
             void dispatch_insert_or_assign(
                 vector<pair<T, size_t>> &data_with_indices,
                 vector<vector<BinBundle>> &bin_bundles,
+                vector<BinCapacityIndex> &capacity_indexes,
                 CryptoContext &crypto_context,
                 uint32_t bins_per_bundle,
                 size_t label_size,
@@ -456,64 +666,52 @@ namespace apsu {
             {
                 ThreadPoolMgr tpm;
 
-                // Collect the bundle indices and partition them into thread_count many partitions.
-                // By some uniformity assumption, the number of things to insert per partition
-                // should be roughly the same. Note that the contents of bundle_indices is always
-                // sorted (increasing order).
-                set<size_t> bundle_indices_set;
-                for (auto &data_with_idx : data_with_indices) {
-                    size_t cuckoo_idx = data_with_idx.second;
-                    size_t bin_idx, bundle_idx;
-                    tie(bin_idx, bundle_idx) = unpack_cuckoo_idx(cuckoo_idx, bins_per_bundle);
-                    bundle_indices_set.insert(bundle_idx);
-                }
+                // Group the items by bundle index so that every task only sees its own items
+                vector<size_t> bucket_offsets, item_positions;
+                bucket_by_bundle_idx(
+                    data_with_indices,
+                    bins_per_bundle,
+                    bin_bundles.size(),
+                    bucket_offsets,
+                    item_positions);
+                vector<size_t> bundle_indices = order_buckets_by_size(bucket_offsets);
 
-                // Copy the set of indices into a vector and sort so each thread processes a range
-                // of indices
-                vector<size_t> bundle_indices;
-                bundle_indices.reserve(bundle_indices_set.size());
-                copy(
-                    bundle_indices_set.begin(),
-                    bundle_indices_set.end(),
-                    back_inserter(bundle_indices));
-                sort(bundle_indices.begin(), bundle_indices.end());
-
-                // Run the threads on the partitions
-                vector<future<void>> futures(bundle_indices.size());
+                // Run a task for every bundle index with items to insert
                 APSU_LOG_INFO(
                     "Launching " << bundle_indices.size() << " insert-or-assign worker tasks");
-                size_t future_idx = 0;
-                for (auto &bundle_idx : bundle_indices) {
-                    futures[future_idx++] = tpm.thread_pool().enqueue([&, bundle_idx]() {
-                        insert_or_assign_worker(
-                            data_with_indices,
-                            bin_bundles,
-                            crypto_context,
-                            static_cast<uint32_t>(bundle_idx),
-                            bins_per_bundle,
-                            label_size,
-                            max_bin_size,
-                            ps_low_degree,
-                            overwrite,
-                            compressed);
-                    });
-                }
-
-                // Wait for the tasks to finish
-                for (auto &f : futures) {
-                    f.get();
-                }
+                tpm.thread_pool().parallel_for(bundle_indices.size(), [&](size_t i) {
+                    size_t bundle_idx = bundle_indices[i];
+                    gsl::span<const size_t> bucket(
+                        item_positions.data() + bucket_offsets[bundle_idx],
+                        bucket_offsets[bundle_idx + 1] - bucket_offsets[bundle_idx]);
+                    insert_or_assign_worker(
+                        data_with_indices,
+                        bucket,
+                        bin_bundles,
+                        capacity_indexes[bundle_idx],
+                        crypto_context,
+                        static_cast<uint32_t>(bundle_idx),
+                        bins_per_bundle,
+                        label_size,
+                        max_bin_size,
+                        ps_low_degree,
+                        overwrite,
+                        compressed);
+                });
 
                 APSU_LOG_INFO("Finished insert-or-assign worker tasks");
             }
 
             /**
             Removes the given items and corresponding labels from bin_bundles at their respective
-            cuckoo indices.
+            cuckoo indices. It will only remove the data at the given positions of
+            data_with_indices, all of which must have bundle index bundle_index.
             */
             void remove_worker(
-                const vector<pair<AlgItem, size_t>> &data_with_indices,
+                const vector<pair<gsl::span<const felt_t>, size_t>> &data_with_indices,
+                gsl::span<const size_t> item_positions,
                 vector<vector<BinBundle>> &bin_bundles,
+                BinCapacityIndex &capacity_index,
                 uint32_t bundle_index,
                 uint32_t bins_per_bundle)
             {
@@ -521,38 +719,41 @@ namespace apsu {
                 APSU_LOG_INFO("Remove worker [" << bundle_index << "]");
 
                 // Iteratively remove each item-label pair at the given cuckoo index
-                for (auto &data_with_idx : data_with_indices) {
+                for (size_t item_pos : item_positions) {
+                    auto &data_with_idx = data_with_indices[item_pos];
+
                     // Get the bundle index
                     size_t cuckoo_idx = data_with_idx.second;
                     size_t bin_idx, bundle_idx;
                     tie(bin_idx, bundle_idx) = unpack_cuckoo_idx(cuckoo_idx, bins_per_bundle);
 
-                    // If the bundle_idx isn't in the prescribed range, don't try to remove this
-                    // data
-                    if (bundle_idx != bundle_index) {
-                        // Dealing with this bundle index is not our job
-                        continue;
-                    }
-
                     // Get the bundle set at the given bundle index
                     vector<BinBundle> &bundle_set = bin_bundles[bundle_idx];
 
                     // Try to remove these field elements from an existing BinBundle at this bundle
                     // index. Keep track of whether or not we succeed.
                     bool removed = false;
-                    for (BinBundle &bundle : bundle_set) {
+                    for (size_t pos = 0; pos < bundle_set.size(); pos++) {
                         // If we successfully removed, we're done with this bundle
-                        removed = bundle.try_multi_remove(data_with_idx.first, bin_idx);
+                        removed = bundle_set[pos].try_multi_remove(data_with_idx.first, bin_idx);
                         if (removed) {
+                            if (!capacity_index.stale()) {
+                                capacity_index.set_bin_size(
+                                    pos, bin_idx, bundle_set[pos].get_bin_size(bin_idx));
+                            }
                             break;
                         }
                     }
 
-                    // We may have produced some empty BinBundles so just remove them all
+                    // We may have produced some empty BinBundles so just remove them all; the
+                    // remaining BinBundles move, so the capacity index must be rebuilt
                     auto rem_it = remove_if(bundle_set.begin(), bundle_set.end(), [](auto &bundle) {
                         return bundle.empty();
                     });
-                    bundle_set.erase(rem_it, bundle_set.end());
+                    if (rem_it != bundle_set.end()) {
+                        bundle_set.erase(rem_it, bundle_set.end());
+                        capacity_index.invalidate();
+                    }
 
                     // We tried to remove an item that doesn't exist. This should never happen
                     if (!removed) {
@@ -574,52 +775,38 @@ namespace apsu {
             thread_count many threads can all remove in parallel.
             */
             void dispatch_remove(
-                const vector<pair<AlgItem, size_t>> &data_with_indices,
+                const vector<pair<gsl::span<const felt_t>, size_t>> &data_with_indices,
                 vector<vector<BinBundle>> &bin_bundles,
+                vector<BinCapacityIndex> &capacity_indexes,
                 uint32_t bins_per_bundle)
             {
                 ThreadPoolMgr tpm;
 
-                // Collect the bundle indices and partition them into thread_count many partitions.
-                // By some uniformity assumption, the number of things to remove per partition
-                // should be roughly the same. Note that the contents of bundle_indices is always
-                // sorted (increasing order).
-                set<size_t> bundle_indices_set;
-                for (auto &data_with_idx : data_with_indices) {
-                    size_t cuckoo_idx = data_with_idx.second;
-                    size_t bin_idx, bundle_idx;
-                    tie(bin_idx, bundle_idx) = unpack_cuckoo_idx(cuckoo_idx, bins_per_bundle);
-                    bundle_indices_set.insert(bundle_idx);
-                }
+                // Group the items by bundle index so that every task only sees its own items
+                vector<size_t> bucket_offsets, item_positions;
+                bucket_by_bundle_idx(
+                    data_with_indices,
+                    bins_per_bundle,
+                    bin_bundles.size(),
+                    bucket_offsets,
+                    item_positions);
+                vector<size_t> bundle_indices = order_buckets_by_size(bucket_offsets);
 
-                // Copy the set of indices into a vector and sort so each thread processes a range
-                // of indices
-                vector<size_t> bundle_indices;
-                bundle_indices.reserve(bundle_indices_set.size());
-                copy(
-                    bundle_indices_set.begin(),
-                    bundle_indices_set.end(),
-                    back_inserter(bundle_indices));
-                sort(bundle_indices.begin(), bundle_indices.end());
-
-                // Run the threads on the partitions
-                vector<future<void>> futures(bundle_indices.size());
+                // Run a task for every bundle index with items to remove
                 APSU_LOG_INFO("Launching " << bundle_indices.size() << " remove worker tasks");
-                size_t future_idx = 0;
-                for (auto &bundle_idx : bundle_indices) {
-                    futures[future_idx++] = tpm.thread_pool().enqueue([&]() {
-                        remove_worker(
-                            data_with_indices,
-                            bin_bundles,
-                            static_cast<uint32_t>(bundle_idx),
-                            bins_per_bundle);
-                    });
-                }
-
-                // Wait for the tasks to finish
-                for (auto &f : futures) {
-                    f.get();
-                }
+                tpm.thread_pool().parallel_for(bundle_indices.size(), [&](size_t i) {
+                    size_t bundle_idx = bundle_indices[i];
+                    gsl::span<const size_t> bucket(
+                        item_positions.data() + bucket_offsets[bundle_idx],
+                        bucket_offsets[bundle_idx + 1] - bucket_offsets[bundle_idx]);
+                    remove_worker(
+                        data_with_indices,
+                        bucket,
+                        bin_bundles,
+                        capacity_indexes[bundle_idx],
+                        static_cast<uint32_t>(bundle_idx),
+                        bins_per_bundle);
+                });
             }
 
             /**
@@ -638,10 +825,14 @@ namespace apsu {
         } // namespace
 
         ReceiverDB::ReceiverDB(
-            PSUParams params, size_t label_byte_count, size_t nonce_byte_count, bool compressed)
+            PSUParams params,
+            size_t label_byte_count,
+            size_t nonce_byte_count,
+            bool compressed,
+            bool offline_oprf)
             : params_(params), crypto_context_(params_), label_byte_count_(label_byte_count),
               nonce_byte_count_(label_byte_count_ ? nonce_byte_count : 0), item_count_(0),
-              compressed_(compressed)
+              compressed_(compressed), offline_oprf_(offline_oprf)
         {
             // The labels cannot be more than 1 KB.
             if (label_byte_count_ > 1024) {
@@ -682,8 +873,9 @@ namespace apsu {
             OPRFKey oprf_key,
             size_t label_byte_count,
             size_t nonce_byte_count,
-            bool compressed)
-            : ReceiverDB(params, label_byte_count, nonce_byte_count, compressed)
+            bool compressed,
+            bool offline_oprf)
+            : ReceiverDB(params, label_byte_count, nonce_byte_count, compressed, offline_oprf)
         {
             // Initialize oprf key with the one given to this constructor
             oprf_key_ = move(oprf_key);
@@ -693,13 +885,15 @@ namespace apsu {
             : params_(source.params_), crypto_context_(source.crypto_context_),
               label_byte_count_(source.label_byte_count_),
               nonce_byte_count_(source.nonce_byte_count_), item_count_(source.item_count_),
-              compressed_(source.compressed_), stripped_(source.stripped_)
+              compressed_(source.compressed_), stripped_(source.stripped_),
+              offline_oprf_(source.offline_oprf_)
         {
             // Lock the source before moving stuff over
             auto lock = source.get_writer_lock();
 
             hashed_items_ = move(source.hashed_items_);
             bin_bundles_ = move(source.bin_bundles_);
+            capacity_indexes_ = move(source.capacity_indexes_);
             oprf_key_ = move(source.oprf_key_);
             source.oprf_key_ = OPRFKey();
 
@@ -724,12 +918,14 @@ namespace apsu {
             item_count_ = source.item_count_;
             compressed_ = source.compressed_;
             stripped_ = source.stripped_;
+            offline_oprf_ = source.offline_oprf_;
 
             // Lock the source before moving stuff over
             auto source_lock = source.get_writer_lock();
 
             hashed_items_ = move(source.hashed_items_);
             bin_bundles_ = move(source.bin_bundles_);
+            capacity_indexes_ = move(source.capacity_indexes_);
             oprf_key_ = move(source.oprf_key_);
             source.oprf_key_ = OPRFKey();
 
@@ -788,6 +984,9 @@ namespace apsu {
             // Clear the BinBundles
             bin_bundles_.clear();
             bin_bundles_.resize(params_.bundle_idx_count());
+            capacity_indexes_.assign(
+                params_.bundle_idx_count(),
+                BinCapacityIndex(params_.bins_per_bundle(), params_.item_params().felts_per_item));
 
             // Reset the stripped_ flag
             stripped_ = false;
@@ -808,15 +1007,47 @@ namespace apsu {
         void ReceiverDB::generate_caches()
         {
             STOPWATCH(recv_stopwatch, "ReceiverDB::generate_caches");
-            APSU_LOG_INFO("Start generating bin bundle caches");
 
+            // Only the stale caches need to be regenerated
+            vector<BinBundle *> stale_bin_bundles;
+            size_t bin_bundle_count = 0;
             for (auto &bundle_idx : bin_bundles_) {
                 for (auto &bb : bundle_idx) {
-                    bb.regen_cache();
+                    if (bb.cache_invalid()) {
+                        stale_bin_bundles.push_back(&bb);
+                    }
                 }
+                bin_bundle_count += bundle_idx.size();
             }
+            size_t stale_count = stale_bin_bundles.size();
+            APSU_LOG_INFO(
+                "Start generating bin bundle caches for " << stale_count << " of "
+                                                          << bin_bundle_count << " bin bundles");
+
+            // The bin bundles are independent, so they are regenerated in parallel. Each of them
+            // also spreads its bins over the pool, which keeps the pool busy when there are only
+            // a few bin bundles.
+            auto start = chrono::steady_clock::now();
+            auto elapsed_seconds = [&]() {
+                return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            };
+            size_t report_interval = max<size_t>(1, stale_count / 10);
+            atomic<size_t> done_count{ 0 };
 
-            APSU_LOG_INFO("Finished generating bin bundle caches");
+            ThreadPoolMgr tpm;
+            tpm.thread_pool().parallel_for(stale_count, [&](size_t i) {
+                stale_bin_bundles[i]->regen_cache();
+
+                size_t done = ++done_count;
+                if (done % report_interval == 0 && done != stale_count) {
+                    APSU_LOG_INFO(
+                        "Generated " << done << " of " << stale_count << " bin bundle caches ("
+                                     << elapsed_seconds() << " s)");
+                }
+            });
+
+            APSU_LOG_INFO(
+                "Finished generating bin bundle caches in " << elapsed_seconds() << " s");
         }
 
         vector<reference_wrapper<const BinBundleCache>> ReceiverDB::get_cache_at(uint32_t bundle_idx)
@@ -925,6 +1156,7 @@ namespace apsu {
                 dispatch_insert_or_assign(
                     data_with_indices,
                     bin_bundles_,
+                    capacity_indexes_,
                     crypto_context_,
                     bins_per_bundle,
                     label_size,
@@ -948,6 +1180,7 @@ namespace apsu {
                 dispatch_insert_or_assign(
                     data_with_indices,
                     bin_bundles_,
+                    capacity_indexes_,
                     crypto_context_,
                     bins_per_bundle,
                     label_size,
@@ -1007,11 +1240,14 @@ namespace apsu {
 
             // Break the new data down into its field element representation. Also compute the
             // items' cuckoo indices.
-            if(!hasSocket){
+            if (!offline_oprf_ && !hasSocket) {
                 APSU_LOG_ERROR("SOCKET DOESNT INIT");
             }
-            vector<pair<AlgItem, size_t>> data_with_indices =
-                preprocess_unlabeled_data(hashed_data.begin(), hashed_data.end(), params_,DBSocket);
+            AlgItemsWithIndices alg_items =
+                offline_oprf_
+                    ? preprocess_unlabeled_data(hashed_data.begin(), hashed_data.end(), params_)
+                    : preprocess_unlabeled_data(
+                          hashed_data.begin(), hashed_data.end(), params_, DBSocket);
 
             // Dispatch the insertion
             uint32_t bins_per_bundle = params_.bins_per_bundle();
@@ -1019,8 +1255,9 @@ namespace apsu {
             uint32_t ps_low_degree = params_.query_params().ps_low_degree;
 
             dispatch_insert_or_assign(
-                data_with_indices,
+                alg_items.data_with_indices,
                 bin_bundles_,
+                capacity_indexes_,
                 crypto_context_,
                 bins_per_bundle,
                 0, /* label size */
@@ -1077,12 +1314,16 @@ namespace apsu {
 
             // Break the data down into its field element representation. Also compute the items'
             // cuckoo indices.
-            vector<pair<AlgItem, size_t>> data_with_indices =
-                preprocess_unlabeled_data(hashed_data.begin(), hashed_data.end(), params_,DBSocket);
+            AlgItemsWithIndices alg_items =
+                offline_oprf_
+                    ? preprocess_unlabeled_data(hashed_data.begin(), hashed_data.end(), params_)
+                    : preprocess_unlabeled_data(
+                          hashed_data.begin(), hashed_data.end(), params_, DBSocket);
 
             // Dispatch the removal
             uint32_t bins_per_bundle = params_.bins_per_bundle();
-            dispatch_remove(data_with_indices, bin_bundles_, bins_per_bundle);
+            dispatch_remove(
+                alg_items.data_with_indices, bin_bundles_, capacity_indexes_, bins_per_bundle);
 
             // Generate the BinBundle caches
             generate_caches();
@@ -1138,9 +1379,11 @@ namespace apsu {
             // Preprocess a single element. This algebraizes the item and gives back its field
             // element representation as well as its cuckoo hash. We only read one of the locations
             // because the labels are the same in each location.
-            AlgItem alg_item;
+            AlgItemsWithIndices alg_items =
+                preprocess_unlabeled_data(hashed_item, params_, offline_oprf_, DBSocket);
+            gsl::span<const felt_t> alg_item;
             size_t cuckoo_idx;
-            tie(alg_item, cuckoo_idx) = preprocess_unlabeled_data(hashed_item, params_,DBSocket)[0];
+            tie(alg_item, cuckoo_idx) = alg_items.data_with_indices[0];
 
             // Now figure out where to look to get the label
             size_t bin_idx, bundle_idx;
@@ -1216,7 +1459,24 @@ namespace apsu {
                 return ret;
             }());
 
-            auto bin_bundle_count = get_bin_bundle_count();
+            vector<pair<uint32_t, const BinBundle *>> bin_bundles;
+            for (size_t bundle_idx = 0; bundle_idx < bin_bundles_.size(); bundle_idx++) {
+                for (auto &bb : bin_bundles_[bundle_idx]) {
+                    bin_bundles.emplace_back(static_cast<uint32_t>(bundle_idx), &bb);
+                }
+            }
+            auto bin_bundle_count = bin_bundles.size();
+
+            // The sizes of the BinBundle buffers form an index that lets Load find every BinBundle
+            // up front. The sizes are only known once the BinBundles are written, so the index is
+            // reserved here and filled in afterwards; a stream we cannot seek back in gets no
+            // index, and Load then reads the BinBundles one after another.
+            streampos header_pos = out.tellp();
+            bool write_index = header_pos != streampos(-1);
+            flatbuffers::Offset<flatbuffers::Vector<uint64_t>> bin_bundle_sizes;
+            if (write_index) {
+                bin_bundle_sizes = fbs_builder.CreateVector(vector<uint64_t>(bin_bundle_count, 0));
+            }
 
             fbs::ReceiverDBBuilder receiver_db_builder(fbs_builder);
             receiver_db_builder.add_params(params);
@@ -1224,6 +1484,10 @@ namespace apsu {
             receiver_db_builder.add_oprf_key(oprf_key);
             receiver_db_builder.add_hashed_items(hashed_items);
             receiver_db_builder.add_bin_bundle_count(safe_cast<uint32_t>(bin_bundle_count));
+            receiver_db_builder.add_offline_oprf(offline_oprf_);
+            if (write_index) {
+                receiver_db_builder.add_bin_bundle_sizes(bin_bundle_sizes);
+            }
             auto sdb = receiver_db_builder.Finish();
             fbs_builder.FinishSizePrefixed(sdb);
 
@@ -1232,18 +1496,59 @@ namespace apsu {
                 safe_cast<streamsize>(fbs_builder.GetSize()));
             size_t total_size = fbs_builder.GetSize();
 
-            // Finally write the BinBundles
-            size_t bin_bundle_data_size = 0;
-            for (size_t bundle_idx = 0; bundle_idx < bin_bundles_.size(); bundle_idx++) {
-                for (auto &bb : bin_bundles_[bundle_idx]) {
-                    auto size = bb.save(out, static_cast<uint32_t>(bundle_idx));
+            // Serialize the BinBundles in parallel, each into its own size-prefixed buffer. Only a
+            // window of one BinBundle per thread is held in memory: it is written in order before
+            // the next window is serialized.
+            ThreadPoolMgr tpm;
+            size_t window_size = max<size_t>(ThreadPoolMgr::GetThreadCount(), 1);
+            vector<vector<unsigned char>> bin_bundle_data(min(window_size, bin_bundle_count));
+            vector<uint64_t> bin_bundle_data_sizes;
+            bin_bundle_data_sizes.reserve(bin_bundle_count);
+            for (size_t window_begin = 0; window_begin < bin_bundle_count;
+                 window_begin += window_size) {
+                size_t window_count = min(window_size, bin_bundle_count - window_begin);
+                tpm.thread_pool().parallel_for(window_count, [&](size_t i) {
+                    auto &bin_bundle = bin_bundles[window_begin + i];
+                    bin_bundle_data[i] = bin_bundle.second->save(bin_bundle.first);
+                });
+
+                for (size_t i = 0; i < window_count; i++) {
+                    out.write(
+                        reinterpret_cast<const char *>(bin_bundle_data[i].data()),
+                        safe_cast<streamsize>(bin_bundle_data[i].size()));
                     APSU_LOG_DEBUG(
-                        "Saved BinBundle at bundle index " << bundle_idx << " (" << size
-                                                           << " bytes)");
-                    bin_bundle_data_size += size;
+                        "Saved BinBundle at bundle index "
+                        << bin_bundles[window_begin + i].first << " ("
+                        << bin_bundle_data[i].size() << " bytes)");
+                    bin_bundle_data_sizes.push_back(bin_bundle_data[i].size());
+
+                    // Release the buffer as soon as it is written
+                    vector<unsigned char>().swap(bin_bundle_data[i]);
                 }
             }
 
+            // Fill in the index now that the sizes are known
+            if (write_index) {
+                auto sizes = fbs::GetSizePrefixedReceiverDB(fbs_builder.GetBufferPointer())
+                                 ->bin_bundle_sizes();
+                auto sizes_data = const_cast<uint8_t *>(sizes->Data());
+                for (size_t i = 0; i < bin_bundle_count; i++) {
+                    flatbuffers::WriteScalar(
+                        sizes_data + i * sizeof(uint64_t), bin_bundle_data_sizes[i]);
+                }
+
+                auto index_offset =
+                    static_cast<streamoff>(sizes_data - fbs_builder.GetBufferPointer());
+                streampos end_pos = out.tellp();
+                out.seekp(header_pos + index_offset);
+                out.write(
+                    reinterpret_cast<const char *>(sizes_data),
+                    safe_cast<streamsize>(bin_bundle_count * sizeof(uint64_t)));
+                out.seekp(end_pos);
+            }
+
+            size_t bin_bundle_data_size = accumulate(
+                bin_bundle_data_sizes.begin(), bin_bundle_data_sizes.end(), size_t(0));
             total_size += bin_bundle_data_size;
             APSU_LOG_DEBUG(
                 "Saved ReceiverDB with " << get_item_count() << " items (" << total_size
@@ -1254,22 +1559,18 @@ namespace apsu {
             return total_size;
         }
 
-        pair<ReceiverDB, size_t> ReceiverDB::Load(istream &in)
+        unique_ptr<ReceiverDB> ReceiverDB::LoadHeader(
+            gsl::span<const unsigned char> in, vector<size_t> &bin_bundle_sizes)
         {
-            STOPWATCH(recv_stopwatch, "ReceiverDB::Load");
-            APSU_LOG_DEBUG("Start loading ReceiverDB");
-
-            vector<unsigned char> in_data(apsu::util::read_from_stream(in));
-
             auto verifier = flatbuffers::Verifier(
-                reinterpret_cast<const uint8_t *>(in_data.data()), in_data.size());
+                reinterpret_cast<const uint8_t *>(in.data()), in.size());
             bool safe = fbs::VerifySizePrefixedReceiverDBBuffer(verifier);
             if (!safe) {
                 APSU_LOG_ERROR("Failed to load ReceiverDB: the buffer is invalid");
                 throw runtime_error("failed to load ReceiverDB");
             }
 
-            auto sdb = fbs::GetSizePrefixedReceiverDB(in_data.data());
+            auto sdb = fbs::GetSizePrefixedReceiverDB(in.data());
 
             // Load the PSUParams; this will automatically check version compatibility
             unique_ptr<PSUParams> params;
@@ -1291,6 +1592,7 @@ namespace apsu {
 
             bool compressed = sdb->info()->compressed();
             bool stripped = sdb->info()->stripped();
+            bool offline_oprf = sdb->offline_oprf();
 
             APSU_LOG_DEBUG(
                 "Loaded ReceiverDB properties: "
@@ -1307,13 +1609,16 @@ namespace apsu {
                 << boolalpha << compressed
                 << "; "
                    "stripped: "
-                << boolalpha << stripped);
+                << boolalpha << stripped
+                << "; "
+                   "offline_oprf: "
+                << boolalpha << offline_oprf);
 
             // Create the correct kind of ReceiverDB
             unique_ptr<ReceiverDB> receiver_db;
             try {
-                receiver_db =
-                    make_unique<ReceiverDB>(*params, label_byte_count, nonce_byte_count, compressed);
+                receiver_db = make_unique<ReceiverDB>(
+                    *params, label_byte_count, nonce_byte_count, compressed, offline_oprf);
                 receiver_db->stripped_ = stripped;
                 receiver_db->item_count_ = item_count;
             } catch (const invalid_argument &ex) {
@@ -1352,60 +1657,78 @@ namespace apsu {
                 }
             }
 
-            uint32_t bin_bundle_count = sdb->bin_bundle_count();
-            size_t bin_bundle_data_size = 0;
-            uint32_t max_bin_size = params->table_params().max_items_per_bin;
-            uint32_t ps_low_degree = params->query_params().ps_low_degree;
-            uint32_t bins_per_bundle = params->bins_per_bundle();
-            size_t label_size = compute_label_size(nonce_byte_count + label_byte_count, *params);
-
-            // Load all BinBundle data
-            vector<vector<unsigned char>> bin_bundle_data;
-            bin_bundle_data.reserve(bin_bundle_count);
-            while (bin_bundle_count--) {
-                bin_bundle_data.push_back(read_from_stream(in));
+            // Files saved before the index was added have none
+            bin_bundle_sizes.assign(sdb->bin_bundle_count(), 0);
+            if (sdb->bin_bundle_sizes()) {
+                if (sdb->bin_bundle_sizes()->size() != bin_bundle_sizes.size()) {
+                    APSU_LOG_ERROR(
+                        "The loaded ReceiverDB has an index of "
+                        << sdb->bin_bundle_sizes()->size() << " BinBundles but holds "
+                        << bin_bundle_sizes.size());
+                    throw runtime_error("failed to load ReceiverDB");
+                }
+                for (flatbuffers::uoffset_t i = 0; i < sdb->bin_bundle_sizes()->size(); i++) {
+                    // Every entry is the size of a buffer with a 32-bit size prefix
+                    uint64_t size = sdb->bin_bundle_sizes()->Get(i);
+                    if (size <= sizeof(uint32_t) ||
+                        size - sizeof(uint32_t) > numeric_limits<uint32_t>::max()) {
+                        APSU_LOG_ERROR(
+                            "The loaded ReceiverDB index has an invalid BinBundle size (" << size
+                                                                                         << ")");
+                        throw runtime_error("failed to load ReceiverDB");
+                    }
+                    bin_bundle_sizes[i] = static_cast<size_t>(size);
+                }
             }
 
+            return receiver_db;
+        }
+
+        size_t ReceiverDB::load_bin_bundles(
+            const vector<pair<gsl::span<const unsigned char>, shared_ptr<const void>>>
+                &bin_bundle_data)
+        {
+            uint32_t max_bin_size = params_.table_params().max_items_per_bin;
+            uint32_t ps_low_degree = params_.query_params().ps_low_degree;
+            uint32_t bins_per_bundle = params_.bins_per_bundle();
+            size_t label_size = compute_label_size(nonce_byte_count_ + label_byte_count_, params_);
+
             // Use multiple threads to recreate the BinBundles
             ThreadPoolMgr tpm;
 
-            vector<mutex> bundle_idx_mtxs(receiver_db->bin_bundles_.size());
-            mutex bin_bundle_data_size_mtx;
+            vector<mutex> bundle_idx_mtxs(bin_bundles_.size());
+            atomic<size_t> bin_bundle_data_size{ 0 };
             vector<future<void>> futures;
             for (size_t i = 0; i < bin_bundle_data.size(); i++) {
                 futures.push_back(tpm.thread_pool().enqueue([&, i]() {
                     BinBundle bb(
-                        receiver_db->crypto_context_,
+                        crypto_context_,
                         label_size,
                         max_bin_size,
                         ps_low_degree,
                         bins_per_bundle,
-                        compressed,
-                        stripped);
-                    auto bb_data = bb.load(bin_bundle_data[i]);
-
-                    // Clear the data buffer since we have now loaded the BinBundle
-                    bin_bundle_data[i].clear();
+                        compressed_,
+                        stripped_);
+                    auto bb_data = bb.load(bin_bundle_data[i].first, bin_bundle_data[i].second);
 
                     // Check that the loaded bundle index is not out of range
-                    if (bb_data.first >= receiver_db->bin_bundles_.size()) {
+                    if (bb_data.first >= bin_bundles_.size()) {
                         APSU_LOG_ERROR(
                             "The bundle index of the loaded BinBundle ("
                             << bb_data.first << ") exceeds the maximum ("
-                            << params->bundle_idx_count() - 1 << ")");
+                            << params_.bundle_idx_count() - 1 << ")");
                         throw runtime_error("failed to load ReceiverDB");
                     }
 
                     // Add the loaded BinBundle to the correct location in bin_bundles_
                     bundle_idx_mtxs[bb_data.first].lock();
-                    receiver_db->bin_bundles_[bb_data.first].push_back(move(bb));
+                    bin_bundles_[bb_data.first].push_back(move(bb));
                     bundle_idx_mtxs[bb_data.first].unlock();
 
                     APSU_LOG_DEBUG(
                         "Loaded BinBundle at bundle index " << bb_data.first << " ("
                                                             << bb_data.second << " bytes)");
 
-                    lock_guard<mutex> bin_bundle_data_size_lock(bin_bundle_data_size_mtx);
                     bin_bundle_data_size += bb_data.second;
                 }));
             }
@@ -1415,7 +1738,40 @@ namespace apsu {
                 f.get();
             }
 
-            size_t total_size = in_data.size() + bin_bundle_data_size;
+            return bin_bundle_data_size;
+        }
+
+        pair<ReceiverDB, size_t> ReceiverDB::Load(istream &in)
+        {
+            STOPWATCH(recv_stopwatch, "ReceiverDB::Load");
+            APSU_LOG_DEBUG("Start loading ReceiverDB");
+
+            vector<unsigned char> in_data(apsu::util::read_from_stream(in));
+            vector<size_t> bin_bundle_sizes;
+            auto receiver_db = LoadHeader(in_data, bin_bundle_sizes);
+
+            // Read all BinBundle data; each BinBundle keeps its own buffer. With an index every
+            // buffer is read in one go.
+            vector<pair<gsl::span<const unsigned char>, shared_ptr<const void>>> bin_bundle_data;
+            bin_bundle_data.reserve(bin_bundle_sizes.size());
+            for (size_t size : bin_bundle_sizes) {
+                shared_ptr<vector<unsigned char>> bb_data;
+                if (size) {
+                    bb_data = make_shared<vector<unsigned char>>(size);
+                    in.read(reinterpret_cast<char *>(bb_data->data()), safe_cast<streamsize>(size));
+                    if (static_cast<size_t>(in.gcount()) != size) {
+                        APSU_LOG_ERROR("Failed to load ReceiverDB: the BinBundle data is truncated");
+                        throw runtime_error("failed to load ReceiverDB");
+                    }
+                } else {
+                    bb_data = make_shared<vector<unsigned char>>(read_from_stream(in));
+                }
+
+                gsl::span<const unsigned char> bb_span(*bb_data);
+                bin_bundle_data.emplace_back(bb_span, move(bb_data));
+            }
+
+            size_t total_size = in_data.size() + receiver_db->load_bin_bundles(bin_bundle_data);
             APSU_LOG_DEBUG(
                 "Loaded ReceiverDB with " << receiver_db->get_item_count() << " items (" << total_size
                                         << " bytes)");
@@ -1428,7 +1784,65 @@ namespace apsu {
             return { move(*receiver_db), total_size };
         }
 
+        pair<ReceiverDB, size_t> ReceiverDB::LoadMapped(const string &path)
+        {
+            STOPWATCH(recv_stopwatch, "ReceiverDB::LoadMapped");
+            APSU_LOG_DEBUG("Start loading ReceiverDB from mapped file " << path);
+
+            auto file = make_shared<MappedFile>(path);
+            gsl::span<const unsigned char> file_data = file->data();
+
+            // The ReceiverDB and each BinBundle after it are size-prefixed buffers; find each
+            // buffer in the mapping without copying it
+            size_t offset = 0;
+            auto buffer_at_offset = [&](size_t size) {
+                if (file_data.size() - offset < size) {
+                    APSU_LOG_ERROR("Failed to load ReceiverDB: " << path << " is truncated");
+                    throw runtime_error("failed to load ReceiverDB");
+                }
+
+                auto buffer = file_data.subspan(offset, size);
+                offset += size;
+                return buffer;
+            };
+            auto next_buffer = [&]() {
+                uint32_t size = 0;
+                copy_bytes(buffer_at_offset(sizeof(uint32_t)).data(), sizeof(uint32_t), &size);
+                offset -= sizeof(uint32_t);
+                return buffer_at_offset(sizeof(uint32_t) + size);
+            };
+
+            vector<size_t> bin_bundle_sizes;
+            auto receiver_db = LoadHeader(next_buffer(), bin_bundle_sizes);
+
+            // With an index the BinBundles are found without touching their pages here; the
+            // threads loading them read them in parallel
+            vector<pair<gsl::span<const unsigned char>, shared_ptr<const void>>> bin_bundle_data;
+            bin_bundle_data.reserve(bin_bundle_sizes.size());
+            for (size_t size : bin_bundle_sizes) {
+                bin_bundle_data.emplace_back(size ? buffer_at_offset(size) : next_buffer(), file);
+            }
+
+            receiver_db->load_bin_bundles(bin_bundle_data);
+            APSU_LOG_DEBUG(
+                "Loaded ReceiverDB with " << receiver_db->get_item_count() << " items (" << offset
+                                        << " bytes)");
+
+            // Make sure the BinBundle caches are valid
+            receiver_db->generate_caches();
+
+            APSU_LOG_DEBUG("Finished loading ReceiverDB");
+
+            return { move(*receiver_db), offset };
+        }
+
         vector<HashedItem> ReceiverDB::change_hashed_item(const gsl::span<const Item> &origin_item) const {
+            // In offline OPRF mode the items are hashed with our own key; the sender obtains the
+            // same hashes through an OPRF request
+            if (offline_oprf_) {
+                return OPRFSender::ComputeHashes(origin_item, oprf_key_);
+            }
+
             STOPWATCH(recv_stopwatch, "Receiverdb::ComputeHashes (unlabeled)");
             APSU_LOG_DEBUG("Start computing OPRF hashes for " << origin_item.size() << " items");
 
@@ -9,6 +9,7 @@
 #include <cstdint>
 #include <iostream>
 #include <memory>
+#include <string>
 #include <unordered_set>
 #include <utility>
 #include <vector>
@@ -18,6 +19,7 @@
 
 // APSU
 #include "apsu/bin_bundle.h"
+#include "apsu/bin_capacity_index.h"
 #include "apsu/crypto_context.h"
 #include "apsu/item.h"
 #include "apsu/oprf/oprf_sender.h"
@@ -51,6 +53,13 @@ namespace apsu {
         and can be disabled when constructing the ReceiverDB. The downside of in-memory compression is
         a performance reduction from decompressing parts of the data when they are used, and
         recompressing them if they are updated.
+
+        By default the unlabeled items are encoded with the sender's live KKRT OPRF while they are
+        inserted, so the ReceiverDB is bound to one session and must be rebuilt for every query.
+        In offline OPRF mode the items are instead hashed with the ReceiverDB's own OPRF key, as in
+        the labeled case. All the preprocessing then happens without the sender and the ReceiverDB
+        can be saved and loaded again later; the only per-session step is answering the sender's
+        OPRF request (see Receiver::RunOPRF) with the same key.
         */
         class ReceiverDB {
         public:
@@ -61,7 +70,8 @@ namespace apsu {
                 PSUParams params,
                 std::size_t label_byte_count = 0,
                 std::size_t nonce_byte_count = 16,
-                bool compressed = true);
+                bool compressed = true,
+                bool offline_oprf = false);
 
             /**
             Creates a new ReceiverDB.
@@ -71,7 +81,8 @@ namespace apsu {
                 oprf::OPRFKey oprf_key,
                 std::size_t label_byte_count = 0,
                 std::size_t nonce_byte_count = 16,
-                bool compressed = true);
+                bool compressed = true,
+                bool offline_oprf = false);
 
             /**
             Creates a new ReceiverDB by moving from an existing one.
@@ -120,6 +131,15 @@ namespace apsu {
                 return compressed_;
             }
 
+            /**
+            Indicates whether the items are hashed with the OPRF key of the ReceiverDB instead of
+            the live KKRT OPRF, so that the ReceiverDB can be reused across sessions.
+            */
+            bool is_offline_oprf() const
+            {
+                return offline_oprf_;
+            }
+
             /**
             Indicates whether the ReceiverDB has been stripped of all information not needed for
             serving a query.
@@ -292,7 +312,9 @@ namespace apsu {
             }
 
             /**
-            Writes the ReceiverDB to a stream.
+            Writes the ReceiverDB to a stream. The BinBundles are serialized in parallel, a window
+            of one per thread at a time, and written in order. If the stream supports seeking, the
+            sizes of their buffers are written with the ReceiverDB as an index.
             */
             std::size_t save(std::ostream &out) const;
 
@@ -301,6 +323,17 @@ namespace apsu {
             */
             static std::pair<ReceiverDB, std::size_t> Load(std::istream &in);
 
+            /**
+            Reads the ReceiverDB from a file written by save, mapping the file into memory instead
+            of reading it. Every buffer is verified once and the batched plaintexts are used where
+            they lie in the mapping, so loading costs little more than verification and the pages
+            are read as queries touch them. The bins of a BinBundle that was not stripped are
+            copied out only when an update touches the BinBundle. The file must not change while
+            the ReceiverDB exists. The returned size is the number of bytes the ReceiverDB takes
+            at the start of the file.
+            */
+            static std::pair<ReceiverDB, std::size_t> LoadMapped(const std::string &path);
+
             void setSocket(coproto::AsioSocket input){
                 DBSocket = input;
                 hasSocket = true;
@@ -318,6 +351,23 @@ namespace apsu {
 
             void generate_caches();
 
+            /**
+            Creates a ReceiverDB without BinBundles from a serialized ReceiverDB. Sets
+            bin_bundle_sizes to the sizes of the BinBundle buffers that follow it, with zeros if
+            the data has no index.
+            */
+            static std::unique_ptr<ReceiverDB> LoadHeader(
+                gsl::span<const unsigned char> in, std::vector<std::size_t> &bin_bundle_sizes);
+
+            /**
+            Loads serialized BinBundles in parallel, each from a buffer owned by the accompanying
+            pointer, and returns their total size in bytes.
+            */
+            std::size_t load_bin_bundles(
+                const std::vector<
+                    std::pair<gsl::span<const unsigned char>, std::shared_ptr<const void>>>
+                    &bin_bundle_data);
+
             std::vector<HashedItem> change_hashed_item(const gsl::span< const Item > &origin_item) const;
             /**
             The set of all items that have been inserted into the database
@@ -368,12 +418,24 @@ namespace apsu {
             */
             bool stripped_;
 
+            /**
+            Indicates whether the items are hashed with oprf_key_ instead of the live KKRT OPRF.
+            */
+            bool offline_oprf_;
+
             /**
             All the BinBundles in the database, indexed by bundle index. The set (represented by a
             vector internally) at bundle index i contains all the BinBundles with bundle index i.
             */
             std::vector<std::vector<BinBundle>> bin_bundles_;
 
+            /**
+            For each bundle index, tracks how full the BinBundles are so that inserting an item
+            does not try every BinBundle. Each is rebuilt on the first insertion after it goes
+            stale, which it is after loading.
+            */
+            std::vector<BinCapacityIndex> capacity_indexes_;
+
             /**
             Holds the OPRF key for this ReceiverDB.
             */
@@ -2,9 +2,10 @@
 // Licensed under the MIT license.
 
 // STD
-#include <future>
+#include <atomic>
 #include <sstream>
 #include <fstream>
+#include <unordered_map>
 // APSU
 #include "apsu/crypto_context.h"
 #include "apsu/log.h"
@@ -13,8 +14,11 @@
 #include "apsu/psu_params.h"
 #include "apsu/seal_object.h"
 #include "apsu/receiver_ddh.h"
+#include "apsu/memory_pool_mgr.h"
 #include "apsu/thread_pool_mgr.h"
+#include "apsu/util/db_encoding.h"
 #include "apsu/util/stopwatch.h"
+#include "apsu/util/task_group.h"
 #include "apsu/util/utils.h"
 
 // SEAL
@@ -38,35 +42,12 @@ namespace apsu {
     namespace receiver {
 
         namespace {
-            std::vector<std::vector<oc::block> > random_map_block;
-            vector<oc::block> random_matrix;
             template <typename T>
             bool has_n_zeros(T *ptr, size_t count)
             {
                 return all_of(ptr, ptr + count, [](auto a) { return a == T(0); });
             }
 
-            inline oc::block vec_to_oc_block(const std::vector<uint64_t> &in,size_t felts_per_item,uint64_t plain_modulus){
-                uint32_t plain_modulus_len = 1;
-                while(((1<<plain_modulus_len)-1)<plain_modulus){
-                    plain_modulus_len++;
-                }
-                uint64_t plain_modulus_mask = (1<<plain_modulus_len)-1;
-                uint64_t plain_modulus_mask_lower = (1<<(plain_modulus_len>>1))-1;
-                uint64_t plain_modulus_mask_higher = plain_modulus_mask-plain_modulus_mask_lower;
-
-                uint64_t lower=0,higher=0;
-                if(felts_per_item&1){
-                    lower = (in[felts_per_item-1] & plain_modulus_mask_lower);
-                    higher = ((in[felts_per_item-1] & plain_modulus_mask_higher) >>((plain_modulus_len>>1)-1));
-                }
-                for(int pla = 0;pla < felts_per_item;pla+=2){
-                    lower = ((in[pla] & plain_modulus_mask) | (lower<<plain_modulus_len));
-                    higher = ((in[pla+1] & plain_modulus_mask) | (higher<<plain_modulus_len));
-                }
-                return oc::toBlock(higher,lower);
-            }
-
             // inline block vec_to_std_block(const std::vector<uint64_t> &in,size_t felts_per_item,uint64_t plain_modulus){
             //     uint32_t plain_modulus_len = 1;
             //     while(((1<<plain_modulus_len)-1)<plain_modulus){
@@ -96,7 +77,7 @@ namespace apsu {
 
 
         } // namespace
-        oc::Timer all_timer;
+
         void Receiver::RunParams(
             const ParamsRequest &params_request,
             shared_ptr<ReceiverDB> receiver_db,
@@ -104,7 +85,6 @@ namespace apsu {
             function<void(Channel &, Response)> send_fun)
         {
             STOPWATCH(recv_stopwatch, "Receiver::RunParams");
-            all_timer.setTimePoint("RunParames start");
             if (!params_request) {
                 APSU_LOG_ERROR("Failed to process parameter request: request is invalid");
                 throw invalid_argument("request is invalid");
@@ -131,31 +111,70 @@ namespace apsu {
             }
 
             APSU_LOG_INFO("Finished processing parameter request");
-            all_timer.setTimePoint("RunParames finish");
         }
 
-      
+        void Receiver::RunOPRF(
+            const OPRFRequest &oprf_request,
+            OPRFKey key,
+            network::Channel &chl,
+            function<void(Channel &, Response)> send_fun)
+        {
+            STOPWATCH(recv_stopwatch, "Receiver::RunOPRF");
+
+            if (!oprf_request) {
+                APSU_LOG_ERROR("Failed to process OPRF request: request is invalid");
+                throw invalid_argument("request is invalid");
+            }
+
+            APSU_LOG_INFO(
+                "Start processing OPRF request for " << oprf_request->data.size() / oprf_query_size
+                                                     << " items");
+
+            // OPRF response has the same size as the OPRF query
+            OPRFResponse response_oprf = make_unique<OPRFResponse::element_type>();
+            try {
+                response_oprf->data = OPRFSender::ProcessQueries(oprf_request->data, key);
+            } catch (const exception &ex) {
+                // Something was wrong with the OPRF request. This can mean malicious
+                // data being sent to the receiver in an attempt to extract OPRF key.
+                // Best not to respond anything.
+                APSU_LOG_ERROR("Processing OPRF request threw an exception: " << ex.what());
+                return;
+            }
+
+            try {
+                send_fun(chl, move(response_oprf));
+            } catch (const exception &ex) {
+                APSU_LOG_ERROR(
+                    "Failed to send response to OPRF request; function threw an exception: "
+                    << ex.what());
+                throw;
+            }
+
+            APSU_LOG_INFO("Finished processing OPRF request");
+        }
+
 
         void Receiver::RunQuery(
             const Query &query,
+            QueryContext &context,
             Channel &chl,
             function<void(Channel &, Response)> send_fun,
             function<void(Channel &, ResultPart)> send_rp_fun
            )
         {
+            oc::Timer &all_timer = context.all_timer;
             all_timer.setTimePoint("RunQuery start");
-            random_map.clear();
-            random_after_permute_map.clear();
-            random_plain_list.clear();
-            
             
             if (!query) {
                 APSU_LOG_ERROR("Failed to process query request: query is invalid");
                 throw invalid_argument("query is invalid");
             }
 
-            // We use a custom SEAL memory that is freed after the query is done
-            auto pool = MemoryManager::GetPool(mm_force_new);
+            // Every thread allocates from its own SEAL memory pool, which is kept for later
+            // queries. No pool is dropped while this query is in flight.
+            MemoryPoolMgr::QueryScope pool_query_scope;
+            auto pool = MemoryPoolMgr::GetPool();
 
             ThreadPoolMgr tpm;
 
@@ -185,7 +204,8 @@ namespace apsu {
             PowersDag pd = query.pd();
 
             // get the col of the matrix 
-            u_int64_t alpha_max_cache_count = 0;
+            uint64_t &alpha_max_cache_count = context.alpha_max_cache_count;
+            alpha_max_cache_count = 0;
             std::vector<size_t> cache_cnt_per_bundle;
             for (size_t bundle_idx = 0; bundle_idx < bundle_idx_count; bundle_idx++) {
                 cache_cnt_per_bundle.emplace_back(receiver_db->get_bin_bundle_count(static_cast<uint32_t>(bundle_idx)));
@@ -199,8 +219,8 @@ namespace apsu {
             response_query->package_count = package_count;
             response_query->alpha_max_cache_count = alpha_max_cache_count;
             APSU_LOG_INFO(package_count);
-            item_cnt = bundle_idx_count * safe_cast<uint32_t>(params.items_per_bundle());
-            APSU_LOG_INFO(item_cnt);
+            context.item_cnt = bundle_idx_count * safe_cast<uint32_t>(params.items_per_bundle());
+            APSU_LOG_INFO(context.item_cnt);
             try {
                 send_fun(chl, move(response_query));
             } catch (const exception &ex) {
@@ -212,80 +232,15 @@ namespace apsu {
             
 
 
-            random_map_block.reserve(bundle_idx_count);
-            
-            // generate random number
+            // The masks do not depend on the query; take a set the pool generated in advance
             {
                 all_timer.setTimePoint("random gen start");
-                // prepare PRNG
-                vector<uint64_t> random_num;
-                prng_seed_type newseed;
-                random_bytes(reinterpret_cast<seal_byte *>(newseed.data()), prng_seed_byte_count);
-                UniformRandomGeneratorInfo myGEN(prng_type::blake2xb, newseed);
-                std::shared_ptr<UniformRandomGenerator> myprng = myGEN.make_prng();
-                auto context_data = crypto_context.seal_context()->last_context_data();
-                // cout << "mod q" << endl;
-                // random mod q
-                //cout << context_data->parms().coeff_modulus().back().value() << endl;
-                uint64_t plain_modulus = context_data->parms().plain_modulus().value();
-                auto encoder = crypto_context.encoder();
-                size_t slot_count = encoder->slot_count();
-
-                size_t felts_per_item = safe_cast<size_t>(params.item_params().felts_per_item);
-                size_t items_per_bundle = safe_cast<size_t>(params.items_per_bundle());
-                int block_num = ((felts_per_item+3)/4);
-                vector<vector<oc::block > > receiver_set(block_num);
-                vector<vector<oc::block > > receiver_share(block_num);
-                
-               
-                for(size_t cache_idx = 0;cache_idx < alpha_max_cache_count;cache_idx++)
-                 {
-                    for (size_t bundle_idx = 0; bundle_idx < bundle_idx_count; bundle_idx++){
-                        // judge need to padding the cache
-                        bool padding_to_max_cache_size=(cache_idx>=cache_cnt_per_bundle[bundle_idx]);
-                //        APSU_LOG_INFO("error"<<cache_idx<<' '<<cache_cnt_per_bundle[bundle_idx]);
-                        if(padding_to_max_cache_size){  
-                            
-                            for(size_t i = 0;i< items_per_bundle;i++)
-                                random_matrix.emplace_back(oc::AllOneBlock);
-                            continue;
-                        }
-                        
-                        Plaintext random_plain(pool);
-                        random_num.clear();
-                        for (int i = 0; i < slot_count; i++)
-                        {
-                            random_num.emplace_back(myprng->generate() % plain_modulus);
-                            //random_num.emplace_back(0);
-                                    //random_num.push_back(i % small_q);
-                                    //random_num.push_back(0);
-                        }
-                        // gsl::span<uint64_t> random_mem = { random_num.data(), random_num.size() };
-                        for(size_t i=0;i<items_per_bundle;i++){
-                            vector<uint64_t> rest(felts_per_item,0);
-                            for(size_t j = 0;j<felts_per_item;j++){
-                                rest[j] = random_num[i*felts_per_item+j];
-                            }
-                            //random_map_block[bundle_idx].emplace_back(vec_to_oc_block(move(rest),felts_per_item,plain_modulus));
-                            random_matrix.emplace_back(vec_to_oc_block(move(rest),felts_per_item,plain_modulus));
-                        }
-
-                      //  APSU_LOG_INFO("cbp_idx"<<cache_idx<<' '<<bundle_idx<<' '<<random_plain_list.size());
-
-                        encoder->encode(random_num, random_plain);
-                        random_plain_list.emplace_back(random_plain);
-                        random_map.emplace_back(random_num);
-                      
-                        // for(auto x :  random_map[0])
-                        //     std::cout<<x<<endl;
-                    }
-                                  
-                }
+                QueryMasks masks = (mask_pool && mask_pool->receiver_db() == receiver_db)
+                                       ? mask_pool->take()
+                                       : MaskPool::Generate(*receiver_db);
+                context.random_matrix = move(masks.random_matrix);
+                context.random_plain_list = move(masks.random_plains);
                 all_timer.setTimePoint("random gen finish");
-                APSU_LOG_INFO("plain_mod" << plain_modulus);
-              //  Block::PrintBlocks(random_matrix);
-                
-
             }
 
 
@@ -293,7 +248,7 @@ namespace apsu {
             // all the way up to Qᵢ^max_items_per_bin. We don't store the zeroth power. If
             // Paterson-Stockmeyer is used, then only a subset of the powers will be populated.
             vector<CiphertextPowers> all_powers(bundle_idx_count);
-            all_timer.setTimePoint("compute power start");
+            all_timer.setTimePoint("evaluation start");
 
             // Initialize powers
             for (CiphertextPowers &powers : all_powers) {
@@ -321,210 +276,240 @@ namespace apsu {
                 }
             }
 
-            // Compute query powers for the bundle indexes
-            for (size_t bundle_idx = 0; bundle_idx < bundle_idx_count; bundle_idx++) {
-                ComputePowers(
-                    receiver_db,
-                    crypto_context,
-                    all_powers,
-                    pd,
-                    static_cast<uint32_t>(bundle_idx),
-                    pool);
+            // The query is evaluated as a task graph on the thread pool. Within a bundle index, a
+            // power is computed as soon as its parents are, and is modulus switched (and NTT
+            // transformed) once it and every power computed from it are done. The caches of the
+            // bundle index are evaluated as soon as all of its powers are final. Bundle indices
+            // proceed independently of each other, so no stage waits for all bundle indices.
+            vector<PowersDag::PowersNode> nodes;
+            pd.apply([&](const PowersDag::PowersNode &node) { nodes.push_back(node); });
+            size_t node_count = nodes.size();
+
+            unordered_map<uint32_t, size_t> node_idx_of_power;
+            for (size_t node_idx = 0; node_idx < node_count; node_idx++) {
+                node_idx_of_power[nodes[node_idx].power] = node_idx;
+            }
+
+            // The distinct parents of each node, and how many tasks must finish before each node
+            // can be computed and before it can be finalized
+            vector<vector<size_t>> parents(node_count), children(node_count);
+            for (size_t node_idx = 0; node_idx < node_count; node_idx++) {
+                const PowersDag::PowersNode &node = nodes[node_idx];
+                if (node.is_source()) {
+                    continue;
+                }
+                parents[node_idx].push_back(node_idx_of_power.at(node.parents.first));
+                if (node.parents.second != node.parents.first) {
+                    parents[node_idx].push_back(node_idx_of_power.at(node.parents.second));
+                }
+                for (size_t parent_idx : parents[node_idx]) {
+                    children[parent_idx].push_back(node_idx);
+                }
             }
-            all_timer.setTimePoint("compute power finished");
 
-            APSU_LOG_DEBUG("Finished computing powers for all bundle indices");
-            APSU_LOG_DEBUG("Start processing bin bundle caches");
-            pack_cnt=0;
-            vector<future<void>> futures;
+            size_t state_count = mul_safe(size_t(bundle_idx_count), node_count);
+            unique_ptr<atomic<size_t>[]> parents_left(new atomic<size_t>[state_count]);
+            unique_ptr<atomic<size_t>[]> finalize_left(new atomic<size_t>[state_count]);
+            unique_ptr<atomic<size_t>[]> powers_left(new atomic<size_t>[bundle_idx_count]);
             for (size_t bundle_idx = 0; bundle_idx < bundle_idx_count; bundle_idx++) {
+                powers_left[bundle_idx] = node_count;
+                for (size_t node_idx = 0; node_idx < node_count; node_idx++) {
+                    parents_left[bundle_idx * node_count + node_idx] = parents[node_idx].size();
+                    finalize_left[bundle_idx * node_count + node_idx] =
+                        children[node_idx].size() + 1;
+                }
+            }
+
+            uint32_t ps_low_degree = params.query_params().ps_low_degree;
+
+            // Result packages are sent from their own thread as they are computed. A few per
+            // pool thread may wait to be sent before evaluation stalls.
+            ResultSender result_sender(
+                chl, move(send_rp_fun), 2 * ThreadPoolMgr::GetThreadCount());
+
+            TaskGroup tasks(tpm.thread_pool());
+
+            auto process_caches = [&](size_t bundle_idx) {
                 auto bundle_caches = receiver_db->get_cache_at(static_cast<uint32_t>(bundle_idx));
                 size_t cache_idx = 0;
-               // APSU_LOG_INFO(cache_idx);
                 for (auto &cache : bundle_caches) {
-                    pack_cnt++;
                     size_t pack_idx = bundle_idx+cache_idx*bundle_idx_count;
-                    futures.push_back(tpm.thread_pool().enqueue([&, bundle_idx, cache,cache_idx,pack_idx]() {
+                    tasks.run([&, bundle_idx, cache,cache_idx,pack_idx]() {
+                        auto pool = MemoryPoolMgr::GetPool();
                         ProcessBinBundleCache(
                             receiver_db,
                             crypto_context,
+                            context,
                             cache,
                             all_powers,
-                            chl,
-                            send_rp_fun,
+                            result_sender,
                             static_cast<uint32_t>(bundle_idx),
                             query.compr_mode(),
                             pool,
-                            cache_idx,
-                            pack_idx
+                            static_cast<uint32_t>(cache_idx),
+                            static_cast<uint32_t>(pack_idx)
                             );
-                    }));
+                    });
                     cache_idx++;
                 }
-            }
-
-            // Wait until all bin bundle caches have been processed
-            for (auto &f : futures) {
-                f.get();
-            }
-
+            };
 
-            std::string outFileName = "./randomM/receiver_pi";
+            // Called when one of the tasks a node's finalization waits for is done
+            auto release_finalize = [&](size_t bundle_idx, size_t node_idx) {
+                if (--finalize_left[bundle_idx * node_count + node_idx]) {
+                    return;
+                }
+                tasks.run([&, bundle_idx, node_idx]() {
+                    auto pool = MemoryPoolMgr::GetPool();
+                    FinalizePower(
+                        crypto_context,
+                        all_powers[bundle_idx],
+                        nodes[node_idx].power,
+                        ps_low_degree,
+                        pool);
+                    if (!--powers_left[bundle_idx]) {
+                        process_caches(bundle_idx);
+                    }
+                });
+            };
+
+            // Called when a node has been computed: its parents are no longer read by it, and its
+            // children may now have all their parents
+            function<void(size_t, size_t)> node_computed = [&](size_t bundle_idx, size_t node_idx) {
+                release_finalize(bundle_idx, node_idx);
+                for (size_t parent_idx : parents[node_idx]) {
+                    release_finalize(bundle_idx, parent_idx);
+                }
+                for (size_t child_idx : children[node_idx]) {
+                    if (--parents_left[bundle_idx * node_count + child_idx]) {
+                        continue;
+                    }
+                    tasks.run([&, bundle_idx, child_idx]() {
+                        auto pool = MemoryPoolMgr::GetPool();
+                        ComputePowerNode(crypto_context, all_powers[bundle_idx], nodes[child_idx], pool);
+                        node_computed(bundle_idx, child_idx);
+                    });
+                }
+            };
 
-            std::ofstream outFile;
-            outFile.open(outFileName, std::ios::binary | std::ios::out);
-            if (!outFile.is_open()){
-                std::cout << "Vole error opening file " << outFileName << std::endl;
-                return;
+            // The source powers came with the query; bundle indices without caches are skipped
+            APSU_LOG_DEBUG("Start computing powers and processing bin bundle caches");
+            for (size_t bundle_idx = 0; bundle_idx < bundle_idx_count; bundle_idx++) {
+                if (!cache_cnt_per_bundle[bundle_idx]) {
+                    continue;
+                }
+                for (size_t node_idx = 0; node_idx < node_count; node_idx++) {
+                    if (nodes[node_idx].is_source()) {
+                        node_computed(bundle_idx, node_idx);
+                    }
+                }
             }
-            
-            outFile.write((char*)(&item_cnt), sizeof(uint64_t));
-            outFile.write((char*)(&alpha_max_cache_count), sizeof(uint64_t));
-            outFile.write((char*)random_matrix.data(), sizeof(oc::block)*(random_matrix.size()));
-            outFile.close();
-
-            // APSU_LOG_INFO(random_matrix.size());
-
-            // std::vector<oc::block> pnMCRG_out; 
-            // pnMCRGnpi(ReceiverSocket, random_matrix, item_cnt, alpha_max_cache_count, pnMCRG_out);
-            // std::vector<oc::block> shuffle_item(item_cnt);
-            // coproto::sync_wait(ReceiverSocket.recv(shuffle_item));  
-
-            // std::ofstream fout;
-            // fout.open("union.csv",std::ofstream::out);
-            // for(auto i = 0; i < item_cnt; ++i){
-            //     auto tmp_block = pnMCRG_out[i] ^ shuffle_item[i];
-            //     if(tmp_block.mData[0] == 1){
-            //         fout << tmp_block.mData[1] << endl;
-            //     }
-            // }
-            // fout.close();
-
 
+            // Wait until all bin bundle caches have been processed and their results sent
+            tasks.wait();
+            result_sender.finish();
+            APSU_LOG_DEBUG("Sent " << result_sender.sent_count() << " result packages");
 
+            // Drop the pools that grew beyond the retention limit, unless other queries still use
+            // them
+            MemoryPoolMgr::Stats pool_stats = pool_query_scope.end();
+            APSU_LOG_INFO(
+                "SEAL memory pools of " << pool_stats.pool_count << " threads hold "
+                                        << (pool_stats.retained_byte_count >> 20)
+                                        << " MB (high-water mark "
+                                        << (pool_stats.high_water_byte_count >> 20) << " MB)");
 
 
+            if (!context.random_matrix_file.empty()) {
+                std::ofstream outFile;
+                outFile.open(context.random_matrix_file, std::ios::binary | std::ios::out);
+                if (!outFile.is_open()){
+                    std::cout << "Vole error opening file " << context.random_matrix_file << std::endl;
+                    return;
+                }
 
-            // std::vector<uint8_t> vec_result;
-            // NetIO server("server","",59999);
-            // auto peqt_ans = peqt::ddh_peqt_receiver(server,random_matrix,alpha_max_cache_count,item_cnt);
+                uint64_t mask_bit_count = params.item_params().mask_bit_count;
+                outFile.write((char*)(&context.item_cnt), sizeof(uint64_t));
+                outFile.write((char*)(&alpha_max_cache_count), sizeof(uint64_t));
+                outFile.write((char*)(&mask_bit_count), sizeof(uint64_t));
+                outFile.write((char*)context.random_matrix.data(), sizeof(uint64_t)*(context.random_matrix.size()));
+                outFile.close();
+            }
 
             all_timer.setTimePoint("ProcessBinBundleCache finished");
             APSU_LOG_INFO("Finished processing query request");
-            
-// #if APSU == 1
-//             // std::vector<block> Diffset;
-//             // KunlunOT::ALSZ_KL_ChosenReceiver(server,Diffset,item_cnt,peqt_ans);
-// #endif
-
-           
             APSU_LOG_INFO(all_timer);
-         
-
         }
 
-        void Receiver::ComputePowers(
-            const shared_ptr<ReceiverDB> &receiver_db,
+        void Receiver::ComputePowerNode(
             const CryptoContext &crypto_context,
-            vector<CiphertextPowers> &all_powers,
-            const PowersDag &pd,
-            uint32_t bundle_idx,
+            CiphertextPowers &powers,
+            const PowersDag::PowersNode &node,
             MemoryPoolHandle &pool)
         {
-            STOPWATCH(recv_stopwatch, "Receiver::ComputePowers");
-            auto bundle_caches = receiver_db->get_cache_at(bundle_idx);
-            if (!bundle_caches.size()) {
-                return;
-            }
-
-            // Compute all powers of the query
-            APSU_LOG_DEBUG("Computing all query ciphertext powers for bundle index " << bundle_idx);
+            STOPWATCH(recv_stopwatch, "Receiver::ComputePowerNode");
 
             auto evaluator = crypto_context.evaluator();
-            auto relin_keys = crypto_context.relin_keys();
-
-            CiphertextPowers &powers_at_this_bundle_idx = all_powers[bundle_idx];
-            bool relinearize = crypto_context.seal_context()->using_keyswitching();
-            pd.parallel_apply([&](const PowersDag::PowersNode &node) {
-                if (!node.is_source()) {
-                    auto parents = node.parents;
-                    Ciphertext prod(pool);
-                    if (parents.first == parents.second) {
-                        evaluator->square(powers_at_this_bundle_idx[parents.first], prod, pool);
-                    } else {
-                        evaluator->multiply(
-                            powers_at_this_bundle_idx[parents.first],
-                            powers_at_this_bundle_idx[parents.second],
-                            prod,
-                            pool);
-                    }
-                    if (relinearize) {
-                        evaluator->relinearize_inplace(prod, *relin_keys, pool);
-                    }
-                    powers_at_this_bundle_idx[node.power] = move(prod);
-                }
-            });
-
-            // Now that all powers of the ciphertext have been computed, we need to transform them
-            // to NTT form. This will substantially improve the polynomial evaluation,
-            // because the plaintext polynomials are already in NTT transformed form, and the
-            // ciphertexts are used repeatedly for each bin bundle at this index. This computation
-            // is separate from the graph processing above, because the multiplications must all be
-            // done before transforming to NTT form. We omit the first ciphertext in the vector,
-            // because it corresponds to the zeroth power of the query and is included only for
-            // convenience of the indexing; the ciphertext is actually not set or valid for use.
+            auto parents = node.parents;
+            Ciphertext prod(pool);
+            if (parents.first == parents.second) {
+                evaluator->square(powers[parents.first], prod, pool);
+            } else {
+                evaluator->multiply(powers[parents.first], powers[parents.second], prod, pool);
+            }
+            if (crypto_context.seal_context()->using_keyswitching()) {
+                evaluator->relinearize_inplace(prod, *crypto_context.relin_keys(), pool);
+            }
+            powers[node.power] = move(prod);
+        }
 
-            ThreadPoolMgr tpm;
+        void Receiver::FinalizePower(
+            const CryptoContext &crypto_context,
+            CiphertextPowers &powers,
+            uint32_t power,
+            uint32_t ps_low_degree,
+            MemoryPoolHandle &pool)
+        {
+            STOPWATCH(recv_stopwatch, "Receiver::FinalizePower");
 
             // After computing all powers we will modulus switch down to parameters that one more
             // level for low powers than for high powers; same choice must be used when encoding/NTT
-            // transforming the ReceiverDB data.
+            // transforming the ReceiverDB data. The plaintext polynomials are already in NTT form
+            // and each power is used for every bin bundle at this index, so transforming the
+            // powers here substantially improves the polynomial evaluation.
+            auto evaluator = crypto_context.evaluator();
             auto high_powers_parms_id =
                 get_parms_id_for_chain_idx(*crypto_context.seal_context(), 1);
             auto low_powers_parms_id =
                 get_parms_id_for_chain_idx(*crypto_context.seal_context(), 2);
 
-            uint32_t ps_low_degree = receiver_db->get_params().query_params().ps_low_degree;
+            if (!ps_low_degree) {
+                // Only one ciphertext-plaintext multiplication is needed after this
+                evaluator->mod_switch_to_inplace(powers[power], high_powers_parms_id, pool);
 
-            vector<future<void>> futures;
-            for (uint32_t power : pd.target_powers()) {
-                futures.push_back(tpm.thread_pool().enqueue([&, power]() {
-                    if (!ps_low_degree) {
-                        // Only one ciphertext-plaintext multiplication is needed after this
-                        evaluator->mod_switch_to_inplace(
-                            powers_at_this_bundle_idx[power], high_powers_parms_id, pool);
-
-                        // All powers must be in NTT form
-                        evaluator->transform_to_ntt_inplace(powers_at_this_bundle_idx[power]);
-                    } else {
-                        if (power <= ps_low_degree) {
-                            // Low powers must be at a higher level than high powers
-                            evaluator->mod_switch_to_inplace(
-                                powers_at_this_bundle_idx[power], low_powers_parms_id, pool);
-
-                            // Low powers must be in NTT form
-                            evaluator->transform_to_ntt_inplace(powers_at_this_bundle_idx[power]);
-                        } else {
-                            // High powers are only modulus switched
-                            evaluator->mod_switch_to_inplace(
-                                powers_at_this_bundle_idx[power], high_powers_parms_id, pool);
-                        }
-                    }
-                }));
-            }
-
-            for (auto &f : futures) {
-                f.get();
+                // All powers must be in NTT form
+                evaluator->transform_to_ntt_inplace(powers[power]);
+            } else {
+                if (power <= ps_low_degree) {
+                    // Low powers must be at a higher level than high powers
+                    evaluator->mod_switch_to_inplace(powers[power], low_powers_parms_id, pool);
+
+                    // Low powers must be in NTT form
+                    evaluator->transform_to_ntt_inplace(powers[power]);
+                } else {
+                    // High powers are only modulus switched
+                    evaluator->mod_switch_to_inplace(powers[power], high_powers_parms_id, pool);
+                }
             }
         }
 
         void Receiver::ProcessBinBundleCache(
             const shared_ptr<ReceiverDB> &receiver_db,
             const CryptoContext &crypto_context,
+            const QueryContext &context,
             reference_wrapper<const BinBundleCache> cache,
             vector<CiphertextPowers> &all_powers,
-            Channel &chl,
-            function<void(Channel &, ResultPart)> send_rp_fun,
+            ResultSender &result_sender,
             uint32_t bundle_idx,
             compr_mode_type compr_mode,
             MemoryPoolHandle &pool,
@@ -553,16 +538,16 @@ namespace apsu {
             bool using_ps = (ps_low_degree > 1) && (ps_low_degree < degree);
             if (using_ps) {
                 rp->psu_result = matching_polyn.eval_patstock(
-                    crypto_context, all_powers[bundle_idx], safe_cast<size_t>(ps_low_degree), pool,random_plain_list[pack_idx]);
+                    crypto_context, all_powers[bundle_idx], safe_cast<size_t>(ps_low_degree), pool,context.random_plain_list[pack_idx]);
             } else {
-                rp->psu_result = matching_polyn.eval(all_powers[bundle_idx], pool, random_plain_list[pack_idx]);
+                rp->psu_result = matching_polyn.eval(all_powers[bundle_idx], pool, context.random_plain_list[pack_idx]);
             }
             // random_plain.set_zero();
         
 
-            // Send this result part
+            // Queue this result part for sending
             try {
-                send_rp_fun(chl, move(rp));
+                result_sender.push(move(rp));
             } catch (const exception &ex) {
                 APSU_LOG_ERROR(
                     "Failed to send result part; function threw an exception: " << ex.what());
@@ -573,8 +558,7 @@ namespace apsu {
         void Receiver::RunResponse(
             const plainRequest &plain_request, network::Channel &chl,const PSUParams &params_)
         {
-      
-
+            oc::Timer all_timer;
             all_timer.setTimePoint("RunResponse start");
 
             size_t felts_per_item = safe_cast<size_t>(params_.item_params().felts_per_item);
@@ -583,7 +567,7 @@ namespace apsu {
                 mul_safe(safe_cast<size_t>(plain_request->bundle_idx), items_per_bundle);
             ;
             ans.clear();
-            item_cnt = plain_request->psu_result.size();
+            size_t item_cnt = plain_request->psu_result.size();
             APSU_LOG_INFO("iten_cnt"<<item_cnt);
             for (int i = 0; i < item_cnt; i++) {
            /*     if (plain_request->psu_result[i] == random_mem[i]) {
@@ -28,6 +28,7 @@ With modifications:
 #include <functional>
 #include <memory>
 #include <utility>
+#include <string>
 #include <vector>
 #include <fstream>
 #include <iostream>
@@ -39,7 +40,9 @@ With modifications:
 #include "apsu/query.h"
 #include "apsu/requests.h"
 #include "apsu/responses.h"
+#include "apsu/mask_pool.h"
 #include "apsu/receiver_db.h"
+#include "apsu/result_sender.h"
 // #include "apsu/permute/apsu_OSNReceiver.h"
 
 
@@ -100,6 +103,35 @@ namespace apsu {
             };
 
         }
+
+        /**
+        The state of one query: the masks added to its results, the shape of the mask matrix, and
+        its timings. A query owns its QueryContext and RunQuery fills it in, so concurrent or
+        back-to-back queries served by one Receiver do not share state.
+        */
+        struct QueryContext {
+            /**
+            The file RunQuery writes the mask matrix to; an empty name keeps it in memory only.
+            */
+            std::string random_matrix_file;
+
+            std::uint64_t item_cnt = 0;
+
+            std::uint64_t alpha_max_cache_count = 0;
+
+            /**
+            alpha_max_cache_count rows of item_cnt masks.
+            */
+            std::vector<std::uint64_t> random_matrix;
+
+            /**
+            Batch-encoded masks, indexed by cache_idx * bundle_idx_count + bundle_idx.
+            */
+            std::vector<seal::Plaintext> random_plain_list;
+
+            oc::Timer all_timer;
+        }; // struct QueryContext
+
         /**
         The Receiver class implements all necessary functions to process and respond to parameter,
         OPRF, and PSU or labeled PSU queries (depending on the receiver). Unlike the Receiver class,
@@ -172,17 +204,36 @@ namespace apsu {
         public:
             Receiver(){
                 ans.clear();
-                pack_cnt = 0;
-                item_cnt = 0;
-                random_map.clear();
                 random_after_permute_map.clear();
-                random_plain_list.clear();
-                
             };
             void setSocket(coproto::AsioSocket input){
                 ReceiverSocket = input;
             }
 
+            /**
+            Sets the file the mask matrix of each query is written to by default; see
+            QueryContext::random_matrix_file. An empty name keeps the masks in memory only.
+            */
+            void set_random_matrix_file(std::string file)
+            {
+                random_matrix_file = std::move(file);
+            }
+
+            const std::string &get_random_matrix_file() const
+            {
+                return random_matrix_file;
+            }
+
+            /**
+            Starts generating the masks of the next query in the background. Call this once the
+            ReceiverDB is loaded; queries against any other ReceiverDB generate their masks online.
+            Copies of this Receiver share the pool.
+            */
+            void start_mask_pool(std::shared_ptr<ReceiverDB> receiver_db)
+            {
+                mask_pool = std::make_shared<MaskPool>(std::move(receiver_db));
+            }
+
 
 
 // #if ARBITARY == 0 
@@ -209,13 +260,24 @@ namespace apsu {
                 std::function<void(network::Channel &, Response)> send_fun =
                     BasicSend<Response::element_type>);
 
-
+            /**
+            Generate and send a response to an OPRF request. Only a ReceiverDB in offline OPRF mode
+            needs this, and key must be the OPRF key its items were hashed with.
+            */
+            static void RunOPRF(
+                const OPRFRequest &oprf_request,
+                oprf::OPRFKey key,
+                network::Channel &chl,
+                std::function<void(network::Channel &, Response)> send_fun =
+                    BasicSend<Response::element_type>);
 
             /**
-            Generate and send a response to a query.
+            Generate and send a response to a query. The masks and the other state of the query
+            are kept in the given QueryContext.
             */
             void RunQuery(
                 const Query &query,
+                QueryContext &context,
                 network::Channel &chl,
                 std::function<void(network::Channel &, Response)> send_fun =
                     BasicSend<Response::element_type>,
@@ -235,27 +297,38 @@ namespace apsu {
 // #endif
         private:
             /**
-            Method that handles computing powers for a given bundle index
+            Method that computes one node of the PowersDag at a given bundle index from its
+            parents.
             */
-             void ComputePowers(
-                const std::shared_ptr<ReceiverDB> &receiver_db,
+            void ComputePowerNode(
                 const CryptoContext &crypto_context,
-                std::vector<std::vector<seal::Ciphertext>> &powers,
-                const PowersDag &pd,
-                std::uint32_t bundle_idx,
+                CiphertextPowers &powers,
+                const PowersDag::PowersNode &node,
+                seal::MemoryPoolHandle &pool);
+
+            /**
+            Method that modulus switches a computed power, and transforms it to NTT form if the
+            matching polynomials need it so. It must run only once no other power is computed from
+            this one.
+            */
+            void FinalizePower(
+                const CryptoContext &crypto_context,
+                CiphertextPowers &powers,
+                std::uint32_t power,
+                std::uint32_t ps_low_degree,
                 seal::MemoryPoolHandle &pool);
 
             /**
             Method that processes a single Bin Bundle cache.
-            Sends a result package through the given channel.
+            Hands the result package to the given ResultSender.
             */
              void ProcessBinBundleCache(
                 const std::shared_ptr<ReceiverDB> &receiver_db,
                 const CryptoContext &crypto_context,
+                const QueryContext &context,
                 std::reference_wrapper<const BinBundleCache> cache,
                 std::vector<CiphertextPowers> &all_powers,
-                network::Channel &chl,
-                std::function<void(network::Channel &, ResultPart)> send_rp_fun,
+                ResultSender &result_sender,
                 std::uint32_t bundle_idx,
                 seal::compr_mode_type compr_mode,
                 seal::MemoryPoolHandle &pool,
@@ -263,13 +336,11 @@ namespace apsu {
                 std::uint32_t pack_idx
                 );
             //static std::unordered_map<std::pair<std::uint32_t, std::uint32_t>, std::vector<uint64_t>, pair_hash > random_map;
-            std::uint32_t pack_cnt;
             std::vector<uint64_t> ans;
-            std::uint64_t item_cnt;
+            std::string random_matrix_file = "./randomM/receiver_pi";
+            std::shared_ptr<MaskPool> mask_pool;
             int send_size,receiver_size;
            
-            std::vector<std::vector<uint64_t> > random_map;
-            std::vector<seal::Plaintext > random_plain_list;
             std::vector<uint64_t > random_after_permute_map;
             //std::vector<std::vector<oc::block> > random_map_block;
             //static std::vector<uint64_t> match_record;
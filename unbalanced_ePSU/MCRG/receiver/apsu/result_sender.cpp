@@ -0,0 +1,141 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+// STD
+#include <stdexcept>
+#include <utility>
+
+// APSU
+#include "apsu/log.h"
+#include "apsu/result_sender.h"
+#include "apsu/util/stopwatch.h"
+
+using namespace std;
+
+namespace apsu {
+    using namespace network;
+    using namespace util;
+
+    namespace receiver {
+        ResultSender::ResultSender(Channel &chl, SendFun send_rp_fun, size_t capacity)
+            : chl_(chl), send_rp_fun_(move(send_rp_fun)), queue_(capacity ? capacity : 1)
+        {
+            if (!send_rp_fun_) {
+                throw invalid_argument("send_rp_fun is not set");
+            }
+
+            io_thread_ = thread([this]() { run(); });
+        }
+
+        ResultSender::~ResultSender()
+        {
+            if (!io_thread_.joinable()) {
+                return;
+            }
+
+            try {
+                finish();
+            } catch (const exception &ex) {
+                APSU_LOG_ERROR("Failed to send result parts: " << ex.what());
+            }
+        }
+
+        void ResultSender::throw_if_failed() const
+        {
+            if (failed_.load(memory_order_acquire)) {
+                rethrow_exception(error_);
+            }
+        }
+
+        void ResultSender::push(ResultPart rp)
+        {
+            throw_if_failed();
+            if (closed_) {
+                throw logic_error("result sender is finished");
+            }
+
+            if (!queue_.try_push(rp)) {
+                // Announce that a producer is about to sleep, then try again under the lock; the
+                // I/O thread checks for sleeping producers after every pop
+                producers_sleeping_++;
+                atomic_thread_fence(memory_order_seq_cst);
+                unique_lock<mutex> lock(sleep_mtx_);
+                not_full_cv_.wait(lock, [&]() {
+                    return failed_.load(memory_order_acquire) || queue_.try_push(rp);
+                });
+                producers_sleeping_--;
+                lock.unlock();
+
+                throw_if_failed();
+            }
+
+            // Pairs with the fence in run: either the I/O thread sees the new part before going
+            // to sleep, or this thread sees that it sleeps
+            atomic_thread_fence(memory_order_seq_cst);
+            if (consumer_sleeping_.load(memory_order_relaxed)) {
+                lock_guard<mutex> lock(sleep_mtx_);
+                not_empty_cv_.notify_one();
+            }
+        }
+
+        void ResultSender::finish()
+        {
+            if (!io_thread_.joinable()) {
+                throw_if_failed();
+                return;
+            }
+
+            {
+                lock_guard<mutex> lock(sleep_mtx_);
+                closed_ = true;
+                not_empty_cv_.notify_one();
+            }
+            io_thread_.join();
+
+            throw_if_failed();
+        }
+
+        void ResultSender::run()
+        {
+            ResultPart rp;
+            while (true) {
+                if (!queue_.try_pop(rp)) {
+                    // Nothing to send; sleep until a part is pushed or no more parts can come
+                    unique_lock<mutex> lock(sleep_mtx_);
+                    consumer_sleeping_.store(true, memory_order_relaxed);
+                    atomic_thread_fence(memory_order_seq_cst);
+                    not_empty_cv_.wait(lock, [this]() { return !queue_.empty() || closed_; });
+                    consumer_sleeping_.store(false, memory_order_relaxed);
+
+                    if (queue_.empty()) {
+                        // Closed, and every part pushed before closing has been sent
+                        return;
+                    }
+                    continue;
+                }
+
+                // Pairs with the increment in push: either a producer finds the free slot when it
+                // retries, or this thread sees that it sleeps
+                atomic_thread_fence(memory_order_seq_cst);
+                if (producers_sleeping_) {
+                    lock_guard<mutex> lock(sleep_mtx_);
+                    not_full_cv_.notify_all();
+                }
+
+                try {
+                    STOPWATCH(recv_stopwatch, "ResultSender::send");
+                    send_rp_fun_(chl_, move(rp));
+                    sent_count_++;
+                } catch (...) {
+                    error_ = current_exception();
+                    failed_.store(true, memory_order_release);
+
+                    // Wake producers so that they fail instead of waiting for room
+                    lock_guard<mutex> lock(sleep_mtx_);
+                    not_full_cv_.notify_all();
+                    return;
+                }
+            }
+        }
+    } // namespace receiver
+} // namespace apsu
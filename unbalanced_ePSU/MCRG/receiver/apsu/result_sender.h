@@ -0,0 +1,108 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+// STD
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// APSU
+#include "apsu/network/channel.h"
+#include "apsu/responses.h"
+#include "apsu/util/mpsc_queue.h"
+
+namespace apsu {
+    namespace receiver {
+        /**
+        Sends the ResultParts of a query from a dedicated I/O thread. The threads evaluating the
+        query push each ResultPart as soon as it is computed and go back to homomorphic
+        evaluation, while the I/O thread serializes, compresses, and sends the parts in the order
+        they were pushed. This overlaps the network transfer with the remaining evaluations.
+
+        The queue between them is bounded: a push blocks while the I/O thread is that many parts
+        behind, which bounds the memory held by finished but unsent results.
+        */
+        class ResultSender {
+        public:
+            using SendFun = std::function<void(network::Channel &, ResultPart)>;
+
+            /**
+            Starts the I/O thread, which calls send_rp_fun on chl for every pushed ResultPart.
+            */
+            ResultSender(network::Channel &chl, SendFun send_rp_fun, std::size_t capacity);
+
+            /**
+            Stops the I/O thread after it has sent the parts already pushed. Errors are only
+            logged; call finish to observe them.
+            */
+            ~ResultSender();
+
+            ResultSender(const ResultSender &) = delete;
+
+            ResultSender &operator=(const ResultSender &) = delete;
+
+            /**
+            Queues a ResultPart for sending, blocking while the queue is full. This can be called
+            from any thread. Throws the exception the send function threw if an earlier part
+            could not be sent.
+            */
+            void push(ResultPart rp);
+
+            /**
+            Waits until every pushed part has been sent and stops the I/O thread. Rethrows the
+            exception the send function threw, if any. No parts can be pushed after this.
+            */
+            void finish();
+
+            /**
+            Returns the number of parts sent so far.
+            */
+            std::size_t sent_count() const
+            {
+                return sent_count_;
+            }
+
+        private:
+            void run();
+
+            void throw_if_failed() const;
+
+            network::Channel &chl_;
+
+            SendFun send_rp_fun_;
+
+            util::MPSCQueue<ResultPart> queue_;
+
+            std::atomic<std::size_t> sent_count_{ 0 };
+
+            std::atomic<bool> closed_{ false };
+
+            std::atomic<bool> failed_{ false };
+
+            std::exception_ptr error_;
+
+            /**
+            The queue itself takes no locks; the mutex only guards sleeping. The I/O thread
+            sleeps while the queue is empty and producers sleep while it is full, and each side
+            takes the mutex to wake the other only if the other announced that it is sleeping.
+            */
+            std::mutex sleep_mtx_;
+
+            std::condition_variable not_empty_cv_;
+
+            std::condition_variable not_full_cv_;
+
+            std::atomic<bool> consumer_sleeping_{ false };
+
+            std::atomic<std::size_t> producers_sleeping_{ 0 };
+
+            std::thread io_thread_;
+        }; // class ResultSender
+    }      // namespace receiver
+} // namespace apsu
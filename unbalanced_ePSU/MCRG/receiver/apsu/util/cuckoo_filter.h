@@ -9,7 +9,7 @@
 #include <vector>
 
 // APSU
-#include "apsu/util/cuckoo_filter_table.h"
+#include "apsu/util/cuckoo_filter_array.h"
 #include "apsu/util/db_encoding.h"
 
 namespace apsu {
@@ -17,7 +17,8 @@ namespace apsu {
         namespace util {
 
             /**
-            Implementation of a Cuckoo Filter
+            Implementation of a Cuckoo Filter. Use a CuckooFilterArray for many filters of the same
+            size.
             */
             class CuckooFilter {
             public:
@@ -47,69 +48,14 @@ namespace apsu {
                 */
                 std::size_t get_num_items() const
                 {
-                    return num_items_;
+                    return filters_.get_num_items(0);
                 }
 
             private:
                 /**
-                Maximum number of kicks before we give up trying to insert
+                An array holding just this filter
                 */
-                constexpr static std::size_t max_cuckoo_kicks_ = 500;
-
-                /**
-                Number of items contained in the filter
-                */
-                std::size_t num_items_;
-
-                /**
-                Represents an element that we were not able to insert in the table
-                */
-                struct OverflowCache {
-                    std::size_t index;
-                    std::uint32_t tag;
-                    bool used;
-                };
-
-                /**
-                Last element that we were not able to insert in the table
-                */
-                OverflowCache overflow_;
-
-                /**
-                Table that holds element tags
-                */
-                std::unique_ptr<CuckooFilterTable> table_;
-
-                /**
-                Returns a tag (limited by number of bits per tag)
-                */
-                std::uint32_t tag_bit_limit(std::uint32_t value) const;
-
-                /**
-                Returns a bucket index (limited by number of buckets)
-                */
-                std::size_t idx_bucket_limit(std::size_t value) const;
-
-                /**
-                Get the tag and bucket index for a given element
-                */
-                void get_tag_and_index(
-                    const apsu::util::felt_t &item, std::uint32_t &tag, std::size_t &idx) const;
-
-                /**
-                Get the alternate index for a given tag/index combination
-                */
-                std::size_t get_alt_index(std::size_t idx, std::uint32_t tag) const;
-
-                /**
-                Add the given tag/index combination to the table
-                */
-                bool add_index_tag(std::size_t idx, std::uint32_t tag);
-
-                /**
-                Try to eliminate the current overflow item
-                */
-                void try_eliminate_overflow();
+                CuckooFilterArray filters_;
             };
         } // namespace util
     }     // namespace receiver
@@ -0,0 +1,159 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+// APSU
+#include "apsu/util/cuckoo_filter_array.h"
+#include "apsu/util/hash.h"
+#include "apsu/util/utils.h"
+
+using namespace std;
+using namespace apsu::util;
+using namespace apsu::receiver::util;
+
+namespace {
+    /**
+    Hash function for the cuckoo filter.
+    The seed is completely arbitrary, doesn't need to be random.
+    */
+    HashFunc hasher_(/* seed */ 20);
+} // namespace
+
+CuckooFilterArray::CuckooFilterArray(
+    size_t filter_count, size_t key_count_max, size_t bits_per_tag)
+    : filters_(filter_count, Filter{ 0, 0, 0, false })
+{
+    table_ = make_unique<CuckooFilterTable>(key_count_max, bits_per_tag, filter_count);
+}
+
+bool CuckooFilterArray::contains(size_t filter_idx, const felt_t &item) const
+{
+    size_t idx1, idx2;
+    uint32_t tag;
+
+    get_tag_and_index(item, tag, idx1);
+    idx2 = get_alt_index(idx1, tag);
+
+    const Filter &filter = filters_[filter_idx];
+    if (filter.overflow_used && filter.overflow_tag == tag) {
+        if (filter.overflow_index == idx1 || filter.overflow_index == idx2)
+            return true;
+    }
+
+    return table_->find_tag_in_buckets(
+        table_bucket(filter_idx, idx1), table_bucket(filter_idx, idx2), tag);
+}
+
+bool CuckooFilterArray::add(size_t filter_idx, const felt_t &item)
+{
+    if (filters_[filter_idx].overflow_used)
+        return false; // No more space
+
+    uint32_t tag;
+    size_t idx;
+    get_tag_and_index(item, tag, idx);
+
+    bool result = add_index_tag(filter_idx, idx, tag);
+    if (result) {
+        filters_[filter_idx].num_items++;
+    }
+
+    return result;
+}
+
+bool CuckooFilterArray::add_index_tag(size_t filter_idx, size_t idx, uint32_t tag)
+{
+    size_t curr_idx = idx;
+    uint32_t curr_tag = tag;
+    uint32_t old_tag = 0;
+
+    for (size_t i = 0; i < max_cuckoo_kicks_; i++) {
+        bool kickout = i > 0;
+        old_tag = 0;
+
+        if (table_->insert_tag(table_bucket(filter_idx, curr_idx), curr_tag, kickout, old_tag)) {
+            return true;
+        }
+
+        if (kickout) {
+            curr_tag = old_tag;
+        }
+
+        curr_idx = get_alt_index(curr_idx, curr_tag);
+    }
+
+    Filter &filter = filters_[filter_idx];
+    filter.overflow_index = curr_idx;
+    filter.overflow_tag = curr_tag;
+    filter.overflow_used = true;
+
+    return true;
+}
+
+bool CuckooFilterArray::remove(size_t filter_idx, const felt_t &item)
+{
+    size_t idx1, idx2;
+    uint32_t tag;
+
+    get_tag_and_index(item, tag, idx1);
+    idx2 = get_alt_index(idx1, tag);
+
+    Filter &filter = filters_[filter_idx];
+    if (table_->delete_tag(table_bucket(filter_idx, idx1), tag)) {
+        filter.num_items--;
+        try_eliminate_overflow(filter_idx);
+        return true;
+    }
+
+    if (table_->delete_tag(table_bucket(filter_idx, idx2), tag)) {
+        filter.num_items--;
+        try_eliminate_overflow(filter_idx);
+        return true;
+    }
+
+    if (filter.overflow_used && (filter.overflow_index == idx1 || filter.overflow_index == idx2) &&
+        filter.overflow_tag == tag) {
+        filter.overflow_used = false;
+        filter.num_items--;
+        return true;
+    }
+
+    return false;
+}
+
+uint32_t CuckooFilterArray::tag_bit_limit(uint32_t value) const
+{
+    uint32_t mask = (1 << static_cast<uint32_t>(table_->get_bits_per_tag())) - 1;
+    uint32_t tag = value & mask;
+    tag += (tag == 0);
+    return tag;
+}
+
+size_t CuckooFilterArray::idx_bucket_limit(size_t value) const
+{
+    size_t mask = table_->get_num_buckets() - 1;
+    return value & mask;
+}
+
+void CuckooFilterArray::get_tag_and_index(const felt_t &item, uint32_t &tag, size_t &idx) const
+{
+    uint64_t hash = static_cast<uint64_t>(hasher_(item));
+    idx = idx_bucket_limit(hash >> 32);
+    tag = tag_bit_limit(static_cast<uint32_t>(hash));
+}
+
+size_t CuckooFilterArray::get_alt_index(size_t idx, uint32_t tag) const
+{
+    uint64_t hash = static_cast<uint64_t>(hasher_(tag));
+    size_t idx_hash = idx_bucket_limit(hash);
+    return idx ^ idx_hash;
+}
+
+void CuckooFilterArray::try_eliminate_overflow(size_t filter_idx)
+{
+    // Try to insert the overflow item into the table.
+    Filter &filter = filters_[filter_idx];
+    if (filter.overflow_used) {
+        filter.overflow_used = false;
+        add_index_tag(filter_idx, filter.overflow_index, filter.overflow_tag);
+    }
+}
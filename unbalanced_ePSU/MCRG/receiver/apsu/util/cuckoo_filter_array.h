@@ -0,0 +1,143 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+// STL
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// APSU
+#include "apsu/util/cuckoo_filter_table.h"
+#include "apsu/util/db_encoding.h"
+
+namespace apsu {
+    namespace receiver {
+        namespace util {
+            /**
+            A fixed number of Cuckoo Filters of the same size whose tags are stored in one
+            CuckooFilterTable. Keeping the filters of all bins of a BinBundle together avoids an
+            allocation per bin and keeps neighboring filters close in memory.
+            */
+            class CuckooFilterArray {
+            public:
+                /**
+                Creates an array of no filters
+                */
+                CuckooFilterArray() = default;
+
+                /**
+                Creates filter_count empty filters, each for up to key_count_max items
+                */
+                CuckooFilterArray(
+                    std::size_t filter_count, std::size_t key_count_max, std::size_t bits_per_tag);
+
+                /**
+                Get the number of filters
+                */
+                std::size_t size() const noexcept
+                {
+                    return filters_.size();
+                }
+
+                /**
+                Indicates whether the given item is contained in the given filter
+                */
+                bool contains(std::size_t filter_idx, const apsu::util::felt_t &item) const;
+
+                /**
+                Add an item to the given filter. Will fail if there is no more space to store
+                items.
+                */
+                bool add(std::size_t filter_idx, const apsu::util::felt_t &item);
+
+                /**
+                Remove an item from the given filter.
+                */
+                bool remove(std::size_t filter_idx, const apsu::util::felt_t &item);
+
+                /**
+                Get the number of items currently contained in the given filter
+                */
+                std::size_t get_num_items(std::size_t filter_idx) const
+                {
+                    return filters_[filter_idx].num_items;
+                }
+
+            private:
+                /**
+                Maximum number of kicks before we give up trying to insert
+                */
+                constexpr static std::size_t max_cuckoo_kicks_ = 500;
+
+                /**
+                The state of one filter besides its tags
+                */
+                struct Filter {
+                    /**
+                    Number of items contained in the filter
+                    */
+                    std::size_t num_items;
+
+                    /**
+                    Bucket index and tag of the last element that we were not able to insert in
+                    the table
+                    */
+                    std::size_t overflow_index;
+
+                    std::uint32_t overflow_tag;
+
+                    bool overflow_used;
+                };
+
+                std::vector<Filter> filters_;
+
+                /**
+                Table that holds the element tags of all filters
+                */
+                std::unique_ptr<CuckooFilterTable> table_;
+
+                /**
+                Returns a tag (limited by number of bits per tag)
+                */
+                std::uint32_t tag_bit_limit(std::uint32_t value) const;
+
+                /**
+                Returns a bucket index (limited by number of buckets)
+                */
+                std::size_t idx_bucket_limit(std::size_t value) const;
+
+                /**
+                Returns the index in the table of a bucket of the given filter
+                */
+                std::size_t table_bucket(std::size_t filter_idx, std::size_t idx) const
+                {
+                    return filter_idx * table_->get_num_buckets() + idx;
+                }
+
+                /**
+                Get the tag and bucket index for a given element
+                */
+                void get_tag_and_index(
+                    const apsu::util::felt_t &item, std::uint32_t &tag, std::size_t &idx) const;
+
+                /**
+                Get the alternate index for a given tag/index combination
+                */
+                std::size_t get_alt_index(std::size_t idx, std::uint32_t tag) const;
+
+                /**
+                Add the given tag/index combination to the given filter
+                */
+                bool add_index_tag(std::size_t filter_idx, std::size_t idx, std::uint32_t tag);
+
+                /**
+                Try to eliminate the current overflow item of the given filter
+                */
+                void try_eliminate_overflow(std::size_t filter_idx);
+            };
+        } // namespace util
+    }     // namespace receiver
+} // namespace apsu
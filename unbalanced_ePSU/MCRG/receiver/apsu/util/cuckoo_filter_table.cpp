@@ -40,7 +40,7 @@ namespace {
     };
 } // namespace
 
-CuckooFilterTable::CuckooFilterTable(size_t num_items, size_t bits_per_tag)
+CuckooFilterTable::CuckooFilterTable(size_t num_items, size_t bits_per_tag, size_t table_count)
     : bits_per_tag_(bits_per_tag), tag_input_mask_(static_cast<std::uint32_t>(-1) << bits_per_tag)
 {
     num_buckets_ = next_power_of_2(std::max<uint64_t>(1, num_items / tags_per_bucket_));
@@ -53,15 +53,17 @@ CuckooFilterTable::CuckooFilterTable(size_t num_items, size_t bits_per_tag)
         num_buckets_ *= 2;
     }
 
+    total_buckets_ = num_buckets_ * table_count;
+
     // Round up to the nearest uint64_t
     size_t bits_per_bucket = tags_per_bucket_ * bits_per_tag;
-    size_t num_uint64 = (bits_per_bucket * num_buckets_ + 63) / 64;
+    size_t num_uint64 = (bits_per_bucket * total_buckets_ + 63) / 64;
     table_.resize(num_uint64);
 }
 
 uint32_t CuckooFilterTable::read_tag(size_t bucket, size_t tag_idx) const
 {
-    if (bucket >= num_buckets_) {
+    if (bucket >= total_buckets_) {
         throw invalid_argument("bucket out of range");
     }
     if (tag_idx >= tags_per_bucket_) {
@@ -87,7 +89,7 @@ uint32_t CuckooFilterTable::read_tag(size_t bucket, size_t tag_idx) const
 
 void CuckooFilterTable::write_tag(size_t bucket, size_t tag_idx, uint32_t tag)
 {
-    if (bucket >= num_buckets_) {
+    if (bucket >= total_buckets_) {
         throw invalid_argument("bucket out of range");
     }
     if (tag_idx >= tags_per_bucket_) {
@@ -134,7 +136,7 @@ bool CuckooFilterTable::insert_tag(size_t bucket, uint32_t tag, bool kickout, ui
 
 bool CuckooFilterTable::delete_tag(std::size_t bucket, std::uint32_t tag)
 {
-    if (bucket >= num_buckets_) {
+    if (bucket >= total_buckets_) {
         throw invalid_argument("bucket out of range");
     }
     if (tag & tag_input_mask_) {
@@ -153,7 +155,7 @@ bool CuckooFilterTable::delete_tag(std::size_t bucket, std::uint32_t tag)
 
 bool CuckooFilterTable::find_tag_in_bucket(std::size_t bucket, std::uint32_t tag) const
 {
-    if (bucket >= num_buckets_) {
+    if (bucket >= total_buckets_) {
         throw invalid_argument("bucket out of range");
     }
     if (tag & tag_input_mask_) {
@@ -171,10 +173,10 @@ bool CuckooFilterTable::find_tag_in_bucket(std::size_t bucket, std::uint32_t tag
 bool CuckooFilterTable::find_tag_in_buckets(
     std::size_t bucket1, std::size_t bucket2, std::uint32_t tag) const
 {
-    if (bucket1 >= num_buckets_) {
+    if (bucket1 >= total_buckets_) {
         throw invalid_argument("bucket1 out of range");
     }
-    if (bucket2 >= num_buckets_) {
+    if (bucket2 >= total_buckets_) {
         throw invalid_argument("bucket2 out of range");
     }
 
@@ -15,13 +15,18 @@ namespace apsu {
             Implementation of a Cuckoo Filter table.
             Logically the table is divided in buckets. Each bucket is capable of storing up to
             tags_per_bucket_ tags. Each tags uses bits_per_tag_ bits of storage.
+
+            The tables of several Cuckoo Filters of the same size can share one array; bucket
+            indices then run through the buckets of all tables, one table after another.
             */
             class CuckooFilterTable {
             public:
                 /**
-                Build an instance of a Cuckoo Filter Table
+                Build an instance of a Cuckoo Filter Table, or table_count tables stored one after
+                another
                 */
-                CuckooFilterTable(std::size_t num_items, std::size_t bits_per_tag);
+                CuckooFilterTable(
+                    std::size_t num_items, std::size_t bits_per_tag, std::size_t table_count = 1);
 
                 /**
                 Read the tag at the given bucket and tag index within the bucket
@@ -45,7 +50,7 @@ namespace apsu {
                 bool delete_tag(std::size_t bucket, std::uint32_t tag);
 
                 /**
-                Get the number of buckets
+                Get the number of buckets in each table
                 */
                 std::size_t get_num_buckets() const
                 {
@@ -93,9 +98,14 @@ namespace apsu {
                 std::vector<std::uint64_t> table_;
 
                 /**
-                Number of buckets in the current table
+                Number of buckets in each table
                 */
                 std::size_t num_buckets_;
+
+                /**
+                Number of buckets in all tables
+                */
+                std::size_t total_buckets_;
             };
         } // namespace util
     }     // namespace receiver
@@ -2,9 +2,14 @@
 // Licensed under the MIT license.
 
 // STD
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <future>
+#include <list>
 #include <stdexcept>
+#include <string>
 #include <thread>
 
 // APSU
@@ -25,8 +30,13 @@ namespace apsu {
     using namespace oprf;
 
     namespace receiver {
+        namespace {
+            // How long the receive loop waits for a request before it checks whether to stop
+            constexpr chrono::milliseconds stop_check_interval(50);
+        } // namespace
+
         ZMQReceiverDispatcher::ZMQReceiverDispatcher(shared_ptr<ReceiverDB> receiver_db, OPRFKey oprf_key,Receiver receiver)
-            : receiver_db_(move(receiver_db)), oprf_key_(move(oprf_key)), receiver_()
+            : receiver_db_(move(receiver_db)), oprf_key_(move(oprf_key)), receiver_(move(receiver))
         {
             
             
@@ -43,12 +53,12 @@ namespace apsu {
             }
         }
         ZMQReceiverDispatcher::ZMQReceiverDispatcher(shared_ptr<ReceiverDB> receiver_db,Receiver receiver)
-            : receiver_db_(move(receiver_db)), receiver_()
+            : receiver_db_(move(receiver_db)), receiver_(move(receiver))
         {
 #if ARBITARY == 0 
            
 #else
-            receiver_.set_item_len(receiver.get_item_len()*16);
+            receiver_.set_item_len(receiver_.get_item_len()*16);
 #endif
             if (!receiver_db_) {
                 throw invalid_argument("receiver_db is not set");
@@ -72,6 +82,16 @@ namespace apsu {
             }
         }
 
+        void ZMQReceiverDispatcher::set_max_concurrent_queries(size_t max_concurrent_queries)
+        {
+            if (!max_concurrent_queries) {
+                throw invalid_argument("max_concurrent_queries must be positive");
+            }
+
+            lock_guard<mutex> lock(query_mtx_);
+            max_concurrent_queries_ = max_concurrent_queries;
+        }
+
         void ZMQReceiverDispatcher::run(const atomic<bool> &stop, int port)
         {
             ZMQReceiverChannel chl;
@@ -84,19 +104,54 @@ namespace apsu {
          
             auto seal_context = receiver_db_->get_seal_context();
 
+            // Queries in flight; finished ones are dropped as the loop goes around
+            list<future<void>> queries;
+            uint64_t query_count = 0;
+
+            // Queries waiting for an evaluation slot, in the order they arrived. A query gets its
+            // thread only once it has a slot, so a burst of queries does not create a burst of
+            // threads.
+            deque<pair<uint64_t, unique_ptr<ZMQReceiverOperation>>> pending_queries;
+            auto start_pending_queries = [&]() {
+                lock_guard<mutex> lock(query_mtx_);
+                while (!pending_queries.empty() && active_queries_ < max_concurrent_queries_) {
+                    uint64_t query_id = pending_queries.front().first;
+                    auto rop = move(pending_queries.front().second);
+                    pending_queries.pop_front();
+                    queries.push_back(async(
+                        launch::async, [this, &chl, query_id, rop = move(rop)]() mutable {
+                            dispatch_query(move(rop), chl, query_id);
+                        }));
+                    active_queries_++;
+                }
+            };
+
             // Run until stopped
             bool logged_waiting = false;
-            while (!stop) {
+            while (!stop && (!query_limit_ || query_count < query_limit_)) {
+                queries.remove_if([](const future<void> &query) {
+                    return query.wait_for(chrono::seconds(0)) == future_status::ready;
+                });
+                start_pending_queries();
+
                 unique_ptr<ZMQReceiverOperation> rop;
-                if (!(rop = chl.receive_network_operation(seal_context))) {
+                {
+                    // Let queries send their results before taking the channel
+                    unique_lock<mutex> lock(chl_mtx_);
+                    chl_cv_.wait(lock, [this]() { return chl_waiters_ == 0; });
+
+                    // A query that wants to send interrupts the wait
+                    if (chl.poll_for_message(stop_check_interval)) {
+                        rop = chl.receive_network_operation(seal_context);
+                    }
+                }
+                if (!rop) {
                     if (!logged_waiting) {
                         // We want to log 'Waiting' only once, even if we have to wait
-                        // for several sleeps. And only once after processing a request as well.
+                        // several times. And only once after processing a request as well.
                         logged_waiting = true;
                         APSU_LOG_INFO("Waiting for request from Sender");
                     }
-                   
-                    this_thread::sleep_for(50ms);
                     continue;
                 }
 
@@ -107,12 +162,17 @@ namespace apsu {
                     dispatch_parms(move(rop), chl);
                     break;
 
-     
+                case ReceiverOperationType::rop_oprf:
+                    APSU_LOG_INFO("Received OPRF request");
+                    dispatch_oprf(move(rop), chl);
+                    break;
+
 
                 case ReceiverOperationType::rop_query:
-                    APSU_LOG_INFO("Received query");
-                    dispatch_query(move(rop), chl);
-                    return;
+                    APSU_LOG_INFO("Received query " << query_count);
+                    pending_queries.emplace_back(query_count, move(rop));
+                    start_pending_queries();
+                    query_count++;
                     break;
                 case ReceiverOperationType::rop_response:
                     APSU_LOG_INFO("Received response");
@@ -126,6 +186,34 @@ namespace apsu {
 
                 logged_waiting = false;
             }
+
+            // Queries that were received are still answered, as slots free up
+            while (!pending_queries.empty()) {
+                {
+                    unique_lock<mutex> lock(query_mtx_);
+                    query_cv_.wait(
+                        lock, [this]() { return active_queries_ < max_concurrent_queries_; });
+                }
+                start_pending_queries();
+            }
+
+            // The channel must outlive every query that still sends on it
+            for (auto &query : queries) {
+                query.get();
+            }
+        }
+
+        template <typename SendFun>
+        void ZMQReceiverDispatcher::send_on_channel(ZMQReceiverChannel &chl, SendFun &&send_fun)
+        {
+            chl_waiters_++;
+            chl.interrupt_wait();
+            {
+                lock_guard<mutex> lock(chl_mtx_);
+                chl_waiters_--;
+                send_fun();
+            }
+            chl_cv_.notify_all();
         }
 
         void ZMQReceiverDispatcher::dispatch_parms(
@@ -141,13 +229,15 @@ namespace apsu {
                     params_request,
                     receiver_db_,
                     chl,
-                    [&rop](Channel &c, unique_ptr<ReceiverOperationResponse> rop_response) {
+                    [&](Channel &c, unique_ptr<ReceiverOperationResponse> rop_response) {
                         auto nrop_response = make_unique<ZMQReceiverOperationResponse>();
                         nrop_response->rop_response = move(rop_response);
                         nrop_response->client_id = move(rop->client_id);
 
                         // We know for sure that the channel is a ReceiverChannel so use static_cast
-                        static_cast<ZMQReceiverChannel &>(c).send(move(nrop_response));
+                        auto &zmq_chl = static_cast<ZMQReceiverChannel &>(c);
+                        send_on_channel(
+                            zmq_chl, [&]() { zmq_chl.send(move(nrop_response)); });
                     });
             } catch (const exception &ex) {
                 APSU_LOG_ERROR(
@@ -155,11 +245,45 @@ namespace apsu {
             }
         }
 
-      
+        void ZMQReceiverDispatcher::dispatch_oprf(
+            unique_ptr<ZMQReceiverOperation> rop, ZMQReceiverChannel &chl)
+        {
+            STOPWATCH(recv_stopwatch, "ZMQReceiverDispatcher::dispatch_oprf");
+
+            try {
+                // Extract the OPRF request
+                OPRFRequest oprf_request = to_oprf_request(move(rop->rop));
+
+                receiver_.RunOPRF(
+                    oprf_request,
+                    oprf_key_,
+                    chl,
+                    [&](Channel &c, unique_ptr<ReceiverOperationResponse> rop_response) {
+                        auto nrop_response = make_unique<ZMQReceiverOperationResponse>();
+                        nrop_response->rop_response = move(rop_response);
+                        nrop_response->client_id = move(rop->client_id);
+
+                        // We know for sure that the channel is a ReceiverChannel so use static_cast
+                        auto &zmq_chl = static_cast<ZMQReceiverChannel &>(c);
+                        send_on_channel(
+                            zmq_chl, [&]() { zmq_chl.send(move(nrop_response)); });
+                    });
+            } catch (const exception &ex) {
+                APSU_LOG_ERROR(
+                    "Receiver threw an exception while processing OPRF request: " << ex.what());
+            }
+        }
 
         void ZMQReceiverDispatcher::dispatch_query(
-            unique_ptr<ZMQReceiverOperation> rop, ZMQReceiverChannel &chl)
+            unique_ptr<ZMQReceiverOperation> rop, ZMQReceiverChannel &chl, uint64_t query_id)
         {
+            // Queries served by one run write their masks to separate files
+            auto context = make_shared<QueryContext>();
+            context->random_matrix_file = receiver_.get_random_matrix_file();
+            if (query_limit_ != 1 && !context->random_matrix_file.empty()) {
+                context->random_matrix_file += "_" + to_string(query_id);
+            }
+
             STOPWATCH(recv_stopwatch, "ZMQReceiverDispatcher::dispatch_query");
 
             try {
@@ -169,30 +293,45 @@ namespace apsu {
                 // Query will send result to client in a stream of ResultPackages (ResultParts)
                 receiver_.RunQuery(
                     query,
+                    *context,
                     chl,
                     // Lambda function for sending the query response
-                    [&rop](Channel &c, Response response) {
+                    [&](Channel &c, Response response) {
                         auto nrop_response = make_unique<ZMQReceiverOperationResponse>();
                         nrop_response->rop_response = move(response);
                         nrop_response->client_id = rop->client_id;
 
                         // We know for sure that the channel is a ReceiverChannel so use static_cast
-                        static_cast<ZMQReceiverChannel &>(c).send(move(nrop_response));
+                        auto &zmq_chl = static_cast<ZMQReceiverChannel &>(c);
+                        send_on_channel(
+                            zmq_chl, [&]() { zmq_chl.send(move(nrop_response)); });
 
                     },
                     // Lambda function for sending the result parts
-                    [&rop](Channel &c, ResultPart rp) {
+                    [&](Channel &c, ResultPart rp) {
                         auto nrp = make_unique<ZMQResultPackage>();
                         nrp->rp = move(rp);
                         nrp->client_id = rop->client_id;
 
                         // We know for sure that the channel is a ReceiverChannel so use static_cast
-                        static_cast<ZMQReceiverChannel &>(c).send(move(nrp));
+                        auto &zmq_chl = static_cast<ZMQReceiverChannel &>(c);
+                        send_on_channel(zmq_chl, [&]() { zmq_chl.send(move(nrp)); });
                     } 
                     );
+                APSU_LOG_INFO("Finished query " << query_id);
             } catch (const exception &ex) {
                 APSU_LOG_ERROR("Receiver threw an exception while processing query: " << ex.what());
             }
+
+            {
+                lock_guard<mutex> lock(query_mtx_);
+                active_queries_--;
+                last_query_context_ = move(context);
+            }
+            query_cv_.notify_one();
+
+            // Let the receive loop start the next pending query without waiting for a request
+            chl.interrupt_wait();
         }
         void ZMQReceiverDispatcher::dispatch_re(
             unique_ptr<ZMQReceiverOperation> rop, ZMQReceiverChannel& chl)
@@ -5,7 +5,11 @@
 
 // STD
 #include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <utility>
 
 // APSU
@@ -42,17 +46,76 @@ namespace apsu {
             ZMQReceiverDispatcher(std::shared_ptr<ReceiverDB> receiver_db);
 
             /**
-            Run the dispatcher on the given port.
+            Run the dispatcher on the given port. Queries are evaluated on their own threads while
+            the dispatcher keeps receiving; run returns once stop is set or the query limit is
+            reached, and all queries in flight have finished.
             */
             void run(const std::atomic<bool> &stop, int port);
 
+            /**
+            Sets how many queries run serves before it returns; 0 serves until stopped. The
+            default is 1, so a single-shot receiver exits after answering its sender. This function
+            is thread-safe.
+            */
+            void set_query_limit(std::size_t query_limit)
+            {
+                query_limit_ = query_limit;
+            }
+
+            /**
+            Sets how many queries are evaluated at the same time; further queries are queued and
+            get a thread only when one finishes. Each query already uses the whole APSU thread
+            pool, so this bounds memory and threads rather than adding parallelism. The default
+            is 1.
+            */
+            void set_max_concurrent_queries(std::size_t max_concurrent_queries);
+
+            /**
+            Returns the QueryContext of the last query to finish, e.g., to read its mask matrix
+            after run returns.
+            */
+            std::shared_ptr<const QueryContext> get_last_query_context() const
+            {
+                return last_query_context_;
+            }
+
         private:
             std::shared_ptr<receiver::ReceiverDB> receiver_db_;
 
             oprf::OPRFKey oprf_key_;
 
             Receiver receiver_;
-            
+
+            std::shared_ptr<QueryContext> last_query_context_;
+
+            std::atomic<std::size_t> query_limit_{ 1 };
+
+            std::size_t max_concurrent_queries_ = 1;
+
+            std::size_t active_queries_ = 0;
+
+            std::mutex query_mtx_;
+
+            std::condition_variable query_cv_;
+
+            /**
+            ZeroMQ sockets are not thread-safe, so the receive loop and the query threads take
+            turns on the channel. The receive loop holds it while waiting for requests and gives
+            it up whenever a thread is waiting to send.
+            */
+            std::mutex chl_mtx_;
+
+            std::condition_variable chl_cv_;
+
+            std::atomic<std::size_t> chl_waiters_{ 0 };
+
+            /**
+            Runs send_fun with the channel locked, waking up the receive loop if it is waiting for
+            requests.
+            */
+            template <typename SendFun>
+            void send_on_channel(network::ZMQReceiverChannel &chl, SendFun &&send_fun);
+
             /**
             Dispatch a Get Parameters request to the Receiver.
             */
@@ -60,14 +123,21 @@ namespace apsu {
                 std::unique_ptr<network::ZMQReceiverOperation> rop,
                 network::ZMQReceiverChannel &channel);
 
-  
+            /**
+            Dispatch an OPRF request to the Receiver.
+            */
+            void dispatch_oprf(
+                std::unique_ptr<network::ZMQReceiverOperation> rop,
+                network::ZMQReceiverChannel &channel);
 
             /**
-            Dispatch a Query request to the Receiver.
+            Dispatch a Query request to the Receiver. The caller must have taken an evaluation
+            slot for it; the slot is released when the query finishes.
             */
             void dispatch_query(
                 std::unique_ptr<network::ZMQReceiverOperation> rop,
-                network::ZMQReceiverChannel &channel);
+                network::ZMQReceiverChannel &channel,
+                std::uint64_t query_id);
 
             void dispatch_re(
                 std::unique_ptr<network::ZMQReceiverOperation> rop,
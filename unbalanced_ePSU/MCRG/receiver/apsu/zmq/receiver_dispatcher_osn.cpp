@@ -88,16 +88,16 @@ namespace apsu {
             // Run until stopped
             bool logged_waiting = false;
             while (!stop) {
+                // Wait for a request, but come back regularly to check whether to stop
                 unique_ptr<ZMQReceiverOperation> rop;
-                if (!(rop = chl.receive_network_operation(seal_context))) {
+                if (!chl.poll_for_message(50ms) ||
+                    !(rop = chl.receive_network_operation(seal_context))) {
                     if (!logged_waiting) {
                         // We want to log 'Waiting' only once, even if we have to wait
-                        // for several sleeps. And only once after processing a request as well.
+                        // several times. And only once after processing a request as well.
                         logged_waiting = true;
                         APSU_LOG_INFO("Waiting for request from Sender");
                     }
-                   
-                    this_thread::sleep_for(50ms);
                     continue;
                 }
 
@@ -39,15 +39,29 @@ namespace apsu {
 
             unordered_map<uint32_t, SEALObject<Ciphertext>> result;
             for (auto &p : powers_) {
-                Plaintext pt;
-                crypto_context.encoder()->encode(p.second, pt);
-                result.emplace(
-                    make_pair(p.first, crypto_context.encryptor()->encrypt_symmetric(pt)));
+                result.emplace(make_pair(p.first, encrypt(p.first, crypto_context)));
             }
 
             return result;
         }
 
+        SEALObject<Ciphertext> PlaintextPowers::encrypt(
+            uint32_t power, const CryptoContext &crypto_context) const
+        {
+            if (!crypto_context.encryptor()) {
+                throw invalid_argument("encryptor is not set in crypto_context");
+            }
+
+            auto power_it = powers_.find(power);
+            if (power_it == powers_.end()) {
+                throw invalid_argument("power is not a source power");
+            }
+
+            Plaintext pt;
+            crypto_context.encoder()->encode(power_it->second, pt);
+            return crypto_context.encryptor()->encrypt_symmetric(pt);
+        }
+
         void PlaintextPowers::square_array(gsl::span<uint64_t> in) const
         {
             transform(in.begin(), in.end(), in.begin(), [this](auto val) {
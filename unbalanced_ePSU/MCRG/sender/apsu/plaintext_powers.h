@@ -25,12 +25,21 @@ namespace apsu {
     namespace sender {
         class PlaintextPowers {
         public:
+            PlaintextPowers() = default;
+
             PlaintextPowers(
                 std::vector<std::uint64_t> values, const PSUParams &params, const PowersDag &pd);
 
             std::unordered_map<std::uint32_t, SEALObject<seal::Ciphertext>> encrypt(
                 const CryptoContext &crypto_context);
 
+            /**
+            Encodes and encrypts a single source power. Different powers can be encrypted
+            concurrently.
+            */
+            SEALObject<seal::Ciphertext> encrypt(
+                std::uint32_t power, const CryptoContext &crypto_context) const;
+
         private:
             seal::Modulus mod_;
 
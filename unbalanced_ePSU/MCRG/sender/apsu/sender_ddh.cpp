@@ -53,27 +53,6 @@ namespace apsu {
         {
             return all_of(ptr, ptr + count, [](auto a) { return a == T(0); });
         }
-        inline oc::block vec_to_oc_block(const std::vector<uint64_t> &in,size_t felts_per_item,uint64_t plain_modulus){
-            uint32_t plain_modulus_len = 1;
-            while(((1<<plain_modulus_len)-1)<plain_modulus){
-                plain_modulus_len++;
-            }
-            uint64_t plain_modulus_mask = (1<<plain_modulus_len)-1;
-            uint64_t plain_modulus_mask_lower = (1<<(plain_modulus_len>>1))-1;
-            uint64_t plain_modulus_mask_higher = plain_modulus_mask-plain_modulus_mask_lower;
-
-            uint64_t lower=0,higher=0;
-            if(felts_per_item&1){
-                lower = (in[felts_per_item-1] & plain_modulus_mask_lower);
-                higher = ((in[felts_per_item-1] & plain_modulus_mask_higher) >>((plain_modulus_len>>1)-1));
-            }
-            for(int pla = 0;pla < felts_per_item;pla+=2){
-                lower = ((in[pla] & plain_modulus_mask) | (lower<<plain_modulus_len));
-                higher = ((in[pla+1] & plain_modulus_mask) | (higher<<plain_modulus_len));
-            }
-            return oc::toBlock(higher,lower);
-        }
-
         // inline block vec_to_std_block(const std::vector<uint64_t> &in,size_t felts_per_item,uint64_t plain_modulus){
         //     uint32_t plain_modulus_len = 1;
         //     while(((1<<plain_modulus_len)-1)<plain_modulus){
@@ -100,11 +79,6 @@ namespace apsu {
         // }
 
         // #define block_oc_to_std(a) (Block::MakeBlock((oc::block)a.as<uint64_t>()[1],(oc::block)a.as<uint64_t>()[0]))
-        std::vector<oc::block> decrypt_randoms_matrix;
-
-
-        
-    
     } // namespace
 
     namespace sender {
@@ -185,8 +159,6 @@ namespace apsu {
 
             // init send Messages
             // sendMessages.clear();
-            cuckoo_item.clear();
-
         }
 
         unique_ptr<ReceiverOperation> Sender::CreateParamsRequest()
@@ -205,32 +177,119 @@ namespace apsu {
             // Wait for a valid message of the right type
 
             
+            // receive_response blocks until a message arrives and returns nullptr only if it is
+            // not the expected response, so there is no reason to sleep between attempts
             ParamsResponse response;
             bool logged_waiting = false;
             while (!(response = to_params_response(chl.receive_response()))) {
                 if (!logged_waiting) {
-                    // We want to log 'Waiting' only once, even if we have to wait for several
-                    // sleeps.
+                    // We want to log 'Waiting' only once, even if we have to receive several
+                    // messages.
                     logged_waiting = true;
                     APSU_LOG_INFO("Waiting for response to parameter request");
                 }
-
-                this_thread::sleep_for(50ms);
             }
 
             return *response->params;
         }
 
-// oprf has been removed
+        OPRFReceiver Sender::CreateOPRFReceiver(const vector<Item> &items)
+        {
+            STOPWATCH(sender_stopwatch, "Sender::CreateOPRFReceiver");
+
+            OPRFReceiver oprf_receiver(items);
+            APSU_LOG_INFO("Created OPRFReceiver for " << oprf_receiver.item_count() << " items");
+
+            return oprf_receiver;
+        }
+
+        unique_ptr<ReceiverOperation> Sender::CreateOPRFRequest(const OPRFReceiver &oprf_receiver)
+        {
+            auto rop = make_unique<ReceiverOperationOPRF>();
+            rop->data = oprf_receiver.query_data();
+            APSU_LOG_INFO("Created OPRF request for " << oprf_receiver.item_count() << " items");
+
+            return rop;
+        }
+
+        pair<vector<HashedItem>, vector<LabelKey>> Sender::ExtractHashes(
+            const OPRFResponse &oprf_response, const OPRFReceiver &oprf_receiver)
+        {
+            STOPWATCH(sender_stopwatch, "Sender::ExtractHashes");
+
+            if (!oprf_response) {
+                APSU_LOG_ERROR("Failed to extract OPRF hashes for items: oprf_response is null");
+                return {};
+            }
+
+            auto response_size = oprf_response->data.size();
+            size_t oprf_response_item_count = response_size / oprf_response_size;
+            if ((response_size % oprf_response_size) ||
+                (oprf_response_item_count != oprf_receiver.item_count())) {
+                APSU_LOG_ERROR(
+                    "Failed to extract OPRF hashes for items: unexpected OPRF response size ("
+                    << response_size << " B)");
+                return {};
+            }
+
+            vector<HashedItem> items(oprf_receiver.item_count());
+            vector<LabelKey> label_keys(oprf_receiver.item_count());
+            oprf_receiver.process_responses(oprf_response->data, items, label_keys);
+            APSU_LOG_INFO("Extracted OPRF hashes for " << oprf_response_item_count << " items");
+
+            return make_pair(move(items), move(label_keys));
+        }
+
+        pair<vector<HashedItem>, vector<LabelKey>> Sender::RequestOPRF(
+            const vector<Item> &items, NetworkChannel &chl)
+        {
+            auto oprf_receiver = CreateOPRFReceiver(items);
+
+            // Create OPRF request and send to Receiver
+            chl.send(CreateOPRFRequest(oprf_receiver));
+
+            // Wait for a valid message of the right type; receive_response blocks, as above
+            OPRFResponse response;
+            bool logged_waiting = false;
+            while (!(response = to_oprf_response(chl.receive_response()))) {
+                if (!logged_waiting) {
+                    // We want to log 'Waiting' only once, even if we have to receive several
+                    // messages.
+                    logged_waiting = true;
+                    APSU_LOG_INFO("Waiting for response to OPRF request");
+                }
+            }
+
+            // Extract the OPRF hashed items
+            return ExtractHashes(response, oprf_receiver);
+        }
 
         pair<Request, IndexTranslationTable> Sender::create_query(
             const vector<HashedItem> &items,
             const std::vector<string> &origin_item,
-            coproto::AsioSocket SenderKKRTSocket)
+            coproto::AsioSocket SenderKKRTSocket,
+            QueryContext &context)
+        {
+            return create_query(items, origin_item, &SenderKKRTSocket, context);
+        }
+
+        pair<Request, IndexTranslationTable> Sender::create_query(
+            const vector<HashedItem> &items,
+            const std::vector<string> &origin_item,
+            QueryContext &context)
+        {
+            return create_query(items, origin_item, nullptr, context);
+        }
+
+        pair<Request, IndexTranslationTable> Sender::create_query(
+            const vector<HashedItem> &items,
+            const std::vector<string> &origin_item,
+            coproto::AsioSocket *kkrt_socket,
+            QueryContext &context)
         {
             APSU_LOG_INFO("Creating encrypted query for " << items.size() << " items");
             STOPWATCH(sender_stopwatch, "Sender::create_query");
-            all_timer.setTimePoint("create_query");
+            context.all_timer.setTimePoint("create_query");
             IndexTranslationTable itt;
             itt.item_count_ = items.size();
 
@@ -282,8 +341,7 @@ namespace apsu {
             }
 
 
-            cuckoo_item.resize(cuckoo.table_size());
-            shuffle_item.resize(cuckoo.table_size());
+            context.cuckoo_item.assign(cuckoo.table_size(), oc::ZeroBlock);
 
             // Once the table is filled, fill the table_idx_to_item_idx map
             for (size_t item_idx = 0; item_idx < items.size(); item_idx++) {
@@ -291,17 +349,19 @@ namespace apsu {
                 auto temp_loc = item_loc.location();
                 itt.table_idx_to_item_idx_[temp_loc] = item_idx;
                 // sendMessages[temp_loc]={oc::toBlock((uint8_t*)origin_item[item_idx].data()),oc::ZeroBlock};
-                cuckoo_item[temp_loc] = oc::toBlock((uint8_t*)origin_item[item_idx].data());
+                context.cuckoo_item[temp_loc] = oc::toBlock((uint8_t*)origin_item[item_idx].data());
             }
 
-            // Set up unencrypted query data
-            vector<PlaintextPowers> plain_powers;
-            auto receiver_data = oprf_receiver(cuckoo.table(),SenderKKRTSocket);
+            // Set up unencrypted query data. Against a ReceiverDB in offline OPRF mode the table
+            // already holds OPRF outputs; otherwise every bin is encoded with the KKRT OPRF.
+            ThreadPoolMgr tpm;
+            vector<PlaintextPowers> plain_powers(params_.bundle_idx_count());
+            auto receiver_data =
+                kkrt_socket ? oprf_receiver(cuckoo.table(), *kkrt_socket) : cuckoo.table();
             // prepare_data
             {
                 STOPWATCH(sender_stopwatch, "Sender::create_query::prepare_data");
-                for (uint32_t bundle_idx = 0; bundle_idx < params_.bundle_idx_count();
-                     bundle_idx++) {
+                tpm.thread_pool().parallel_for(plain_powers.size(), [&](size_t bundle_idx) {
                     APSU_LOG_DEBUG("Preparing data for bundle index " << bundle_idx);
 
                     // First, find the items for this bundle index
@@ -309,49 +369,56 @@ namespace apsu {
                         receiver_data.data() + bundle_idx * params_.items_per_bundle(),
                         params_.items_per_bundle());
 
-                    vector<uint64_t> alg_items;
-                    for (auto &item : bundle_items) {
-                        // Now set up a BitstringView to this item
-                        gsl::span<const unsigned char> item_bytes(
-                            reinterpret_cast<const unsigned char *>(item.data()), sizeof(item));
-                        BitstringView<const unsigned char> item_bits(
-                            item_bytes, params_.item_bit_count());
-
-                        // Create an algebraic item by breaking up the item into modulo
-                        // plain_modulus parts
-                        vector<uint64_t> alg_item =
-                            bits_to_field_elts(item_bits, params_.seal_params().plain_modulus());
-                        copy(alg_item.cbegin(), alg_item.cend(), back_inserter(alg_items));
-                    }
+                    // Create the algebraic items by breaking up every item into modulo
+                    // plain_modulus parts
+                    gsl::span<const unsigned char> bundle_bytes(
+                        reinterpret_cast<const unsigned char *>(bundle_items.data()),
+                        bundle_items.size() * sizeof(item_type));
+                    vector<uint64_t> alg_items(
+                        bundle_items.size() * params_.item_params().felts_per_item);
+                    bits_to_field_elts(
+                        bundle_bytes,
+                        params_.item_bit_count(),
+                        params_.seal_params().plain_modulus(),
+                        alg_items);
 
                     // Now that we have the algebraized items for this bundle index, we create a
                     // PlaintextPowers object that computes all necessary powers of the algebraized
                     // items.
-                    plain_powers.emplace_back(move(alg_items), params_, pd_);
-                }
-                
-
+                    plain_powers[bundle_idx] = PlaintextPowers(move(alg_items), params_, pd_);
+                });
             }
 
-            // The very last thing to do is encrypt the plain_powers and consolidate the matching
-            // powers for different bundle indices
+            // The very last thing to do is encrypt the plain_powers. The matching powers for
+            // different bundle indices go to the same vector, so every slot is created up front
+            // and each (bundle index, power) pair is then encrypted straight into its own slot.
             unordered_map<uint32_t, vector<SEALObject<Ciphertext>>> encrypted_powers;
+            vector<uint32_t> source_powers;
+            vector<vector<SEALObject<Ciphertext>> *> power_ciphertexts;
+            for (auto &s : pd_.source_nodes()) {
+                auto &ciphertexts = encrypted_powers[s.power];
+                ciphertexts.resize(plain_powers.size());
+                source_powers.push_back(s.power);
+                power_ciphertexts.push_back(&ciphertexts);
+            }
 
             // encrypt_data
             {
                 STOPWATCH(sender_stopwatch, "Sender::create_query::encrypt_data");
-                for (uint32_t bundle_idx = 0; bundle_idx < params_.bundle_idx_count();
-                     bundle_idx++) {
-                    APSU_LOG_DEBUG("Encoding and encrypting data for bundle index " << bundle_idx);
-
-                    // Encrypt the data for this power
-                    auto encrypted_power(plain_powers[bundle_idx].encrypt(crypto_context_));
-
-                    // Move the encrypted data to encrypted_powers
-                    for (auto &e : encrypted_power) {
-                        encrypted_powers[e.first].emplace_back(move(e.second));
-                    }
-                }
+                size_t power_count = source_powers.size();
+                tpm.thread_pool().parallel_for(
+                    plain_powers.size() * power_count, [&](size_t pair_idx) {
+                        size_t bundle_idx = pair_idx / power_count;
+                        size_t power_idx = pair_idx % power_count;
+                        APSU_LOG_DEBUG(
+                            "Encoding and encrypting power " << source_powers[power_idx]
+                                                             << " for bundle index "
+                                                             << bundle_idx);
+
+                        (*power_ciphertexts[power_idx])[bundle_idx] =
+                            plain_powers[bundle_idx].encrypt(
+                                source_powers[power_idx], crypto_context_);
+                    });
             }
 
             // Set up the return value
@@ -362,7 +429,7 @@ namespace apsu {
             auto rop = to_request(move(rop_query));
 
             APSU_LOG_INFO("Finished creating encrypted query");
-            all_timer.setTimePoint("create_query finish");
+            context.all_timer.setTimePoint("create_query finish");
             return { move(rop), itt };
         }
 
@@ -370,36 +437,50 @@ namespace apsu {
             const vector<HashedItem> &items,
             NetworkChannel &chl,
             const vector<string> &origin_item,
-            coproto::AsioSocket SenderChl
+            coproto::AsioSocket SenderChl,
+            QueryContext &context
             )
+        {
+            request_query(create_query(items, origin_item, SenderChl, context), chl, context);
+        }
+
+        void Sender::request_query(
+            const vector<HashedItem> &items,
+            NetworkChannel &chl,
+            const vector<string> &origin_item,
+            QueryContext &context)
+        {
+            request_query(create_query(items, origin_item, context), chl, context);
+        }
+
+        void Sender::request_query(
+            pair<Request, IndexTranslationTable> query, NetworkChannel &chl, QueryContext &context)
         {
             ThreadPoolMgr tpm;
+            oc::Timer &all_timer = context.all_timer;
 
-            // Create query and send to Sender
-            auto query = create_query(items,origin_item,SenderChl);
+            // Send the query to the Receiver
             chl.send(move(query.first));
-            auto itt = move(query.second);
             all_timer.setTimePoint("with response start");
 
-            // Wait for query response
+            // Wait for query response; receive_response blocks, as above
             QueryResponse response;
             bool logged_waiting = false;
             while (!(response = to_query_response(chl.receive_response()))) {
                 if (!logged_waiting) {
-                    // We want to log 'Waiting' only once, even if we have to wait for several
-                    // sleeps.
+                    // We want to log 'Waiting' only once, even if we have to receive several
+                    // messages.
                     logged_waiting = true;
                     APSU_LOG_INFO("Waiting for response to query request");
                 }
-
-                this_thread::sleep_for(50ms);
             }
             all_timer.setTimePoint("with response finish");
 
             uint32_t bundle_idx_count = safe_cast<uint32_t>(params_.bundle_idx_count()); 
             uint32_t items_per_bundle = safe_cast<uint32_t>(params_.items_per_bundle());
             size_t felts_per_item = safe_cast<size_t>(params_.item_params().felts_per_item);
-            uint64_t item_cnt = bundle_idx_count* items_per_bundle; 
+            uint64_t &item_cnt = context.item_cnt;
+            item_cnt = bundle_idx_count* items_per_bundle; 
 
         //       int block_num = ((felts_per_item+3)/4);
 
@@ -410,9 +491,10 @@ namespace apsu {
 
             // prepare decrypt randoms matrix size for copy
 
-            uint64_t alpha_max_cache_count = response->alpha_max_cache_count;
+            uint64_t &alpha_max_cache_count = context.alpha_max_cache_count;
+            alpha_max_cache_count = response->alpha_max_cache_count;
             // decrypt_randoms_matrix.assign(alpha_max_cache_count * item_cnt,Block::zero_block);
-            decrypt_randoms_matrix.resize(alpha_max_cache_count * item_cnt);
+            context.decrypt_randoms_matrix.resize(alpha_max_cache_count * item_cnt);
             
             
             // Launch threads to receive ResultPackages and decrypt results
@@ -423,28 +505,30 @@ namespace apsu {
                              << " result parts");
             for (size_t t = 0; t < task_count; t++) {
                 futures[t] = tpm.thread_pool().enqueue(
-                    [&]() { process_result_worker(package_count, itt, chl); });
+                    [&]() { process_result_worker(package_count, context, chl); });
             }
 
             for (auto &f : futures) {
                 f.get();
             }
 
-            std::string outFileName = "./randomM/sender_cuckoo";
+            if (!random_matrix_file.empty()) {
+                std::ofstream outFile;
+                outFile.open(random_matrix_file, std::ios::binary | std::ios::out);
+                if (!outFile.is_open()){
+                    std::cout << "Vole error opening file " << random_matrix_file << std::endl;
+                    return;
+                }
 
-            std::ofstream outFile;
-            outFile.open(outFileName, std::ios::binary | std::ios::out);
-            if (!outFile.is_open()){
-                std::cout << "Vole error opening file " << outFileName << std::endl;
-                return;
+                uint64_t mask_bit_count = params_.item_params().mask_bit_count;
+                outFile.write((char*)(&item_cnt), sizeof(uint64_t));
+                outFile.write((char*)(&alpha_max_cache_count), sizeof(uint64_t));
+                outFile.write((char*)(&mask_bit_count), sizeof(uint64_t));
+                outFile.write((char*)context.decrypt_randoms_matrix.data(), sizeof(uint64_t)*(context.decrypt_randoms_matrix.size()));
+                outFile.write((char*)context.cuckoo_item.data(), sizeof(oc::block)*(context.cuckoo_item.size()));
+                outFile.close();
             }
 
-            outFile.write((char*)(&item_cnt), sizeof(uint64_t));
-            outFile.write((char*)(&alpha_max_cache_count), sizeof(uint64_t));
-            outFile.write((char*)decrypt_randoms_matrix.data(), sizeof(oc::block)*(decrypt_randoms_matrix.size()));
-            outFile.write((char*)cuckoo_item.data(), sizeof(oc::block)*(cuckoo_item.size()));
-            outFile.close();
-
             // // pm-PEQT 
             // NetIO client("client", "127.0.0.1", 59999);
             // auto permutation = peqt::ddh_peqt_sender(client,decrypt_randoms_matrix,alpha_max_cache_count,item_cnt);
@@ -464,11 +548,7 @@ namespace apsu {
             all_timer.setTimePoint("decrypt and unpermute finish");
         }
 
-        void Sender::process_result_part(
-        
-            const IndexTranslationTable &itt,
-            const ResultPart &result_part,
-            network::NetworkChannel &chl) const
+        void Sender::process_result_part(QueryContext &context, const ResultPart &result_part) const
         {
             STOPWATCH(sender_stopwatch, "Sender::process_result_part");
 
@@ -477,35 +557,29 @@ namespace apsu {
                 return ;
             }
 
-            // The number of items that were submitted in the query
-            size_t item_count = itt.item_count();
-            
             // Decrypt and decode the result; the result vector will have full batch size
             PlainResultPackage plain_rp = result_part->extract(crypto_context_);
             uint32_t items_per_bundle = safe_cast<uint32_t>(params_.items_per_bundle());
+            uint32_t bundle_idx_count = safe_cast<uint32_t>(params_.bundle_idx_count());
             size_t felts_per_item = safe_cast<size_t>(params_.item_params().felts_per_item);
-            vector<oc::block> decrypt_res(items_per_bundle);
-            uint64_t plain_modulus=crypto_context_.seal_context()->last_context_data()->parms().plain_modulus().value();
+            uint32_t mask_bit_count = params_.item_params().mask_bit_count;
+            const Modulus &plain_modulus = params_.seal_params().plain_modulus();
+
+            // Masks of cache c at bundle index b go to row c, columns b * items_per_bundle onwards
+            size_t cache_idx = result_part->cache_idx;
+            size_t bundle_idx = result_part->bundle_idx;
+            auto decrypt_res = context.decrypt_randoms_matrix.begin() +
+                               (cache_idx * bundle_idx_count + bundle_idx) * items_per_bundle;
             for(uint32_t item_idx=0;item_idx<items_per_bundle;item_idx++){
-                vector<uint64_t> all_felts_one_item(felts_per_item,0);
-                for(size_t felts_idx = 0;felts_idx<felts_per_item;felts_idx++){
-                    all_felts_one_item[felts_idx] = plain_rp.psu_result[item_idx*felts_per_item+felts_idx];
-                }
-                decrypt_res[item_idx]= vec_to_oc_block(all_felts_one_item,felts_per_item,plain_modulus);
+                gsl::span<const felt_t> item_felts(
+                    plain_rp.psu_result.data() + item_idx * felts_per_item, felts_per_item);
+                decrypt_res[item_idx] = field_elts_to_mask(item_felts, mask_bit_count, plain_modulus);
             }
-            uint32_t cache_idx = result_part->cache_idx;
-            copy(
-                decrypt_res.begin(),
-                decrypt_res.end(),
-                decrypt_randoms_matrix.begin()+(cache_idx*item_count+cache_idx*items_per_bundle)
-            );
-        
-           
         }
 
         void Sender::process_result_worker(
             atomic<uint32_t> &package_count,
-            const IndexTranslationTable &itt,
+            QueryContext &context,
             NetworkChannel &chl)
         {
             stringstream sw_ss;
@@ -537,36 +611,7 @@ namespace apsu {
                 while (!(result_part = chl.receive_result(seal_context)))
                     ;
                 
-            // Decrypt and decode the result; the result vector will have full batch size
-                     
-                    PlainResultPackage plain_rp = result_part->extract(crypto_context_);
-                    uint32_t items_per_bundle = safe_cast<uint32_t>(params_.items_per_bundle());
-                    uint32_t bundle_idx_count = safe_cast<uint32_t>(params_.bundle_idx_count());
-                    size_t felts_per_item = safe_cast<size_t>(params_.item_params().felts_per_item);
-                    vector<oc::block> decrypt_res(items_per_bundle);
-                    uint64_t plain_modulus=crypto_context_.seal_context()->last_context_data()->parms().plain_modulus().value();
-                    // for(int i =0 ;i<plain_rp.psu_result.size();i++){
-                    //     plain_rp.psu_result[i] = 124u;
-                    // }
-                  
-                    for(uint32_t item_idx=0;item_idx<items_per_bundle;item_idx++){
-                        vector<uint64_t> all_felts_one_item(felts_per_item,0);
-                        for(size_t felts_idx = 0;felts_idx<felts_per_item;felts_idx++){
-                            all_felts_one_item[felts_idx] = plain_rp.psu_result[item_idx*felts_per_item+felts_idx];
-                        }
-                        decrypt_res[item_idx]= vec_to_oc_block(all_felts_one_item,felts_per_item,plain_modulus);
-                    }
-                    uint32_t cache_idx = result_part->cache_idx;
-                    uint32_t bundle_idx = result_part->bundle_idx;
-                    cout << decrypt_randoms_matrix.size() << std::endl;
-                    cout << (cache_idx*items_per_bundle*bundle_idx_count+bundle_idx*items_per_bundle) << std::endl;
-                    copy(
-                        decrypt_res.begin(),
-                        decrypt_res.end(),
-                        decrypt_randoms_matrix.begin()+(cache_idx*items_per_bundle*bundle_idx_count+bundle_idx*items_per_bundle)
-                    );
-                   decrypt_res.clear();
-
+                process_result_part(context, result_part);
             }
         }
 
@@ -68,6 +68,28 @@ With modifications:
 
 namespace apsu {
     namespace sender {
+        /**
+        The state of one query: the cuckoo table of the query, the decrypted masks, the shape of
+        the mask matrix, and its timings. The caller owns it and passes it to Sender::request_query.
+        */
+        struct QueryContext {
+            std::uint64_t item_cnt = 0;
+
+            std::uint64_t alpha_max_cache_count = 0;
+
+            /**
+            alpha_max_cache_count rows of item_cnt decrypted masks.
+            */
+            std::vector<std::uint64_t> decrypt_randoms_matrix;
+
+            /**
+            The cuckoo table of the query; empty bins hold the zero block.
+            */
+            std::vector<oc::block> cuckoo_item;
+
+            oc::Timer all_timer;
+        }; // struct QueryContext
+
         /**
         The Receiver class implements all necessary functions to create and send parameter, OPRF,
         and PSU or labeled PSU queries (depending on the sender), and process any responses
@@ -176,21 +198,69 @@ namespace apsu {
             */
             static PSUParams RequestParams(network::NetworkChannel &chl);
 
+            /**
+            Performs an OPRF request on a vector of items through a given channel and returns a
+            vector of OPRF hashed items of the same size as the input vector. This is needed only
+            when the receiver serves a ReceiverDB in offline OPRF mode.
+            */
+            static std::pair<std::vector<HashedItem>, std::vector<LabelKey>> RequestOPRF(
+                const std::vector<Item> &items, network::NetworkChannel &chl);
+
+            /**
+            Sets the file request_query writes the decrypted masks and the cuckoo table to. An
+            empty name keeps them in memory only, in the QueryContext of the query.
+            */
+            void set_random_matrix_file(std::string file)
+            {
+                random_matrix_file = std::move(file);
+            }
 
-        
+            /**
+            Performs a query; its decrypted masks and cuckoo table are left in the given
+            QueryContext.
+            */
             void request_query(
                 const std::vector<HashedItem> &items,
                 network::NetworkChannel &chl,
                 const std::vector<std::string> &origin_item,
-                coproto::AsioSocket SenderKKRTSocket
+                coproto::AsioSocket SenderKKRTSocket,
+                QueryContext &context
                 );
 
+            /**
+            Performs a query against a ReceiverDB in offline OPRF mode. The items must be the OPRF
+            hashes returned by Sender::RequestOPRF, so no KKRT OPRF is run.
+            */
+            void request_query(
+                const std::vector<HashedItem> &items,
+                network::NetworkChannel &chl,
+                const std::vector<std::string> &origin_item,
+                QueryContext &context);
+
             /**
             Creates and returns a parameter request that can be sent to the sender with the
             Receiver::SendRequest function.
             */
             static Request CreateParamsRequest();
 
+            /**
+            Creates and returns an oprf::OPRFReceiver object for the given items.
+            */
+            static oprf::OPRFReceiver CreateOPRFReceiver(const std::vector<Item> &items);
+
+            /**
+            Creates an OPRF request that can be sent to the receiver with the
+            network::Channel::send function.
+            */
+            static Request CreateOPRFRequest(const oprf::OPRFReceiver &oprf_receiver);
+
+            /**
+            Extracts a vector of OPRF hashed items from an OPRFResponse and the corresponding
+            oprf::OPRFReceiver.
+            */
+            static std::pair<std::vector<HashedItem>, std::vector<LabelKey>> ExtractHashes(
+                const OPRFResponse &oprf_response, const oprf::OPRFReceiver &oprf_receiver);
+
 
             /**
             Creates a Query object from a vector of OPRF hashed items. The query contains the query
@@ -202,20 +272,24 @@ namespace apsu {
             std::pair<Request, IndexTranslationTable> create_query(
                 const std::vector<HashedItem> &items,
                 const std::vector<std::string> &origin_item,
-                coproto::AsioSocket SenderKKRTSocket);
+                coproto::AsioSocket SenderKKRTSocket,
+                QueryContext &context);
 
             /**
-            Processes a ResultPart object and returns a vector of MatchRecords in the same order as
-            the original vector of OPRF hashed items used to create the query. The return value
-            includes matches only for those items whose results happened to be in this particular
-            result part. Thus, to determine whether there was a match with the sender's data, the
-            results for each received ResultPart must be checked.
+            Creates a Query object from a vector of OPRF hashed items obtained from
+            Sender::RequestOPRF. The cuckoo table is encrypted as is, without the KKRT OPRF.
             */
-            void process_result_part(
-                
-                const IndexTranslationTable &itt,
-                const ResultPart &result_part,
-                network::NetworkChannel &chl) const;
+            std::pair<Request, IndexTranslationTable> create_query(
+                const std::vector<HashedItem> &items,
+                const std::vector<std::string> &origin_item,
+                QueryContext &context);
+
+            /**
+            Decrypts a ResultPart object and stores its masks in the decrypted mask matrix of the
+            given QueryContext, at the row of its cache index and the columns of its bundle index.
+            Different result parts write disjoint ranges, so they can be processed concurrently.
+            */
+            void process_result_part(QueryContext &context, const ResultPart &result_part) const;
 
             /**
             This function does multiple calls to Receiver::process_result_part, once for each
@@ -246,9 +320,27 @@ namespace apsu {
             */
             std::uint32_t reset_powers_dag(const std::set<std::uint32_t> &source_powers);
 
+            /**
+            Creates the query; the cuckoo table is encoded with the KKRT OPRF over kkrt_socket,
+            unless it is null and the items are already OPRF hashed.
+            */
+            std::pair<Request, IndexTranslationTable> create_query(
+                const std::vector<HashedItem> &items,
+                const std::vector<std::string> &origin_item,
+                coproto::AsioSocket *kkrt_socket,
+                QueryContext &context);
+
+            /**
+            Sends the query and receives and decrypts its results.
+            */
+            void request_query(
+                std::pair<Request, IndexTranslationTable> query,
+                network::NetworkChannel &chl,
+                QueryContext &context);
+
             void process_result_worker(
                 std::atomic<std::uint32_t> &package_count,
-                const IndexTranslationTable &itt,
+                QueryContext &context,
                 network::NetworkChannel &chl);
 
             void initialize();
@@ -266,10 +358,8 @@ namespace apsu {
 
             SEALObject<seal::RelinKeys> relin_keys_;
 
-            oc::Timer all_timer;
             oc::PRNG prng;
-            std::vector<oc::block> cuckoo_item;
-            std::vector<oc::block> shuffle_item;
+            std::string random_matrix_file = "./randomM/sender_cuckoo";
 
 // #if ARBITARY == 0 
 //            std::vector<std::array<oc::block, 2>> sendMessages;
@@ -1,12 +1,67 @@
 #include "pECRG_nECRG_OTP.h"
 
-void pECRG_nECRG_OTP(u32 isSender, u32 numThreads)
+void pECRG_nECRG_OTP_Send(Socket &chl, const std::vector<u64> &decryptRandoms, const std::vector<block> &cuckooItem, u64 itemCnt, u64 alphaMaxCacheCount, u64 maskBitCount, u32 numThreads, const RotConfig &rotConfig)
+{
+    std::vector<block> decrypt_randoms_matrix(decryptRandoms.size());
+    for(int i = 0; i < decrypt_randoms_matrix.size(); i++){
+        decrypt_randoms_matrix[i] = block(0, decryptRandoms[i]);
+    }
+
+    std::vector<uint32_t> pi;
+    std::vector<block> pnECRG_out;
+    pnECRG(1, chl, decrypt_randoms_matrix, itemCnt, alphaMaxCacheCount, pi, pnECRG_out, numThreads, maskBitCount, rotConfig);
+
+
+    // shuffle cuckoo table and XOR pnECRG_out
+    // one time padding
+    std::vector<block> shuffle_item(itemCnt);
+    for(int i = 0; i < itemCnt; i++){
+        if(cuckooItem[pi[i]] == block(0,0)){
+            shuffle_item[i] = pnECRG_out[i];
+        }
+        else{
+            shuffle_item[i] = oc::block(cuckooItem[pi[i]].mData[0], 1) ^ pnECRG_out[i];
+        }
+
+    }
+    coproto::sync_wait(chl.send(shuffle_item));
+}
+
+std::vector<u64> pECRG_nECRG_OTP_Recv(Socket &chl, const std::vector<u64> &randoms, u64 itemCnt, u64 alphaMaxCacheCount, u64 maskBitCount, u32 numThreads, const RotConfig &rotConfig)
+{
+    std::vector<block> random_matrix(randoms.size());
+    for(int i = 0; i < random_matrix.size(); i++){
+        random_matrix[i] = block(0, randoms[i]);
+    }
+
+
+    std::vector<uint32_t> pi;  // useless
+    std::vector<block> pnECRG_out;
+    pnECRG(0, chl, random_matrix, itemCnt, alphaMaxCacheCount, pi, pnECRG_out, numThreads, maskBitCount, rotConfig);
+
+    std::vector<oc::block> shuffle_item(itemCnt);
+    coproto::sync_wait(chl.recv(shuffle_item));
+
+
+    // cause the receiver knows its input set, here we only need to know all the items in X/Y.
+    std::vector<u64> union_sub_receiver;
+    for(auto i = 0; i < itemCnt; ++i){
+        auto tmp_block = pnECRG_out[i] ^ shuffle_item[i];
+        if(tmp_block.mData[0] == 1){
+            union_sub_receiver.push_back(tmp_block.mData[1]);
+        }
+    }
+    return union_sub_receiver;
+}
+
+void pECRG_nECRG_OTP(u32 isSender, u32 numThreads, const RotConfig &rotConfig)
 {
     u64 item_cnt;
     u64 alpha_max_cache_count;
+    u64 mask_bit_count;
     std::ifstream randomMFile;
     Timer timer;
-    timer.setTimePoint("start");  
+    timer.setTimePoint("start");
 
     Socket chl;
     chl = coproto::asioConnect("localhost:" + std::to_string(1212 + 101), isSender);
@@ -21,38 +76,18 @@ void pECRG_nECRG_OTP(u32 isSender, u32 numThreads)
         }
         randomMFile.read((char*)(&item_cnt), sizeof(uint64_t));
         randomMFile.read((char*)(&alpha_max_cache_count), sizeof(uint64_t));
-        std::vector<block> decrypt_randoms_matrix(item_cnt * alpha_max_cache_count);
+        randomMFile.read((char*)(&mask_bit_count), sizeof(uint64_t));
+        std::vector<u64> decrypt_randoms(item_cnt * alpha_max_cache_count);
         std::vector<block> cuckoo_item(item_cnt);
 
-        randomMFile.read((char*)decrypt_randoms_matrix.data(), sizeof(block) * decrypt_randoms_matrix.size());
+        randomMFile.read((char*)decrypt_randoms.data(), sizeof(u64) * decrypt_randoms.size());
         randomMFile.read((char*)cuckoo_item.data(), sizeof(block) * cuckoo_item.size());
         randomMFile.close();
 
-        for(int i = 0; i < decrypt_randoms_matrix.size(); i++){
-            decrypt_randoms_matrix[i] = block(0, decrypt_randoms_matrix[i].mData[0]);
-        }
-
-        std::vector<uint32_t> pi;  
-        std::vector<block> pnECRG_out; 
-        pnECRG(1, chl, decrypt_randoms_matrix, item_cnt, alpha_max_cache_count, pi, pnECRG_out, numThreads);
-
-
-        // shuffle cuckoo table and XOR pnECRG_out
-        // one time padding
-        std::vector<block> shuffle_item(item_cnt);
-        for(int i = 0; i < item_cnt; i++){
-            if(cuckoo_item[pi[i]] == block(0,0)){
-            	shuffle_item[i] = pnECRG_out[i];
-            }
-            else{
-            	shuffle_item[i] = oc::block(cuckoo_item[pi[i]].mData[0], 1) ^ pnECRG_out[i];
-            }
-            
-        }                         
-        coproto::sync_wait(chl.send(shuffle_item)); 
+        pECRG_nECRG_OTP_Send(chl, decrypt_randoms, cuckoo_item, item_cnt, alpha_max_cache_count, mask_bit_count, numThreads, rotConfig);
 
 
-        timer.setTimePoint("end"); 
+        timer.setTimePoint("end");
         // std::cout << timer << std::endl;
 
     }else if (isSender == 0){
@@ -65,47 +100,25 @@ void pECRG_nECRG_OTP(u32 isSender, u32 numThreads)
         }
         randomMFile.read((char*)(&item_cnt), sizeof(uint64_t));
         randomMFile.read((char*)(&alpha_max_cache_count), sizeof(uint64_t));
+        randomMFile.read((char*)(&mask_bit_count), sizeof(uint64_t));
 
-        std::vector<block> random_matrix(item_cnt * alpha_max_cache_count);
-        randomMFile.read((char*)random_matrix.data(), sizeof(block) * random_matrix.size());
+        std::vector<u64> randoms(item_cnt * alpha_max_cache_count);
+        randomMFile.read((char*)randoms.data(), sizeof(u64) * randoms.size());
         randomMFile.close();
 
-        for(int i = 0; i < random_matrix.size(); i++){
-            random_matrix[i] = block(0, random_matrix[i].mData[0]);
-        }        
+        auto union_sub_receiver = pECRG_nECRG_OTP_Recv(chl, randoms, item_cnt, alpha_max_cache_count, mask_bit_count, numThreads, rotConfig);
 
-
-        std::vector<uint32_t> pi;  // useless
-        std::vector<block> pnECRG_out; 
-        pnECRG(0, chl, random_matrix, item_cnt, alpha_max_cache_count, pi, pnECRG_out, numThreads);
-
-        std::vector<oc::block> shuffle_item(item_cnt);
-        coproto::sync_wait(chl.recv(shuffle_item));  
-
-
-        // cause the receiver knows its input set, here we only need to know all the items in X/Y.
         std::ofstream fout;
         fout.open("union.csv",std::ofstream::out);
-        for(auto i = 0; i < item_cnt; ++i){
-            auto tmp_block = pnECRG_out[i] ^ shuffle_item[i];
-
-            if(tmp_block.mData[0] == 1){
-                fout << tmp_block.mData[1] << std::endl;
-            }
+        for(auto item : union_sub_receiver){
+            fout << item << std::endl;
         }
         fout.close();
 
-        u32 union_sub_receiver = 0;
-        for(auto i = 0; i < item_cnt; ++i){
-            auto tmp_block = pnECRG_out[i] ^ shuffle_item[i];
-            if(tmp_block.mData[0] == 1){
-                union_sub_receiver += 1;
-            }
-        }
-        std::cout << "union sub receiver size: " << union_sub_receiver << std::endl;
+        std::cout << "union sub receiver size: " << union_sub_receiver.size() << std::endl;
 
 
-        timer.setTimePoint("end"); 
+        timer.setTimePoint("end");
         std::cout << timer << std::endl;
 
         double comm = 0;
@@ -114,6 +127,5 @@ void pECRG_nECRG_OTP(u32 isSender, u32 numThreads)
         std::cout << "Comm cost = " << std::fixed << std::setprecision(3) << comm / 1024 / 1024 << " MB" << std::endl;
     }
     coproto::sync_wait(chl.flush());
-    coproto::sync_wait(chl.close());    
+    coproto::sync_wait(chl.close());
 }
-
@@ -20,6 +20,7 @@ USENIX Security 2025,
 #include <volePSI/Defines.h>
 #include <cryptoTools/Network/Channel.h>
 #include <string> 
+#include <vector>
 #include <fstream>
 #include <iostream>
 #include <istream>
@@ -29,4 +30,12 @@ USENIX Security 2025,
 using namespace oc;
 
 
-void pECRG_nECRG_OTP(u32 isSender, u32 numThreads);
+// reads the MCRG matrices from ../../MCRG/build/randomM and writes the union to union.csv
+void pECRG_nECRG_OTP(u32 isSender, u32 numThreads, const RotConfig &rotConfig = RotConfig());
+
+// in-memory halves of pECRG_nECRG_OTP, for callers that already hold the MCRG output
+// decryptRandoms and randoms are alphaMaxCacheCount rows of itemCnt masks, as in the randomM files
+void pECRG_nECRG_OTP_Send(Socket &chl, const std::vector<u64> &decryptRandoms, const std::vector<block> &cuckooItem, u64 itemCnt, u64 alphaMaxCacheCount, u64 maskBitCount, u32 numThreads, const RotConfig &rotConfig = RotConfig());
+
+// returns the sender's items that are not in the receiver's set
+std::vector<u64> pECRG_nECRG_OTP_Recv(Socket &chl, const std::vector<u64> &randoms, u64 itemCnt, u64 alphaMaxCacheCount, u64 maskBitCount, u32 numThreads, const RotConfig &rotConfig = RotConfig());
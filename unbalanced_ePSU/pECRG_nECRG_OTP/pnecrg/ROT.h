@@ -0,0 +1,64 @@
+#pragma once
+
+#include "define.h"
+#include <cryptoTools/Crypto/PRNG.h>
+#include <cryptoTools/Common/BitVector.h>
+#include <cryptoTools/Common/Aligned.h>
+#include <libOTe/config.h>
+#include <libOTe/Base/BaseOT.h>
+#include <libOTe/TwoChooseOne/OTExtInterface.h>
+#include <libOTe/TwoChooseOne/SoftSpokenOT/SoftSpokenShOtExt.h>
+#include <libOTe/TwoChooseOne/Iknp/IknpOtExtSender.h>
+#include <libOTe/TwoChooseOne/Iknp/IknpOtExtReceiver.h>
+#include <libOTe/TwoChooseOne/Silent/SilentOtExtSender.h>
+#include <libOTe/TwoChooseOne/Silent/SilentOtExtReceiver.h>
+#include <coproto/Socket/AsioSocket.h>
+#include <string>
+
+using namespace oc;
+
+// softspokenOT parameter
+constexpr uint64_t fieldBits = 5;
+
+// OT extension used for the ROT of nECRG
+enum class RotType : u8 {
+    SoftSpoken = 0,
+    Silent = 1,
+    Iknp = 2,
+    // measure the link before the OTs and pick SoftSpoken or Silent
+    Auto = 3
+};
+
+struct RotConfig {
+    RotType type = RotType::SoftSpoken;
+
+    // SoftSpoken k; smaller k means less computation and more communication
+    u64 softSpokenFieldBits = fieldBits;
+
+    // with RotType::Auto, links slower than this use silent OT
+    double autoThresholdMbps = 1000;
+
+    // bytes sent to measure the link with RotType::Auto
+    u64 autoProbeBytes = 1 << 20;
+};
+
+// parse "soft", "silent", "iknp" or "auto"
+RotType parseRotType(const std::string &name);
+std::string rotTypeName(RotType type);
+
+// both parties must call with the same config; with RotType::Auto the OT sender measures the link
+// and tells the OT receiver which backend (and k) to use
+void rotSend(u32 numElements, Socket &chl, PRNG& prng, AlignedVector<std::array<block, 2>> &sMsgs, const RotConfig &config = RotConfig(), u32 numThreads = 1);
+void rotRecv(u32 numElements, const BitVector &bitV, Socket &chl, PRNG& prng, AlignedVector<block> &rMsgs, const RotConfig &config = RotConfig(), u32 numThreads = 1);
+
+// softspoken OT
+void softSend(u32 numElements, Socket &chl, PRNG& prng, AlignedVector<std::array<block, 2>> &sMsgs, u32 numThreads = 1, u64 k = fieldBits);
+void softRecv(u32 numElements, BitVector bitV, Socket &chl, PRNG& prng, AlignedVector<block> &rMsgs, u32 numThreads = 1, u64 k = fieldBits);
+
+// IKNP OT
+void iknpSend(u32 numElements, Socket &chl, PRNG& prng, AlignedVector<std::array<block, 2>> &sMsgs, u32 numThreads = 1);
+void iknpRecv(u32 numElements, BitVector bitV, Socket &chl, PRNG& prng, AlignedVector<block> &rMsgs, u32 numThreads = 1);
+
+// silent OT, derandomized to the receiver's choice bits
+void silentSend(u32 numElements, Socket &chl, PRNG& prng, AlignedVector<std::array<block, 2>> &sMsgs, u32 numThreads = 1);
+void silentRecv(u32 numElements, BitVector bitV, Socket &chl, PRNG& prng, AlignedVector<block> &rMsgs, u32 numThreads = 1);
@@ -11,54 +11,6 @@ void genPermutation(u32 size, std::vector<u32> &pi)
 }
 
 
-void softSend(u32 numElements, Socket &chl, PRNG& prng, AlignedVector<std::array<block, 2>> &sMsgs, u32 numThreads)
-{
-    SoftSpokenShOtSender<> sender;
-    sender.init(fieldBits, true);
-    const size_t numBaseOTs = sender.baseOtCount();
-    PRNG prngOT(prng.get<block>());
-    AlignedVector<block> baseMsg;
-    // choice bits for baseOT
-    BitVector baseChoice;
-
-    // OTE's sender is base OT's receiver
-    DefaultBaseOT base;
-    baseMsg.resize(numBaseOTs);
-    // randomize the base OT's choice bits
-    baseChoice.resize(numBaseOTs);
-    baseChoice.randomize(prngOT);
-    // perform the base ot, call sync_wait to block until they have completed.
-    coproto::sync_wait(base.receive(baseChoice, baseMsg, prngOT, chl));
-
-    sender.setBaseOts(baseMsg, baseChoice);
-    // perform random ots
-
-    sMsgs.resize(numElements);
-    coproto::sync_wait(sender.send(sMsgs, prngOT, chl));
-
-}
-
-void softRecv(u32 numElements, BitVector bitV, Socket &chl, PRNG& prng, AlignedVector<block> &rMsgs, u32 numThreads)
-{
-
-    SoftSpokenShOtReceiver<> receiver;
-    receiver.init(fieldBits, true);
-    const size_t numBaseOTs = receiver.baseOtCount();
-    AlignedVector<std::array<block, 2>> baseMsg(numBaseOTs);
-    PRNG prngOT(prng.get<block>());
-
-    // OTE's receiver is base OT's sender
-    DefaultBaseOT base;
-    // perform the base ot, call sync_wait to block until they have completed.
-    coproto::sync_wait(base.send(baseMsg, prngOT, chl));
-
-    receiver.setBaseOts(baseMsg);
-
-    rMsgs.resize(numElements);
-    coproto::sync_wait(receiver.receive(bitV, rMsgs, prngOT, chl));
-
-}
-
 void SendEC25519Points(Socket &chl, std::vector<EC25519Point> &vecA, u32 numThreads) 
 {
     u32 size = vecA.size();
@@ -168,7 +120,7 @@ void pECRG(u32 isPI, Socket &chl, std::vector<block> &matrix, u32 rowNum, u32 co
 }
 
 // matrix[i] and matrix[i+rowNum] are in the same row
-void pnECRG(u32 isPI, Socket &chl, std::vector<block> &matrix, u32 rowNum, u32 colNum, std::vector<u32> &pi, std::vector<block> &out, u32 numThreads){
+void pnECRG(u32 isPI, Socket &chl, std::vector<block> &matrix, u32 rowNum, u32 colNum, std::vector<u32> &pi, std::vector<block> &out, u32 numThreads, u64 maskBitLength, const RotConfig &rotConfig){
 
     u32 len = matrix.size();
     assert(len == rowNum * colNum);
@@ -176,7 +128,14 @@ void pnECRG(u32 isPI, Socket &chl, std::vector<block> &matrix, u32 rowNum, u32 c
     PRNG prng(sysRandomSeed()); 
 
     
-    u64 keyBitLength = 40 + oc::log2ceil(len);  
+    // each of the len comparisons falsely reports equality with probability 2^-keyBitLength, so by
+    // the union bound the key needs log2(len) bits on top of the 40-bit statistical security; the
+    // masks fed in must be at least that wide too, or distinct masks collide just as often
+    u64 keyBitLength = 40 + oc::log2ceil(len);
+    if(maskBitLength < keyBitLength){
+        throw std::invalid_argument("maskBitLength must be at least " + std::to_string(keyBitLength)
+            + " for " + std::to_string(len) + " comparisons");
+    }
     u64 keyByteLength = oc::divCeil(keyBitLength, 8);      
 
     if(isPI){
@@ -243,7 +202,7 @@ void pnECRG(u32 isPI, Socket &chl, std::vector<block> &matrix, u32 rowNum, u32 c
         }
 
         AlignedVector<std::array<block, 2>> sMsgs(rowNum);
-        softSend(rowNum, chl, prng, sMsgs, numThreads);
+        rotSend(rowNum, chl, prng, sMsgs, rotConfig, numThreads);
 
         for(u32 i = 0; i < rowNum; ++i){
             out[i] = sMsgs[i][bitV[i]];
@@ -308,7 +267,7 @@ void pnECRG(u32 isPI, Socket &chl, std::vector<block> &matrix, u32 rowNum, u32 c
         }
 
         AlignedVector<block> rMsgs(rowNum);
-        softRecv(rowNum, bitV, chl, prng, rMsgs, numThreads);
+        rotRecv(rowNum, bitV, chl, prng, rMsgs, rotConfig, numThreads);
         memcpy(out.data(), rMsgs.data(), rowNum * sizeof(block));
 
     }
@@ -2,6 +2,7 @@
 
 #include "Circuit.h"
 #include "define.h"
+#include "ROT.h"
 #include "curve25519.h"
 #include <cryptoTools/Crypto/PRNG.h>
 #include <volePSI/GMW/Gmw.h>
@@ -18,16 +19,8 @@
 
 using namespace oc;
 
-constexpr uint64_t fieldBits = 5;
-
-
-
 void genPermutation(u32 size, std::vector<u32> &pi);
 
-// softspoken OT
-void softSend(u32 numElements, Socket &chl, PRNG& prng, AlignedVector<std::array<block, 2>> &sMsgs, u32 numThreads = 1);
-void softRecv(u32 numElements, BitVector bitV, Socket &chl, PRNG& prng, AlignedVector<block> &rMsgs, u32 numThreads = 1);
-
 void SendEC25519Points(Socket &chl, std::vector<EC25519Point> &vecA, u32 numThreads = 1);
 void ReceiveEC25519Points(Socket &chl, std::vector<EC25519Point> &vecA, u32 numThreads = 1);
 
@@ -35,4 +28,6 @@ void ReceiveEC25519Points(Socket &chl, std::vector<EC25519Point> &vecA, u32 numT
 void pECRG(u32 isPI, Socket &chl, std::vector<block> &matrix, u32 rowNum, u32 colNum, std::vector<u32> &pi, std::vector<block> &out, u32 numThreads = 1);
 
 //pnECRG: permuted non equality conditional randomness generation
-void pnECRG(u32 isPI, Socket &chl, std::vector<block> &matrix, u32 rowNum, u32 colNum, std::vector<u32> &pi, std::vector<block> &out, u32 numThreads = 1);
\ No newline at end of file
+// maskBitLength is the number of meaningful bits in each matrix entry and must be at least
+// 40 + log2ceil(rowNum * colNum); rotConfig selects the OT extension of the final ROT
+void pnECRG(u32 isPI, Socket &chl, std::vector<block> &matrix, u32 rowNum, u32 colNum, std::vector<u32> &pi, std::vector<block> &out, u32 numThreads = 1, u64 maskBitLength = 128, const RotConfig &rotConfig = RotConfig());
\ No newline at end of file
@@ -4,9 +4,9 @@
 using namespace oc;
 
 
-void pECRG_nECRG_OTP_Test(u32 isSender, u32 numThreads)
+void pECRG_nECRG_OTP_Test(u32 isSender, u32 numThreads, const RotConfig &rotConfig)
 {
-    pECRG_nECRG_OTP(isSender, numThreads);  
+    pECRG_nECRG_OTP(isSender, numThreads, rotConfig);  
     if(!isSender){
         std::cout << "pECRG_nECRG_OTP_Test finished." << std::endl;
     }
@@ -20,6 +20,9 @@ int main(int agrc, char** argv){
     
     u32 nt = cmd.getOr("nt", 1);
     u32 idx = cmd.getOr("r", 0);
+    RotConfig rotConfig;
+    rotConfig.type = parseRotType(cmd.getOr<std::string>("ot", "soft"));
+    rotConfig.softSpokenFieldBits = cmd.getOr("k", fieldBits);
     bool help = cmd.isSet("h");
     
     if (help){
@@ -27,6 +30,8 @@ int main(int agrc, char** argv){
         std::cout << "parameters" << std::endl;
         std::cout << "    -nt:          number of threads, default 1" << std::endl;
         std::cout << "    -r:           index of party" << std::endl;
+        std::cout << "    -ot:          ROT backend: soft, silent, iknp or auto, default soft" << std::endl;
+        std::cout << "    -k:           softspoken field bits, default 5" << std::endl;
         return 0;
     }    
 
@@ -34,7 +39,7 @@ int main(int agrc, char** argv){
         std::cout << "wrong idx of party, please use -h to print help information" << std::endl;
         return 0;
     }
-    pECRG_nECRG_OTP_Test(idx, nt);
+    pECRG_nECRG_OTP_Test(idx, nt, rotConfig);
 
     return 0;
 }
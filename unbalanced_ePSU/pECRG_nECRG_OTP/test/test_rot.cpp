@@ -0,0 +1,130 @@
+#include "../pnecrg/ROT.h"
+#include "../pnecrg/define.h"
+#include <coproto/Socket/AsioSocket.h>
+#include <cryptoTools/Common/CLP.h>
+#include <chrono>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+
+using namespace oc;
+
+
+/*
+
+benchmark of the ROT backends used by nECRG: P0 is the OT sender, P1 the OT receiver
+
+P1 outputs rMsgs[i] == sMsgs[i][bitV[i]] for every backend
+
+*/
+void ROT_bench(u32 idx, Socket &chl, u32 numElements, const RotConfig &rotConfig, u32 numThreads){
+
+    PRNG prng(sysRandomSeed());
+    BitVector bitV(numElements);
+    bitV.randomize(prng);
+
+    AlignedVector<std::array<block, 2>> sMsgs(numElements);
+    AlignedVector<block> rMsgs(numElements);
+
+    u64 bytesBefore = chl.bytesSent() + chl.bytesReceived();
+    auto start = std::chrono::steady_clock::now();
+
+    if(idx == 0){
+        rotSend(numElements, chl, prng, sMsgs, rotConfig, numThreads);
+    }
+    else{
+        rotRecv(numElements, bitV, chl, prng, rMsgs, rotConfig, numThreads);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double ms = std::chrono::duration<double, std::milli>(end - start).count();
+    double bytes = chl.bytesSent() + chl.bytesReceived() - bytesBefore;
+
+    // check the functionality outside the measurement
+    if(idx == 0){
+        coproto::sync_wait(chl.send(sMsgs));
+    }
+    else{
+        AlignedVector<std::array<block, 2>> sMsgs0(numElements);
+        coproto::sync_wait(chl.recv(sMsgs0));
+        u32 count = 0;
+        for(u32 i = 0; i < numElements; ++i){
+            if(sMsgs0[i][bitV[i]] != rMsgs[i]){
+                count += 1;
+            }
+        }
+
+        std::stringstream name;
+        name << rotTypeName(rotConfig.type);
+        if(rotConfig.type == RotType::SoftSpoken){
+            name << " k=" << rotConfig.softSpokenFieldBits;
+        }
+        std::cout << std::left << std::setw(16) << name.str()
+                  << std::fixed << std::setprecision(3)
+                  << " time " << ms << " ms (" << ms * 1e6 / numElements << " ns/OT)"
+                  << ", comm " << bytes / 1024 / 1024 << " MB (" << bytes / numElements << " bytes/OT)"
+                  << (count == 0 ? "" : ", functionality test fail!") << std::endl;
+    }
+}
+
+
+int main(int agrc, char** argv){
+
+    CLP cmd;
+    cmd.parse(agrc, argv);
+    u32 nn = cmd.getOr("nn", 20);
+    u32 n = cmd.getOr("n", 1ull << nn);
+    u32 nt = cmd.getOr("nt", 1);
+    u32 idx = cmd.getOr("r", 0);
+    bool help = cmd.isSet("h");
+
+    if (help){
+        std::cout << "benchmark: random OT backends for nECRG" << std::endl;
+        std::cout << "parameters" << std::endl;
+        std::cout << "    -n:           number of OTs, default 2^20" << std::endl;
+        std::cout << "    -nn:          logarithm of the number of OTs, default 20" << std::endl;
+        std::cout << "    -nt:          number of threads, default 1" << std::endl;
+        std::cout << "    -r:           index of party" << std::endl;
+        std::cout << "    -ot:          run only this backend (soft, silent, iknp or auto), default all" << std::endl;
+        std::cout << "    -k:           softspoken field bits to run, default 2 5 8" << std::endl;
+        return 0;
+    }
+
+    if ((idx > 1 || idx < 0)){
+        std::cout << "wrong idx of party, please use -h to print help information" << std::endl;
+        return 0;
+    }
+
+    std::vector<RotConfig> configs;
+    std::vector<u64> ks = cmd.getManyOr<u64>("k", { 2, fieldBits, 8 });
+    std::vector<RotType> types = { RotType::SoftSpoken, RotType::Silent, RotType::Iknp };
+    if(cmd.isSet("ot")){
+        types = { parseRotType(cmd.get<std::string>("ot")) };
+    }
+    for(auto type : types){
+        RotConfig config;
+        config.type = type;
+        if(type == RotType::SoftSpoken){
+            for(auto k : ks){
+                config.softSpokenFieldBits = k;
+                configs.push_back(config);
+            }
+        }
+        else{
+            configs.push_back(config);
+        }
+    }
+
+    Socket chl;
+    chl = coproto::asioConnect("localhost:" + std::to_string(PORT + 101), idx);
+
+    for(auto &config : configs){
+        ROT_bench(idx, chl, n, config, nt);
+    }
+
+    coproto::sync_wait(chl.flush());
+    coproto::sync_wait(chl.close());
+
+    return 0;
+}
@@ -48,6 +48,15 @@ def main():
     pnecrg_OTP_dir = os.path.join(script_dir, 'pECRG_nECRG_OTP', 'build')
     auto_test = os.path.join(script_dir, 'MCRG', 'tools')
 
+    # The end-to-end driver runs MCRG and pECRG_nECRG_OTP in one process per party
+    epsu_unbalanced = os.path.join(mcrg_dir, 'bin', 'epsu_unbalanced')
+    if args.pecrg_necrg_otp and not (args.pecrg or args.pnecrg) and os.path.exists(epsu_unbalanced):
+        epsu_args = f'-n {args.nn} -t {args.nt} -p {os.path.join(param_dir, "16M-1024.json")}'
+        print("\n\n\nstart for epsu_unbalanced\n\n\n")
+        run_command(f'{epsu_unbalanced} -r 0 {epsu_args} & {epsu_unbalanced} -r 1 {epsu_args}')
+        print("\n\nend for epsu_unbalanced\n\n\n")
+        return
+
     # Copy files
     run_command(f'cp {os.path.join(auto_test, "auto_test.py")} {mcrg_dir}/')
     run_command(f'cp {os.path.join(param_dir, "16M-1024.json")} {mcrg_dir}/')